@@ -1,5 +1,6 @@
 #pragma once
 #include <cassert>
+#include <mutex>
 
 #define FMT_HEADER_ONLY
 #include "../external/fmt/include/fmt/core.h"
@@ -25,11 +26,15 @@ private:
     static constexpr auto yellow = "\033[33m";
     static constexpr auto red = "\033[31m";
     static constexpr auto reset = "\033[0m";
+
+    //keeps lines from worker threads from interleaving
+    static inline std::mutex output_mutex;
 };
 
 template <typename FmtStr, typename... Args>
 inline void Logger::Info(const FmtStr& fmt, const Args&... args)
 {
+    std::lock_guard<std::mutex> lock(output_mutex);
     printf("[%sInfo%s] ", green, reset);
     fmt::print(fmt, args...);
     printf("\n");
@@ -38,6 +43,7 @@ inline void Logger::Info(const FmtStr& fmt, const Args&... args)
 template <typename FmtStr, typename... Args>
 inline void Logger::Warning(const FmtStr& fmt, const Args&... args)
 {
+    std::lock_guard<std::mutex> lock(output_mutex);
     printf("[%sWarning%s] ", yellow, reset);
     fmt::print(fmt, args...);
     printf("\n");
@@ -46,6 +52,7 @@ inline void Logger::Warning(const FmtStr& fmt, const Args&... args)
 template <typename FmtStr, typename... Args>
 inline void Logger::Error(const FmtStr& fmt, const Args&... args)
 {
+    std::lock_guard<std::mutex> lock(output_mutex);
     printf("[%sError%s] ", red, reset);
     fmt::print(fmt, args...);
     printf("\n");
@@ -54,6 +61,7 @@ inline void Logger::Error(const FmtStr& fmt, const Args&... args)
 template <typename FmtStr, typename... Args>
 inline void Logger::Critical(const FmtStr& fmt, const Args&... args)
 {
+    std::lock_guard<std::mutex> lock(output_mutex);
     printf("[%sCritical Error%s] ", magenta, reset);
     fmt::print(fmt, args...);
     printf("\n");
@@ -0,0 +1,175 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+#include <new>
+
+namespace nmspp
+{
+	//bump allocator of a Document. nothing allocated from it is destroyed one by one, everything goes at once with the arena.
+	class Arena
+	{
+	public:
+		explicit Arena(size_t block_size = 64 * 1024) : block_size(block_size) {}
+
+		Arena(const Arena&) = delete;
+		Arena& operator=(const Arena&) = delete;
+		Arena(Arena&&) noexcept = default;
+		Arena& operator=(Arena&&) noexcept = default;
+
+		void* Allocate(size_t size, size_t alignment);
+
+		//zero initialized, T is never destructed
+		template <typename T>
+		T* AllocateArray(size_t count)
+		{
+			static_assert(std::is_trivially_destructible_v<T>, "arena memory is released without running destructors");
+			if (count == 0) return nullptr;
+
+			T* items = static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+			for (size_t i = 0; i < count; i++) new (items + i) T{};
+			return items;
+		}
+
+		std::string_view CopyString(std::string_view text);
+
+		//drops everything but the first block, which the next document reuses
+		void Reset();
+
+		size_t BytesUsed() const { return bytes_used; }
+
+	private:
+		size_t block_size;
+		//the first block can be bigger than block_size when its first allocation was
+		size_t first_block_size = 0;
+		std::vector<std::unique_ptr<char[]>> blocks;
+		char* cursor = nullptr;
+		char* end = nullptr;
+		size_t bytes_used = 0;
+	};
+
+	enum class NodeKind : uint8_t
+	{
+		Bool,
+		Int,
+		UInt,
+		Float,
+		String,
+		Enum,
+		Struct,
+		List,
+		Array,
+		//polymorphic NMSTemplate slot, not decoded, same as in the generated types
+		Template,
+		//a type the schema has no binary layout for, e.g. one with custom serialization
+		Opaque
+	};
+
+	//one value of a Document, lives in the document's arena
+	struct Node
+	{
+		NodeKind kind = NodeKind::Opaque;
+		//schema name of the type, "System.Single" for values and the element type for lists and arrays
+		std::string_view type_name;
+
+		union
+		{
+			bool boolean;
+			int64_t integer;
+			uint64_t unsigned_integer;
+			double real;
+		} value{};
+
+		//String: the text. Enum: the name of the value, empty if it has none (combined flags)
+		std::string_view text;
+
+		//Struct: one per field, named by field_names. List and Array: the elements.
+		const Node* children = nullptr;
+		const std::string_view* field_names = nullptr;
+		uint32_t child_count = 0;
+
+		//field of a struct, nullptr if there is none
+		const Node* Find(std::string_view field_name) const;
+		//fields and list indices separated by dots, e.g. "Objects.DistantObjects.0.Resource"
+		const Node* FindPath(std::string_view path) const;
+	};
+
+	//types, layouts and enums of one libMBIN, compiled into decoding plans. shared by any number of documents.
+	class TypeSchema
+	{
+	public:
+		//RuntimeOptions::schema_cache_path, extracted through Mono first if libMBIN changed since it was written
+		static std::shared_ptr<const TypeSchema> Load();
+		//a schema file written for the dll at dll_path, nullptr if it is missing or stale. never starts Mono.
+		static std::shared_ptr<const TypeSchema> Load(const std::string& schema_path, const std::string& dll_path);
+
+		~TypeSchema();
+
+		size_t TypeCount() const;
+
+		struct Impl;
+
+	private:
+		friend class Document;
+
+		explicit TypeSchema(std::unique_ptr<Impl> impl);
+
+		std::unique_ptr<Impl> impl;
+	};
+
+	//any MBIN as a tree of Nodes, without a generated native type. freed in one step with Clear or the document.
+	class Document
+	{
+	public:
+		explicit Document(std::shared_ptr<const TypeSchema> schema);
+
+		//replaces the current contents. the root type is found through the template hash and GUID in the header.
+		bool ReadMbin(const char* data, size_t size);
+		bool ReadMbin(const std::string& path);
+
+		void Clear();
+
+		//nullptr while empty
+		const Node* Root() const { return root; }
+		std::string_view TemplateName() const { return root ? root->type_name : std::string_view(); }
+
+		size_t BytesUsed() const { return arena.BytesUsed(); }
+
+		//one line per value, indented by depth
+		std::string Dump() const;
+
+	private:
+		std::shared_ptr<const TypeSchema> schema;
+		Arena arena;
+		const Node* root = nullptr;
+	};
+
+	//calls visit(path, node) for node and everything below it, depth first. paths look like FindPath takes them.
+	template <typename Visitor>
+	void WalkNodes(const Node& node, Visitor&& visit, std::string& path)
+	{
+		visit(std::string_view(path), node);
+
+		for (uint32_t i = 0; i < node.child_count; i++)
+		{
+			size_t path_size = path.size();
+			if (!path.empty()) path += '.';
+			if (node.field_names) path += node.field_names[i];
+			else path += std::to_string(i);
+
+			WalkNodes(node.children[i], visit, path);
+			path.resize(path_size);
+		}
+	}
+
+	template <typename Visitor>
+	void WalkNodes(const Node& node, Visitor&& visit)
+	{
+		std::string path;
+		WalkNodes(node, visit, path);
+	}
+}
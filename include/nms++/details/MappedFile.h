@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+//read only view of a whole file, unmapped on destruction
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	explicit MappedFile(const std::string& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	//replaces the current mapping, false if the file cannot be opened or is empty
+	bool Open(const std::string& path);
+	void Close();
+
+	bool IsOpen() const { return data != nullptr; }
+	const char* Data() const { return data; }
+	size_t Size() const { return size; }
+
+private:
+	const char* data = nullptr;
+	size_t size = 0;
+
+#ifdef _WIN32
+	void* file_handle = nullptr;
+	void* mapping_handle = nullptr;
+#endif
+};
@@ -0,0 +1,315 @@
+#pragma once
+
+#include "traits_ext.h"
+#include "pfr/tuple_size.hpp"
+#include "pfr/core.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <type_traits>
+
+//native side of the managed GraphFlattener helper (nms++/managed/GraphFlattener.cs), same layout.
+//native types are read and written field by field in pfr order, which matches the managed field order.
+//static fields are members of the generated types too, they keep their slot but the managed side never sends or takes their value.
+namespace flat_codec
+{
+	constexpr uint32_t magic = 0x46534D4E;
+	constexpr uint16_t version = 2;
+
+	class Reader
+	{
+	public:
+		Reader(const char* data, size_t size) : cursor(data), end(data + size) {}
+
+		bool ReadBytes(void* out, size_t size)
+		{
+			if (static_cast<size_t>(end - cursor) < size) return failed = true, false;
+
+			std::memcpy(out, cursor, size);
+			cursor += size;
+			return true;
+		}
+
+		template <typename T>
+		bool Read(T& out) { return ReadBytes(&out, sizeof(T)); }
+
+		bool Skip(size_t size)
+		{
+			if (static_cast<size_t>(end - cursor) < size) return failed = true, false;
+
+			cursor += size;
+			return true;
+		}
+
+		const char* Cursor() const { return cursor; }
+		bool Failed() const { return failed; }
+		bool AtEnd() const { return cursor == end; }
+
+	private:
+		const char* cursor;
+		const char* end;
+		bool failed = false;
+	};
+
+	class Writer
+	{
+	public:
+		void WriteBytes(const void* data, size_t size)
+		{
+			const char* bytes = static_cast<const char*>(data);
+			buffer.insert(buffer.end(), bytes, bytes + size);
+		}
+
+		template <typename T>
+		void Write(const T& value) { WriteBytes(&value, sizeof(T)); }
+
+		const std::vector<char>& Buffer() const { return buffer; }
+		void Reserve(size_t size) { buffer.reserve(size); }
+
+	private:
+		std::vector<char> buffer;
+	};
+
+	template <typename T>
+	bool DecodeObject(Reader& reader, T& out);
+
+	template <typename T>
+	void EncodeObject(Writer& writer, const T& value);
+
+	template <typename T>
+	bool DecodeValue(Reader& reader, T& out)
+	{
+		if constexpr (traits_ext::is_blittable<T>::value)
+		{
+			return reader.Read(out);
+		}
+		else if constexpr (std::is_same_v<T, std::string>)
+		{
+			int32_t length = 0;
+			if (!reader.Read(length)) return false;
+
+			if (length < 0)
+			{
+				out.clear();
+				return true;
+			}
+
+			const char* chars = reader.Cursor();
+			if (!reader.Skip(static_cast<size_t>(length))) return false;
+
+			out.assign(chars, static_cast<size_t>(length));
+			return true;
+		}
+		else if constexpr (std::is_array_v<T>)
+		{
+			using ElementType = std::remove_extent_t<T>;
+			constexpr size_t array_size = std::extent_v<T>;
+
+			int32_t count = 0;
+			if (!reader.Read(count)) return false;
+			if (count < 0) return true;
+
+			//managed arrays of a different length are cut or padded, like the per field path does
+			const size_t length = std::min<size_t>(static_cast<size_t>(count), array_size);
+			if constexpr (traits_ext::is_blittable<ElementType>::value)
+			{
+				return reader.ReadBytes(out, length * sizeof(ElementType))
+					&& reader.Skip((static_cast<size_t>(count) - length) * sizeof(ElementType));
+			}
+			else
+			{
+				for (size_t i = 0; i < length; i++)
+				{
+					if (!DecodeValue(reader, out[i])) return false;
+				}
+
+				ElementType discarded{};
+				for (size_t i = length; i < static_cast<size_t>(count); i++)
+				{
+					if (!DecodeValue(reader, discarded)) return false;
+				}
+				return true;
+			}
+		}
+		else if constexpr (traits_ext::is_vector<T>::value)
+		{
+			using ElementType = typename T::value_type;
+
+			int32_t count = 0;
+			if (!reader.Read(count)) return false;
+
+			out.clear();
+			if (count <= 0) return true;
+
+			if constexpr (std::is_same_v<ElementType, bool>)
+			{
+				//vector<bool> has no contiguous storage
+				out.resize(static_cast<size_t>(count));
+				for (size_t i = 0; i < out.size(); i++)
+				{
+					bool element = false;
+					if (!reader.Read(element)) return false;
+					out[i] = element;
+				}
+				return true;
+			}
+			else if constexpr (traits_ext::is_blittable<ElementType>::value)
+			{
+				out.resize(static_cast<size_t>(count));
+				return reader.ReadBytes(out.data(), out.size() * sizeof(ElementType));
+			}
+			else
+			{
+				out.resize(static_cast<size_t>(count));
+				for (ElementType& element : out)
+				{
+					if (!DecodeValue(reader, element)) return false;
+				}
+				return true;
+			}
+		}
+		else if constexpr (std::is_class_v<T>)
+		{
+			return DecodeObject(reader, out);
+		}
+		else
+		{
+			static_assert(traits_ext::is_blittable<T>::value, "type has no flat encoding");
+			return false;
+		}
+	}
+
+	template <typename T>
+	bool DecodeObject(Reader& reader, T& out)
+	{
+		uint8_t present = 0;
+		if (!reader.Read(present)) return false;
+
+		if (!present)
+		{
+			out = T{};
+			return true;
+		}
+
+		uint16_t field_count = 0;
+		if (!reader.Read(field_count)) return false;
+
+		//a different field count means the native type does not describe this class
+		if (field_count != pfr::tuple_size_v<T>) return false;
+
+		bool success = true;
+		pfr::for_each_field(out, [&](auto& field_value)
+			{
+				if (!success) return;
+
+				//0 for a static field, which is left as it is
+				uint8_t has_value = 0;
+				success = reader.Read(has_value) && has_value <= 1;
+				if (success && has_value) success = DecodeValue(reader, field_value);
+			});
+
+		return success;
+	}
+
+	template <typename T>
+	void EncodeValue(Writer& writer, const T& value)
+	{
+		if constexpr (traits_ext::is_blittable<T>::value)
+		{
+			writer.Write(value);
+		}
+		else if constexpr (std::is_same_v<T, std::string>)
+		{
+			writer.Write(static_cast<int32_t>(value.size()));
+			writer.WriteBytes(value.data(), value.size());
+		}
+		else if constexpr (std::is_array_v<T>)
+		{
+			using ElementType = std::remove_extent_t<T>;
+			constexpr size_t array_size = std::extent_v<T>;
+
+			writer.Write(static_cast<int32_t>(array_size));
+			if constexpr (traits_ext::is_blittable<ElementType>::value)
+			{
+				writer.WriteBytes(value, array_size * sizeof(ElementType));
+			}
+			else
+			{
+				for (size_t i = 0; i < array_size; i++)
+				{
+					EncodeValue(writer, value[i]);
+				}
+			}
+		}
+		else if constexpr (traits_ext::is_vector<T>::value)
+		{
+			using ElementType = typename T::value_type;
+
+			writer.Write(static_cast<int32_t>(value.size()));
+			if constexpr (std::is_same_v<ElementType, bool>)
+			{
+				for (bool element : value)
+				{
+					writer.Write(element);
+				}
+			}
+			else if constexpr (traits_ext::is_blittable<ElementType>::value)
+			{
+				writer.WriteBytes(value.data(), value.size() * sizeof(ElementType));
+			}
+			else
+			{
+				for (const ElementType& element : value)
+				{
+					EncodeValue(writer, element);
+				}
+			}
+		}
+		else if constexpr (std::is_class_v<T>)
+		{
+			EncodeObject(writer, value);
+		}
+		else
+		{
+			static_assert(traits_ext::is_blittable<T>::value, "type has no flat encoding");
+		}
+	}
+
+	template <typename T>
+	void EncodeObject(Writer& writer, const T& value)
+	{
+		writer.Write(static_cast<uint8_t>(1));
+		writer.Write(static_cast<uint16_t>(pfr::tuple_size_v<T>));
+
+		//the native type does not know which of its fields are static, the managed side drops those values
+		pfr::for_each_field(value, [&](const auto& field_value)
+			{
+				writer.Write(static_cast<uint8_t>(1));
+				EncodeValue(writer, field_value);
+			});
+	}
+
+	//whole buffer with header, the root object must be present
+	template <typename T>
+	bool Decode(const char* data, size_t size, T& out)
+	{
+		Reader reader(data, size);
+
+		uint32_t buffer_magic = 0;
+		uint16_t buffer_version = 0;
+		if (!reader.Read(buffer_magic) || !reader.Read(buffer_version)) return false;
+		if (buffer_magic != magic || buffer_version != version) return false;
+
+		return DecodeObject(reader, out) && reader.AtEnd();
+	}
+
+	template <typename T>
+	void Encode(Writer& writer, const T& value)
+	{
+		writer.Write(magic);
+		writer.Write(version);
+		EncodeObject(writer, value);
+	}
+}
@@ -0,0 +1,676 @@
+#pragma once
+
+#include "traits_ext.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <type_traits>
+
+//runtime half of the generated MBIN codec, see CSharpInterpreter::GenerateMbinCodec.
+//the generated header specializes TypeLayout and adds one ReadFields overload per type to this namespace,
+//calls from here find them through the Reader argument at instantiation.
+//View and ListView are the runtime half of the generated read only views, see CSharpInterpreter::GenerateMbinViews.
+namespace mbin_codec
+{
+	constexpr uint64_t magic = 0xCCCCCCCCCCCCCCCC;
+	constexpr uint64_t magic_pc = 0xDDDDDDDDDDDDDDDD;
+	constexpr uint32_t list_marker = 0xAAAAAA01;
+	//i64 data offset relative to the header, i32 count, list_marker
+	constexpr size_t list_header_size = sizeof(int64_t) + sizeof(int32_t) + sizeof(uint32_t);
+
+	//libMBIN writes list data after everything that points at it, so an offset back into or before its own header is corrupt.
+	//shared by every list decoder, false unless the data starts past the header and inside size bytes
+	inline bool ListDataOffset(size_t header_offset, int64_t relative_offset, size_t size, size_t& data_offset)
+	{
+		if (relative_offset < static_cast<int64_t>(list_header_size)) return false;
+		if (header_offset > size || static_cast<uint64_t>(relative_offset) > size - header_offset) return false;
+
+		data_offset = header_offset + static_cast<size_t>(relative_offset);
+		return true;
+	}
+
+	//libMBIN MBINHeader
+	struct Header
+	{
+		uint64_t magic_id;
+		uint16_t mbin_version;
+		uint16_t header_version;
+		uint32_t name_hash;
+		uint64_t template_guid;
+		uint64_t timestamp;
+	};
+	static_assert(sizeof(Header) == 0x20, "MBIN header must be 0x20 bytes");
+
+	//size, alignment, name_hash, guid and writable of a generated type
+	template <typename T>
+	struct TypeLayout;
+
+	//mbin_version, header_version and timestamp of the libMBIN the codec was generated from.
+	//defined by the generated header, T only defers the lookup until then.
+	template <typename T>
+	struct HeaderDefaults;
+
+	template <typename T, typename = void>
+	struct has_layout : std::false_type {};
+
+	template <typename T>
+	struct has_layout<T, std::void_t<decltype(TypeLayout<T>::size)>> : std::true_type {};
+
+	//types with polymorphic templates or hash maps are read natively but written by libMBIN
+	template <typename T, typename = void>
+	struct is_writable : std::false_type {};
+
+	template <typename T>
+	struct is_writable<T, std::void_t<decltype(TypeLayout<T>::writable)>> : std::bool_constant<TypeLayout<T>::writable> {};
+
+	//stride of T in arrays and lists
+	template <typename T>
+	constexpr size_t BinarySize()
+	{
+		if constexpr (traits_ext::is_blittable<T>::value) return sizeof(T);
+		else return TypeLayout<T>::size;
+	}
+
+	template <typename T>
+	constexpr size_t BinaryAlignment()
+	{
+		if constexpr (traits_ext::is_blittable<T>::value) return alignof(T);
+		else return TypeLayout<T>::alignment;
+	}
+
+	//random access over a whole MBIN, offsets are absolute. out of bounds reads leave the target untouched and set Failed.
+	class Reader
+	{
+	public:
+		Reader(const char* data, size_t size) : data(data), size(size) {}
+
+		template <typename T>
+		void ReadValue(size_t offset, T& out)
+		{
+			if (!InBounds(offset, sizeof(T))) return;
+
+			std::memcpy(&out, data + offset, sizeof(T));
+		}
+
+		//stored with the width of the managed enum, which the generated enum class does not always match
+		template <typename Binary, typename T>
+		void ReadEnum(size_t offset, T& out)
+		{
+			Binary value{};
+			ReadValue(offset, value);
+			out = static_cast<T>(value);
+		}
+
+		//zero padded char buffer of a fixed capacity
+		void ReadString(size_t offset, size_t capacity, std::string& out)
+		{
+			if (!InBounds(offset, capacity)) return;
+
+			const char* chars = data + offset;
+			out.assign(chars, std::find(chars, chars + capacity, '\0'));
+		}
+
+		//list of chars, the count includes the terminator
+		void ReadDynamicString(size_t offset, std::string& out)
+		{
+			size_t data_offset = 0;
+			size_t count = 0;
+			out.clear();
+			if (!ReadListHeader(offset, data_offset, count) || !InBounds(data_offset, count)) return;
+
+			const char* chars = data + data_offset;
+			out.assign(chars, std::find(chars, chars + count, '\0'));
+		}
+
+		template <typename T>
+		void Read(size_t offset, T& out)
+		{
+			if constexpr (traits_ext::is_blittable<T>::value)
+			{
+				ReadValue(offset, out);
+			}
+			else
+			{
+				ReadFields(*this, offset, out);
+			}
+		}
+
+		template <typename T>
+		void ReadList(size_t offset, std::vector<T>& out)
+		{
+			constexpr size_t stride = BinarySize<T>();
+
+			size_t data_offset = 0;
+			size_t count = 0;
+			out.clear();
+			if (!ReadListHeader(offset, data_offset, count) || !InBounds(data_offset, count * stride)) return;
+
+			out.resize(count);
+			if constexpr (std::is_same_v<T, bool>)
+			{
+				//vector<bool> has no contiguous storage
+				for (size_t i = 0; i < count; i++)
+				{
+					out[i] = data[data_offset + i] != 0;
+				}
+			}
+			else if constexpr (std::is_arithmetic_v<T>)
+			{
+				std::memcpy(out.data(), data + data_offset, count * stride);
+			}
+			else
+			{
+				for (size_t i = 0; i < count; i++)
+				{
+					Read(data_offset + i * stride, out[i]);
+				}
+			}
+		}
+
+		template <typename Binary, typename T>
+		void ReadEnumList(size_t offset, std::vector<T>& out)
+		{
+			size_t data_offset = 0;
+			size_t count = 0;
+			out.clear();
+			if (!ReadListHeader(offset, data_offset, count) || !InBounds(data_offset, count * sizeof(Binary))) return;
+
+			out.resize(count);
+			for (size_t i = 0; i < count; i++)
+			{
+				ReadEnum<Binary>(data_offset + i * sizeof(Binary), out[i]);
+			}
+		}
+
+		template <typename T, size_t N>
+		void ReadArray(size_t offset, T (&out)[N])
+		{
+			constexpr size_t stride = BinarySize<T>();
+			if (!InBounds(offset, N * stride)) return;
+
+			if constexpr (std::is_arithmetic_v<T> && !std::is_same_v<T, bool>)
+			{
+				std::memcpy(out, data + offset, N * stride);
+			}
+			else
+			{
+				for (size_t i = 0; i < N; i++)
+				{
+					Read(offset + i * stride, out[i]);
+				}
+			}
+		}
+
+		template <typename Binary, typename T, size_t N>
+		void ReadEnumArray(size_t offset, T (&out)[N])
+		{
+			for (size_t i = 0; i < N; i++)
+			{
+				ReadEnum<Binary>(offset + i * sizeof(Binary), out[i]);
+			}
+		}
+
+		bool Failed() const { return failed; }
+
+	private:
+		bool InBounds(size_t offset, size_t length)
+		{
+			if (offset > size || size - offset < length) return failed = true, false;
+
+			return true;
+		}
+
+		//the data offset is stored relative to the list header, empty lists point nowhere
+		bool ReadListHeader(size_t offset, size_t& data_offset, size_t& count)
+		{
+			int64_t relative_offset = 0;
+			int32_t list_count = 0;
+			ReadValue(offset, relative_offset);
+			ReadValue(offset + sizeof(int64_t), list_count);
+			if (failed || list_count <= 0) return false;
+
+			//a list pointing back at its own header would be read again and again until the stack runs out
+			if (!ListDataOffset(offset, relative_offset, size, data_offset)) return failed = true, false;
+
+			count = static_cast<size_t>(list_count);
+			return true;
+		}
+
+		const char* data;
+		size_t size;
+		bool failed = false;
+	};
+
+	//builds a whole MBIN. list and string data goes after the template that owns it, depth first in field order, which is the order libMBIN writes it in.
+	class Writer
+	{
+	public:
+		//zero filled space at the end of the buffer, returns its offset
+		size_t Allocate(size_t length, size_t alignment)
+		{
+			size_t offset = (buffer.size() + alignment - 1) / alignment * alignment;
+			buffer.resize(offset + length);
+			return offset;
+		}
+
+		template <typename T>
+		void WriteValue(size_t offset, const T& value)
+		{
+			std::memcpy(buffer.data() + offset, &value, sizeof(T));
+		}
+
+		template <typename Binary, typename T>
+		void WriteEnum(size_t offset, T value)
+		{
+			WriteValue(offset, static_cast<Binary>(value));
+		}
+
+		//cut to capacity, the rest of the buffer stays zero
+		void WriteString(size_t offset, size_t capacity, const std::string& value)
+		{
+			std::memcpy(buffer.data() + offset, value.data(), std::min(value.size(), capacity));
+		}
+
+		void WriteDynamicString(size_t offset, const std::string& value)
+		{
+			//empty strings still hold their terminator
+			WriteListHeader(offset, value.size() + 1);
+			pending.push_back({ offset, &value, &WriteDynamicStringData });
+		}
+
+		template <typename T>
+		void Write(size_t offset, const T& value)
+		{
+			if constexpr (traits_ext::is_blittable<T>::value)
+			{
+				WriteValue(offset, value);
+			}
+			else
+			{
+				WriteFields(*this, offset, value);
+			}
+		}
+
+		template <typename T>
+		void WriteList(size_t offset, const std::vector<T>& values)
+		{
+			WriteListHeader(offset, values.size());
+			if (!values.empty()) pending.push_back({ offset, &values, &WriteListData<T> });
+		}
+
+		template <typename Binary, typename T>
+		void WriteEnumList(size_t offset, const std::vector<T>& values)
+		{
+			WriteListHeader(offset, values.size());
+			if (!values.empty()) pending.push_back({ offset, &values, &WriteEnumListData<Binary, T> });
+		}
+
+		template <typename T, size_t N>
+		void WriteArray(size_t offset, const T (&values)[N])
+		{
+			constexpr size_t stride = BinarySize<T>();
+
+			if constexpr (std::is_arithmetic_v<T> && !std::is_same_v<T, bool>)
+			{
+				std::memcpy(buffer.data() + offset, values, N * stride);
+			}
+			else
+			{
+				for (size_t i = 0; i < N; i++)
+				{
+					Write(offset + i * stride, values[i]);
+				}
+			}
+		}
+
+		template <typename Binary, typename T, size_t N>
+		void WriteEnumArray(size_t offset, const T (&values)[N])
+		{
+			for (size_t i = 0; i < N; i++)
+			{
+				WriteEnum<Binary>(offset + i * sizeof(Binary), values[i]);
+			}
+		}
+
+		//writes the data of every list queued from first on, each followed by the lists its elements queued
+		void Flush(size_t first)
+		{
+			std::vector<Pending> entries(pending.begin() + first, pending.end());
+			pending.resize(first);
+
+			for (const Pending& entry : entries)
+			{
+				entry.write(*this, entry.header_offset, entry.values);
+				Flush(first);
+			}
+		}
+
+		const std::vector<char>& Buffer() const { return buffer; }
+		void Reserve(size_t size) { buffer.reserve(size); }
+
+	private:
+		//list data is only written once the template holding the header is complete
+		struct Pending
+		{
+			size_t header_offset;
+			const void* values;
+			void (*write)(Writer&, size_t, const void*);
+		};
+
+		//the data offset is patched in once the data is written, empty lists keep 0
+		void WriteListHeader(size_t offset, size_t count)
+		{
+			WriteValue(offset + sizeof(int64_t), static_cast<int32_t>(count));
+			WriteValue(offset + sizeof(int64_t) + sizeof(int32_t), list_marker);
+		}
+
+		void WriteDataOffset(size_t header_offset, size_t data_offset)
+		{
+			WriteValue(header_offset, static_cast<int64_t>(data_offset - header_offset));
+		}
+
+		static void WriteDynamicStringData(Writer& writer, size_t header_offset, const void* data)
+		{
+			const std::string& value = *static_cast<const std::string*>(data);
+
+			size_t data_offset = writer.Allocate(value.size() + 1, 1);
+			std::memcpy(writer.buffer.data() + data_offset, value.data(), value.size());
+			writer.WriteDataOffset(header_offset, data_offset);
+		}
+
+		template <typename T>
+		static void WriteListData(Writer& writer, size_t header_offset, const void* data)
+		{
+			const std::vector<T>& values = *static_cast<const std::vector<T>*>(data);
+			constexpr size_t stride = BinarySize<T>();
+
+			size_t data_offset = writer.Allocate(values.size() * stride, BinaryAlignment<T>());
+			writer.WriteDataOffset(header_offset, data_offset);
+
+			if constexpr (std::is_same_v<T, bool>)
+			{
+				for (size_t i = 0; i < values.size(); i++)
+				{
+					writer.buffer[data_offset + i] = values[i] ? 1 : 0;
+				}
+			}
+			else if constexpr (std::is_arithmetic_v<T>)
+			{
+				std::memcpy(writer.buffer.data() + data_offset, values.data(), values.size() * stride);
+			}
+			else
+			{
+				for (size_t i = 0; i < values.size(); i++)
+				{
+					writer.Write(data_offset + i * stride, values[i]);
+				}
+			}
+		}
+
+		template <typename Binary, typename T>
+		static void WriteEnumListData(Writer& writer, size_t header_offset, const void* data)
+		{
+			const std::vector<T>& values = *static_cast<const std::vector<T>*>(data);
+
+			size_t data_offset = writer.Allocate(values.size() * sizeof(Binary), alignof(Binary));
+			writer.WriteDataOffset(header_offset, data_offset);
+
+			for (size_t i = 0; i < values.size(); i++)
+			{
+				writer.WriteEnum<Binary>(data_offset + i * sizeof(Binary), values[i]);
+			}
+		}
+
+		std::vector<char> buffer;
+		std::vector<Pending> pending;
+	};
+
+	//true if the buffer is an MBIN of exactly this template version
+	template <typename T>
+	bool HeaderMatches(const char* data, size_t size)
+	{
+		if (size < sizeof(Header)) return false;
+
+		Header header;
+		std::memcpy(&header, data, sizeof(Header));
+
+		return (header.magic_id == magic || header.magic_id == magic_pc)
+			&& header.name_hash == TypeLayout<T>::name_hash
+			&& header.template_guid == TypeLayout<T>::guid;
+	}
+
+	//whole MBIN file, the root template follows the header
+	template <typename T>
+	bool Decode(const char* data, size_t size, T& out)
+	{
+		static_assert(has_layout<T>::value, "no generated MBIN layout for this type, include the generated MBIN codec");
+
+		if (!HeaderMatches<T>(data, size)) return false;
+
+		Reader reader(data, size);
+		ReadFields(reader, sizeof(Header), out);
+		return !reader.Failed();
+	}
+
+	//whole MBIN file, with the header libMBIN writes for this template
+	template <typename T>
+	void Encode(Writer& writer, const T& value)
+	{
+		static_assert(is_writable<T>::value, "no generated MBIN writer for this type, it is written through libMBIN");
+
+		Header header{};
+		header.magic_id = magic;
+		header.mbin_version = HeaderDefaults<T>::mbin_version;
+		header.header_version = HeaderDefaults<T>::header_version;
+		header.name_hash = TypeLayout<T>::name_hash;
+		header.template_guid = TypeLayout<T>::guid;
+		header.timestamp = HeaderDefaults<T>::timestamp;
+
+		writer.WriteValue(writer.Allocate(sizeof(Header), 1), header);
+
+		WriteFields(writer, writer.Allocate(TypeLayout<T>::size, TypeLayout<T>::alignment), value);
+		writer.Flush(0);
+	}
+
+	class View;
+
+	template <typename V>
+	V MakeView(const char* data, size_t size, size_t offset);
+
+	//bytes of one element, E is a value, an enum stored as Binary or a generated view
+	template <typename E, typename Binary>
+	constexpr size_t ElementSize()
+	{
+		if constexpr (std::is_base_of_v<View, E>) return E::binary_size;
+		else return sizeof(Binary);
+	}
+
+	template <typename E, typename Binary>
+	E LoadElement(const char* data, size_t size, size_t offset)
+	{
+		if constexpr (std::is_base_of_v<View, E>)
+		{
+			return MakeView<E>(data, size, offset);
+		}
+		else if constexpr (std::is_same_v<E, bool>)
+		{
+			return data[offset] != 0;
+		}
+		else
+		{
+			Binary value;
+			std::memcpy(&value, data + offset, sizeof(Binary));
+			return static_cast<E>(value);
+		}
+	}
+
+	//list or fixed array inside an MBIN, elements are decoded when accessed. lists that do not fit the data are empty.
+	template <typename E, typename Binary = E>
+	class ListView
+	{
+	public:
+		class iterator
+		{
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = E;
+			using difference_type = std::ptrdiff_t;
+			using pointer = void;
+			using reference = E;
+
+			iterator() = default;
+			iterator(const ListView* list, size_t index) : list(list), index(index) {}
+
+			E operator*() const { return (*list)[index]; }
+			iterator& operator++() { index++; return *this; }
+			iterator operator++(int) { iterator previous = *this; index++; return previous; }
+
+			bool operator==(const iterator& other) const { return index == other.index; }
+			bool operator!=(const iterator& other) const { return index != other.index; }
+
+		private:
+			const ListView* list = nullptr;
+			size_t index = 0;
+		};
+
+		ListView() = default;
+		ListView(const char* data, size_t size, size_t offset, size_t count) : data(data), file_size(size), offset(offset), count(count) {}
+
+		size_t size() const { return count; }
+		bool empty() const { return count == 0; }
+
+		E operator[](size_t index) const { return LoadElement<E, Binary>(data, file_size, offset + index * ElementSize<E, Binary>()); }
+
+		iterator begin() const { return iterator(this, 0); }
+		iterator end() const { return iterator(this, count); }
+
+	private:
+		const char* data = nullptr;
+		size_t file_size = 0;
+		size_t offset = 0;
+		size_t count = 0;
+	};
+
+	//read only window on one template of an MBIN that stays in memory, usually a MappedFile. nothing is copied up front,
+	//the generated accessors decode their field when called and strings and lists point into the data.
+	//a view whose template does not fit the data is invalid and all of its fields read as empty.
+	class View
+	{
+	public:
+		View() = default;
+		View(const char* data, size_t size, size_t offset) : data(data), size(size), offset(offset) {}
+
+		bool IsValid() const { return data != nullptr; }
+
+		//the whole template as its generated native type, for when most of the fields are needed after all
+		template <typename T>
+		bool Decode(T& out) const
+		{
+			if (!data) return false;
+
+			Reader reader(data, size);
+			ReadFields(reader, offset, out);
+			return !reader.Failed();
+		}
+
+	protected:
+		template <typename T>
+		T ValueAt(size_t field_offset) const
+		{
+			return data ? LoadElement<T, T>(data, size, offset + field_offset) : T{};
+		}
+
+		template <typename Binary, typename T>
+		T EnumAt(size_t field_offset) const
+		{
+			return data ? LoadElement<T, Binary>(data, size, offset + field_offset) : T{};
+		}
+
+		std::string_view StringAt(size_t field_offset, size_t capacity) const
+		{
+			if (!data) return {};
+
+			const char* chars = data + offset + field_offset;
+			return std::string_view(chars, std::find(chars, chars + capacity, '\0') - chars);
+		}
+
+		std::string_view DynamicStringAt(size_t field_offset) const
+		{
+			size_t data_offset = 0;
+			size_t count = 0;
+			if (!ListData(field_offset, 1, data_offset, count)) return {};
+
+			const char* chars = data + data_offset;
+			return std::string_view(chars, std::find(chars, chars + count, '\0') - chars);
+		}
+
+		template <typename V>
+		V StructAt(size_t field_offset) const
+		{
+			return data ? MakeView<V>(data, size, offset + field_offset) : V();
+		}
+
+		template <typename E, typename Binary = E>
+		ListView<E, Binary> ListAt(size_t field_offset) const
+		{
+			size_t data_offset = 0;
+			size_t count = 0;
+			if (!ListData(field_offset, ElementSize<E, Binary>(), data_offset, count)) return {};
+
+			return ListView<E, Binary>(data, size, data_offset, count);
+		}
+
+		//arrays are stored in place, in bounds whenever the template is
+		template <typename E, size_t N, typename Binary = E>
+		ListView<E, Binary> ArrayAt(size_t field_offset) const
+		{
+			if (!data) return {};
+
+			return ListView<E, Binary>(data, size, offset + field_offset, N);
+		}
+
+	private:
+		//the header Reader::ReadListHeader reads, false for empty lists and lists that do not fit the data
+		bool ListData(size_t field_offset, size_t stride, size_t& data_offset, size_t& count) const
+		{
+			if (!data) return false;
+
+			size_t header_offset = offset + field_offset;
+			int64_t relative_offset = 0;
+			int32_t list_count = 0;
+			std::memcpy(&relative_offset, data + header_offset, sizeof(int64_t));
+			std::memcpy(&list_count, data + header_offset + sizeof(int64_t), sizeof(int32_t));
+			if (list_count <= 0 || !ListDataOffset(header_offset, relative_offset, size, data_offset)) return false;
+
+			count = static_cast<size_t>(list_count);
+			return stride == 0 || (size - data_offset) / stride >= count;
+		}
+
+		const char* data = nullptr;
+		size_t size = 0;
+		size_t offset = 0;
+	};
+
+	//V over the template at offset, invalid if the template does not fit the data
+	template <typename V>
+	V MakeView(const char* data, size_t size, size_t offset)
+	{
+		if (offset > size || size - offset < V::binary_size) return V();
+
+		return V(data, size, offset);
+	}
+
+	//view of a whole MBIN, false if it is not of V's template version or the root template is truncated
+	template <typename V>
+	bool OpenView(const char* data, size_t size, V& out)
+	{
+		if (!HeaderMatches<typename V::native_type>(data, size)) return false;
+
+		out = MakeView<V>(data, size, sizeof(Header));
+		return out.IsValid();
+	}
+}
@@ -12,6 +12,10 @@ namespace traits_ext
     template<typename T, typename Alloc>
     struct is_vector<std::vector<T, Alloc>> : std::true_type {};
 
+    //same representation in native and managed memory
+    template<typename T>
+    struct is_blittable : std::bool_constant<std::is_arithmetic_v<T> || std::is_enum_v<T>> {};
+
     template<typename T>
     struct is_basic_string : std::false_type {};
 
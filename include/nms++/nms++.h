@@ -2,10 +2,24 @@
 //nms++ interface header
 
 #include <string>
+#include <vector>
 #include "mono/metadata/object-forward.h"
+#include "details/MonoLayer.h"
 #include "pfr/tuple_size.hpp"
 #include "pfr/functions_for.hpp"
 #include <iostream>
+
+//explicit runtime startup and options, mono is otherwise started on first use
+#include "details/Runtime.h"
+//per method and per GC cycle numbers, see RuntimeOptions::profiler
+#include "details/Profiler.h"
+//read only file mapping the MBIN views point into
+#include "details/MappedFile.h"
+//member paths for IO::TryGetProjectedObject
+#include "details/Projection.h"
+//any MBIN as a tree of values, decoded through the schema instead of generated types
+#include "details/Dom.h"
+
 class IO
 {
 public:
@@ -21,7 +35,25 @@ public:
 		ResourceHandle(MonoObject* obj);
 	};
 
-	static void Initialize();
+	//non owning view of bytes, stands in for std::span until the project moves past C++17
+	struct BufferView
+	{
+		const uint8_t* data = nullptr;
+		size_t size = 0;
+
+		BufferView() = default;
+		BufferView(const uint8_t* data, size_t size) : data(data), size(size) {}
+		BufferView(const std::vector<uint8_t>& bytes) : data(bytes.data()), size(bytes.size()) {}
+	};
+
+	enum class Format
+	{
+		Mbin,
+		Mxml
+	};
+
+	//use_unmanaged_thunks calls the MBIN/MXML writers through direct function pointers instead of mono_runtime_invoke
+	static void Initialize(bool use_unmanaged_thunks = true);
 
 	static char* ReadBytes(const std::string& path, uint32_t& out_size);
 
@@ -34,11 +66,56 @@ public:
 	static void Write(ResourceHandle handle);
 	//uses custom path, can export to both mxml and mbin and so needs to have .mxml or .mbin in the path
 	static void Write(ResourceHandle handle, const std::string& path);
+
+	//writes a native type without a managed object. .MBIN and .MXML go through the generated writers when the type has
+	//them, everything else through PushData and libMBIN.
+	template <typename NativeType>
+	static void Write(NativeType& native_type, const std::string& path);
 	
+	//serializes a handle in memory through a managed MemoryStream, the result is copied once into native memory
+	[[nodiscard]] static std::vector<uint8_t> SerializeToBuffer(ResourceHandle handle, Format format);
+
+	//loads a template from memory without a temp file. the bytes are read in place and only need to live for the call.
+	[[nodiscard]] static ResourceHandle LoadFromBuffer(BufferView buffer, Format format);
+
+	//reads an MBIN straight into a generated native type, without going through the managed runtime.
+	//needs the generated MBIN codec (generated/GeneratedMbinCodec.h) for NativeType.
+	template <typename NativeType>
+	[[nodiscard]] static bool ReadNativeMbin(const std::string& path, NativeType& out);
+
+	template <typename NativeType>
+	[[nodiscard]] static bool ReadNativeMbin(BufferView buffer, NativeType& out);
+
+	//every MBIN of NativeType's template in a directory, MBINs of other templates are skipped
+	template <typename NativeType>
+	[[nodiscard]] static std::vector<NativeType> ReadNativeMbinDirectory(const std::string& directory);
+
+	//maps an MBIN for a generated read only view (generated/GeneratedMbinViews.h), e.g. GcBiomeDataView for GcBiomeData.
+	//fields are decoded when accessed and strings and lists point into the mapping, the view is only valid while file stays open.
+	template <typename ViewType>
+	[[nodiscard]] static bool OpenMbinView(const std::string& path, MappedFile& file, ViewType& out);
+
+	//calls visit(view, path) for every MBIN of ViewType's template in a directory, one mapping is reused for all of them
+	template <typename ViewType, typename Visitor>
+	static void VisitMbinViews(const std::string& directory, Visitor&& visit);
+
+	//parses an MXML straight into a generated native type, without going through the managed runtime or building a document.
+	//needs the generated MXML reader (generated/GeneratedMxmlCodec.h) for NativeType.
+	template <typename NativeType>
+	[[nodiscard]] static bool ReadNativeMxml(const std::string& path, NativeType& out);
+
+	template <typename NativeType>
+	[[nodiscard]] static bool ReadNativeMxml(BufferView buffer, NativeType& out);
+
 	//get a native object from a ResourceHandle
 	template <typename NativeType>
 	static NativeType TryGetNativeObject(ResourceHandle handle);
 
+	//gets only the fields selected by an nmspp::Projection, the rest of the object is never walked, e.g.
+	//TryGetProjectedObject<GcExternalObjectList, Projection<Path<&GcExternalObjectList::Objects, &GcEnvironmentSpawnData::Landmarks>>>(handle)
+	template <typename NativeType, typename ProjectionType>
+	static NativeType TryGetProjectedObject(ResourceHandle handle);
+
 	//pushes data from a native type to a ResourceHandle. returns success.
 	template <typename NativeType>
 	static bool PushData(NativeType& native_type, ResourceHandle handle);
@@ -53,11 +130,81 @@ public:
 
 	//PAK directory contents
 	static void PAKDirectoryContents(const std::string& directory, const std::string& pak_file_name);
+
+private:
+	//MBINFile, MBINHeader, MXmlFile and the corlib streams used by the buffer API
+	static MonoClass* mbin_file;
+	static MonoClass* mbin_header;
+	static MonoClass* mxml_file;
+	static MonoClass* memory_stream;
+	static MonoClass* unmanaged_memory_stream;
+
+	//GraphFlattener.Flatten(object) and GraphFlattener.Rebuild(object, byte[]) of the helper assembly
+	static ManagedThunk<MonoArray*, MonoObject*> flatten_thunk;
+	static ManagedThunk<int32_t, MonoObject*, MonoArray*> rebuild_thunk;
+
+	//raw bytes to path, creating the directory like Write does
+	static bool WriteBuffer(const std::string& path, const char* data, size_t size);
+
+	//field by field marshalling, used for nested objects and when the flat helper is unavailable
+	template <typename NativeType>
+	static NativeType ReadObject(MonoObject* obj);
+
+	//one non blittable field of obj, blittable fields are left to the access plan
+	template <typename FieldType>
+	static void ReadField(MonoObject* obj, const MonoFieldLayout& field_layout, FieldType& field_value);
+
+	//fills the fields of out selected by ProjectionType and leaves the others as they are
+	template <typename ProjectionType, typename NativeType>
+	static void ReadProjected(MonoObject* obj, NativeType& out);
+
+	//follows the rest of a path into a field, the whole field once the path ends
+	template <typename PathType, typename FieldType>
+	static void ReadPathField(MonoObject* obj, const MonoFieldLayout& field_layout, FieldType& field_value);
+
+	template <typename NativeType>
+	static bool WriteObject(NativeType& native_type, MonoObject* obj);
+
+	//whole graph in one managed call through the helper assembly, false if it is not loaded or the type is not supported
+	template <typename NativeType>
+	static bool ReadFlat(MonoObject* obj, NativeType& out);
+
+	template <typename NativeType>
+	static bool WriteFlat(NativeType& native_type, MonoObject* obj);
+
+	template <typename NativeType>
+	static const NativeAccessPlan* GetAccessPlan(MonoClass* mono_class);
+
+	template <typename NativeType>
+	static NativeAccessPlan BuildAccessPlan(MonoClass* mono_class);
+
+	//reads a List<T> through its backing array
+	template <typename ElementType>
+	static void ReadList(MonoObject* list_obj, std::vector<ElementType>& out);
+
+	//ReadList for elements read through a projection
+	template <typename ProjectionType, typename ElementType>
+	static void ReadListProjected(MonoObject* list_obj, std::vector<ElementType>& out);
+
+	//Count/get_Item fallback for list types without the expected storage fields
+	template <typename ElementType>
+	static void ReadListReflected(MonoObject* list_obj, std::vector<ElementType>& out);
+
+	//writes a List<T> through its backing array, reusing element objects already in the list
+	template <typename ElementType>
+	static void WriteList(MonoObject* list_obj, std::vector<ElementType>& values);
+
+	//Clear/Add fallback for list types without the expected storage fields
+	template <typename ElementType>
+	static void WriteListReflected(MonoObject* list_obj, std::vector<ElementType>& values);
 };
 
 //compiler needs to see some of the definitions
 #include "details/generics_impl.hpp"
 
+//threads attached to mono, IO may be used from its tasks
+#include "details/WorkerPool.h"
+
 
 namespace CSharpInterpreter
 {
@@ -0,0 +1,36 @@
+#pragma once
+#include "Runtime.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+//mirror of libMBIN and the framework assemblies it references, each one next to its AOT image.
+//mono picks up <assembly file><native library extension> when an assembly is loaded from the mirror.
+class AotCache
+{
+public:
+	//true if every mirrored assembly still matches its source and the images were built for this runtime
+	static bool IsCurrent(const nmspp::RuntimeOptions& options);
+
+	//copies the assemblies into the cache, compiles each one with options.aot_compiler and rewrites the manifest
+	static bool Build(const nmspp::RuntimeOptions& options, const std::vector<std::string>& assembly_paths);
+
+	//libMBIN inside the cache
+	static std::string CachedAssemblyPath(const nmspp::RuntimeOptions& options);
+
+private:
+	struct Entry
+	{
+		std::string file_name;
+		std::string source_path;
+		uintmax_t size = 0;
+		int64_t write_time = 0;
+	};
+
+	static std::string ManifestPath(const nmspp::RuntimeOptions& options);
+	static std::string ImagePath(const std::string& assembly_path);
+	static std::string RuntimeBuild();
+
+	//size and last write time of the source, false if it does not exist
+	static bool Stamp(const std::string& path, Entry& entry);
+};
@@ -2,8 +2,11 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
 #include <unordered_set>
 #include <unordered_map>
+#include <cstdint>
+#include "mono/metadata/object-forward.h"
 
 
 namespace CSharpInterpreter
@@ -12,8 +15,25 @@ namespace CSharpInterpreter
 	{
 		std::string name;
 		std::string type_name;
-		bool is_actual_enum;
-		uint32_t size;
+		bool is_actual_enum = false;
+		uint32_t size = 0;
+
+		//binary layout, only filled when the owning TypeInfo has_layout
+		uint32_t offset = 0;
+		//NMSAttribute Alignment, 0 when the field is aligned like its type
+		uint32_t alignment = 0;
+		//width of the enum, or of the element enum for arrays and lists
+		uint32_t enum_size = 0;
+		//statics and NMSAttribute Ignore fields take no space in an MBIN
+		bool is_serialized = true;
+		//NMSAttribute MxmlName, the property name in MXML. same as name unless libMBIN renames the field
+		std::string mxml_name;
+		//NMSAttribute Index, MXML properties are written in this order
+		int32_t index = 0;
+		//NMSAttribute KeyField, the property of the values a HashMap is keyed on
+		std::string key_field;
+		//MXML names of the elements of an enum indexed array, elements without a name are written with _index
+		std::vector<std::string> enum_names;
 	};
 
 	struct TypeInfo
@@ -23,6 +43,13 @@ namespace CSharpInterpreter
 		std::string base_class_name;
 		std::string base_class_namespace;
 		std::vector<FieldInfo> field_infos;
+
+		//binary layout as libMBIN computes it, see ExtractBinaryLayout
+		bool has_layout = false;
+		uint32_t binary_size = 0;
+		uint32_t alignment = 0;
+		uint32_t name_hash = 0;
+		uint64_t guid = 0;
 	};
 
 	struct EnumInfo
@@ -32,6 +59,18 @@ namespace CSharpInterpreter
 		std::string namespace_name;
 		std::string underlying_type;
 		std::vector<std::pair<std::string, int64_t>> entries;
+		//[Flags], combined values are written as the names of their flags
+		bool is_flags = false;
+	};
+
+	//MBINHeader constants of the loaded libMBIN, the timestamp is its version
+	struct MbinHeaderInfo
+	{
+		uint16_t mbin_version = 0;
+		uint16_t header_version = 0;
+		uint64_t timestamp = 0;
+		//libMBIN version the way MBINCompiler prints it, written into MXML files
+		std::string compiler_version;
 	};
 
 	struct TypeInfosResult 
@@ -42,18 +81,81 @@ namespace CSharpInterpreter
 
 	TypeInfosResult ExtractTypeInfos();
 
+	//everything codegen needs from one libMBIN.dll, saved by SaveSchema so later runs do not have to start Mono
+	struct Schema
+	{
+		TypeInfosResult infos;
+		MbinHeaderInfo header_info;
+	};
+
+	//content hash the schema is keyed on, 0 if the file cannot be read
+	uint64_t HashFile(const std::string& path);
+
+	//false if there is no schema at path, it is damaged or it was extracted from a dll with another hash
+	bool LoadSchema(const std::string& path, uint64_t dll_hash, Schema& out);
+	bool SaveSchema(const std::string& path, uint64_t dll_hash, const Schema& schema);
+
+	//the schema at RuntimeOptions::schema_cache_path, extracted through Mono and saved first if the dll changed
+	Schema LoadOrExtractSchema();
+
 	void GenerateCppWrappers();
 
-	std::unordered_map<std::string, std::string> GenerateTypesStructs(std::multimap<std::string, TypeInfo>& multimapped_types);
+	//struct text of every generated type by name, with the enums nested in it. types are generated in parallel.
+	std::unordered_map<std::string, std::string> GenerateTypesStructs(std::multimap<std::string, TypeInfo>& multimapped_types, const std::unordered_multimap<std::string, const EnumInfo*>& nested_enums);
+
+	//headers by path relative to generated/: types/<namespace>/<struct>.h for each struct with includes of its dependencies,
+	//GeneratedCppTypesFwd.h declaring every struct and GeneratedCppTypes.h including all of them in sorted_struct_names order
+	std::map<std::string, std::string> GenerateTypeHeaders(const std::vector<std::string>& sorted_struct_names, const std::unordered_map<std::string, std::string>& write_datas,
+		const std::unordered_map<std::string, std::string>& name_namespace_map, const std::map<std::string, std::set<std::string>>& dependency_graph);
+
+	//writes headers into directory, skipping those whose contents did not change and removing struct headers not in headers
+	void WriteTypeHeaders(const std::string& directory, const std::map<std::string, std::string>& headers);
+
+	//Mono free MBIN reader and writer for every struct in GeneratedCppTypes.h, types without a binary layout are left out
+	std::string GenerateMbinCodec(const std::vector<std::string>& sorted_struct_names, const std::unordered_map<std::string, const TypeInfo*>& layout_types, const MbinHeaderInfo& header_info);
+
+	//read only views over a mapped MBIN for every type of the MBIN codec, FooView decodes a field of Foo only when it is accessed
+	std::string GenerateMbinViews(const std::vector<std::string>& sorted_struct_names, const std::unordered_map<std::string, const TypeInfo*>& layout_types);
+
+	//Mono free MXML reader and writer for every struct in GeneratedCppTypes.h. property and enum names are looked up through generated perfect hashes,
+	//the writer emits the same text as libMBIN
+	std::string GenerateMxmlCodec(const std::vector<std::string>& sorted_struct_names, const std::unordered_map<std::string, const TypeInfo*>& struct_types, const std::vector<EnumInfo>& enum_infos, const MbinHeaderInfo& header_info);
+
+	//how a field is stored, shared by the codec generators
+	enum class FieldKind
+	{
+		Value,
+		Enum,
+		String,
+		DynamicString,
+		Struct,
+		Template,
+		List,
+		EnumList,
+		Array,
+		EnumArray,
+		Unsupported
+	};
+
+	FieldKind ClassifyField(const FieldInfo& field_info);
+	//element type of List<T>, HashMap<T> and T[], the type itself otherwise
+	std::string ElementTypeName(const std::string& type_name);
+	//type names are unique without namespace, same as in name_namespace_map
+	std::string ShortTypeName(const std::string& full_name);
+	std::string CppTypeName(const TypeInfo& type_info);
+	bool HasSerializedFields(const TypeInfo& type_info);
 
 	//internal
-	std::unordered_set<std::string> RetrieveDependencies(const std::string& self_name, const std::string& from_struct);
+	void ExtractBinaryLayout(MonoClass* type_class, TypeInfo& type_info);
+
+	MbinHeaderInfo ExtractMbinHeaderInfo();
 
-	void ExtractTypesFromStruct(const char* find_namespace, const std::string& from_struct, std::vector<std::string>& types);
+	//structs of struct_names the fields of type_info need complete: field, array and list element types and the owners of nested enums
+	std::set<std::string> RetrieveDependencies(const TypeInfo& type_info, const std::unordered_set<std::string>& struct_names);
 
 	bool Visit(const std::string& struct_name, std::unordered_set<std::string>& visited,
 		std::unordered_set<std::string>& temp_marks, std::vector<std::string>& sorted_struct_names,
-		const std::unordered_map<std::string, std::unordered_set<std::string>>& dependency_graph);
+		const std::map<std::string, std::set<std::string>>& dependency_graph);
 
 	std::string MapCppType(FieldInfo& field_info, bool const* is_array);
 
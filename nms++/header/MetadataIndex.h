@@ -0,0 +1,73 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "mono/metadata/object-forward.h"
+#include "mono/metadata/image.h"
+
+namespace CSharpInterpreter
+{
+	//NMSAttribute properties ExtractTypeInfos reads. the defaults come from a default constructed NMSAttribute.
+	struct NMSAttributeValues
+	{
+		uint32_t size = 0;
+		uint32_t alignment = 0;
+		bool ignore = false;
+		std::string mxml_name;
+		int32_t index = 0;
+		std::string key_field;
+		//EnumType or EnumValue is set, the array elements have names
+		bool has_enum = false;
+	};
+
+	//the TypeDef, Field, Constant, NestedClass and CustomAttribute tables of an image, each decoded once into arrays indexed by row.
+	//rows are 1 based like in tokens, 0 stands for none.
+	class MetadataIndex
+	{
+	public:
+		explicit MetadataIndex(MonoImage* image);
+
+		enum class AttributeState
+		{
+			None,
+			Decoded,
+			//set through a constructor with arguments or a value the blob decoder does not know, read it through mono
+			Undecodable
+		};
+
+		uint32_t TypeCount() const { return type_count; }
+		const char* TypeName(uint32_t type_row) const;
+		const char* TypeNamespace(uint32_t type_row) const;
+		//0 for types that are not nested
+		uint32_t EnclosingType(uint32_t type_row) const { return enclosing_types[type_row]; }
+
+		bool IsEnum(uint32_t type_row) const { return enum_types[type_row]; }
+		bool IsFlags(uint32_t type_row) const { return flags_types[type_row]; }
+		//C++ name of the type of value__, e.g. "int32_t"
+		std::string EnumUnderlyingType(uint32_t type_row) const;
+		//literal fields with their constants, in declaration order
+		std::vector<std::pair<std::string, int64_t>> EnumEntries(uint32_t type_row) const;
+
+		//applies the named arguments of the NMSAttribute on field_row to out, which starts out as the defaults
+		AttributeState ReadNMSAttribute(uint32_t field_row, NMSAttributeValues& out) const;
+
+	private:
+		const char* Blob(uint32_t blob_index, uint32_t& length) const;
+
+		MonoImage* image;
+		uint32_t type_count = 0;
+		uint32_t field_count = 0;
+
+		//field_lists[row] to field_lists[row + 1] are the fields of a type, one past type_count for the end
+		std::vector<uint32_t> field_lists;
+		std::vector<uint32_t> enclosing_types;
+		std::vector<bool> enum_types;
+		std::vector<bool> flags_types;
+
+		//Constant row of each field
+		std::vector<uint32_t> field_constants;
+		//CustomAttribute row of each field's NMSAttribute, and whether its constructor takes no arguments
+		std::vector<uint32_t> field_nms_attributes;
+		std::vector<bool> nms_attribute_decodable;
+	};
+}
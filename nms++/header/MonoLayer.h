@@ -4,15 +4,126 @@
 #include "mono/jit/jit.h"
 #include "mono/utils/mono-logger.h"
 #include "../header/Logger.h"
+#include "Runtime.h"
+#include "MappedFile.h"
 #include <vector>
+#include <array>
+#include <unordered_map>
+#include <type_traits>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+
+//cached description of a single managed field, filled once per class
+struct MonoFieldLayout
+{
+    MonoClassField* field = nullptr;
+    MonoType* type = nullptr;
+    const char* name = nullptr;
+    //offset from the start of the object, includes the object header
+    uint32_t offset = 0;
+    //MonoTypeEnum of the field type
+    int type_kind = 0;
+    //static fields live in the class's static storage, offset is not relative to an object and they are never marshalled
+    bool is_static = false;
+    //array fields only: element class and the size of one element in array storage
+    MonoClass* element_class = nullptr;
+    uint32_t element_size = 0;
+};
+
+struct MonoClassLayout
+{
+    MonoClass* mono_class = nullptr;
+    std::vector<MonoFieldLayout> fields;
+};
+
+//backing storage of a closed System.Collections.Generic.List<T> (or a subclass of it)
+struct MonoListLayout
+{
+    MonoClass* list_class = nullptr;
+    //T[] _items
+    uint32_t items_offset = 0;
+    //int _size
+    uint32_t size_offset = 0;
+    //int _version
+    uint32_t version_offset = 0;
+    MonoClass* element_class = nullptr;
+    uint32_t element_size = 0;
+    bool element_is_valuetype = false;
+};
+
+//compiled per native type: where its blittable fields live on both sides
+struct NativeAccessPlan
+{
+    struct Run
+    {
+        uint32_t managed_offset;
+        uint32_t native_offset;
+        uint32_t size;
+    };
+
+    const MonoClassLayout* layout = nullptr;
+    //adjacent fields that are contiguous on both sides are merged into one run
+    std::vector<Run> runs;
+};
+
+#ifdef _WIN32
+#define NMS_THUNK_CALL __stdcall
+#else
+#define NMS_THUNK_CALL
+#endif
+
+//direct function pointer into a managed method, see MonoLayer::GetUnmanagedThunk.
+//instance methods take the object as their first parameter.
+template <typename Ret, typename... Params>
+struct ManagedThunk
+{
+    using Function = Ret(NMS_THUNK_CALL*)(Params..., MonoException**);
+
+    Function function = nullptr;
+    const char* name = nullptr;
+
+    explicit operator bool() const { return function != nullptr; }
+};
+
+struct InvokeStats
+{
+    uint64_t runtime_invokes = 0;
+    uint64_t thunk_invokes = 0;
+    uint64_t method_lookups = 0;
+    uint64_t method_cache_hits = 0;
+
+    double HitRate() const { return method_lookups ? static_cast<double>(method_cache_hits) / method_lookups : 0.0; }
+};
 
 class MonoLayer
 {
 public:
-	MonoLayer(const char* dll);
+	//does not touch mono, the runtime is started by EnsureInitialized
+	MonoLayer() = default;
 
 	~MonoLayer();
 
+	//options are taken over by the next startup, false once the runtime is already running
+	bool Configure(const nmspp::RuntimeOptions& options);
+
+	//starts the runtime on the first call, later calls only check a flag. false if startup failed.
+	bool EnsureInitialized()
+	{
+		if (initialized.load(std::memory_order_acquire)) return true;
+		return InitializeSlow();
+	}
+
+	bool IsInitialized() const { return initialized.load(std::memory_order_acquire); }
+
+	nmspp::StartupTimings GetStartupTimings() const;
+
+	//options of the running runtime, or of the upcoming startup
+	const nmspp::RuntimeOptions& GetOptions() const { return options; }
+
+	//see nmspp::Runtime::BuildAotCache
+	bool BuildAotCache();
+
 	MonoClass* GetClass(const char* const& namespace_name, const char* const& class_name);
 
 	template <typename...Args>
@@ -21,40 +132,120 @@ public:
     template <typename...Args>
     MonoObject* RuntimeInvoke(MonoClass* _class, MonoObject* object, const char* const& invokable_name, Args&&... args);
 
-    MonoAssembly* GetAssembly() const {return assembly;}
-    MonoDomain* GetDomain() const {return app_domain;}
+    //resolves a method once per (class, name, parameter count), nullptr if there is none
+    MonoMethod* GetMethod(MonoClass* _class, const char* method_name, int param_count);
+
+    //unmanaged thunk for a hot entry point, skips the mono_runtime_invoke trampoline. empty if the signature does not match.
+    template <typename Ret, typename... Params>
+    ManagedThunk<Ret, Params...> GetUnmanagedThunk(MonoClass* _class, const char* method_name);
+
+    template <typename Ret, typename... Params>
+    Ret InvokeThunk(const ManagedThunk<Ret, Params...>& thunk, Params... params);
+
+    //snapshot of the counters, safe to call while other threads invoke
+    InvokeStats GetInvokeStats() const;
+    //totals plus call counts per cached method
+    void LogInvokeStats() const;
+
+    MonoAssembly* GetAssembly() { EnsureInitialized(); return assembly; }
+    MonoDomain* GetDomain() { EnsureInitialized(); return app_domain; }
+    //nullptr if RuntimeOptions::helper_path was not found
+    MonoAssembly* GetHelperAssembly() { EnsureInitialized(); return helper_assembly; }
 
     void LogMonoObjectFields(MonoObject* obj);
 
-    void HandleMonoException(MonoObject* exception, const char*& class_name);
+    //fields of a class in declaration order. walks the metadata only on first request per class.
+    const MonoClassLayout& GetClassLayout(MonoClass* mono_class);
 
+    //list storage fields of a closed list class, nullptr if the class does not look like a List<T>
+    const MonoListLayout* GetListLayout(MonoClass* list_class);
 
-    struct ObjectConverter
+    //reference fields read and written straight through object memory
+    static MonoObject* GetReferenceField(MonoObject* obj, const MonoFieldLayout& field_layout)
     {
-        void* ConvertToMonoObject(int value);
-        void* ConvertToMonoObject(float value);
-        void* ConvertToMonoObject(const std::string& value);
-    }object_converter;
+        return *reinterpret_cast<MonoObject**>(reinterpret_cast<char*>(obj) + field_layout.offset);
+    }
+
+    static void SetReferenceField(MonoObject* obj, const MonoFieldLayout& field_layout, MonoObject* value)
+    {
+        mono_gc_wbarrier_set_field(obj, reinterpret_cast<char*>(obj) + field_layout.offset, value);
+    }
+
+    void HandleMonoException(MonoObject* exception, const char*& class_name);
+
+    //one mono_runtime_invoke parameter: value types and raw pointers by address, managed references as they are, strings as new MonoStrings
+    template <typename T>
+    void* MarshalArgument(T& arg);
 
 private:
+    bool InitializeSlow();
+    bool Startup();
+
     MonoAssembly* LoadCSharpAssembly(const std::string& assemblyPath);
     void PrintAssemblyTypes();
 
 
     void HandleInnerExceptions(MonoObject* exception);
 
-    template <typename T, typename... Rest>
-    void PrepareArgsVec(std::vector<void*>& args_vec, T&& first, Rest&&... rest);
-
-    void PrepareArgsVec(std::vector<void*>&);
 
     
 
     MonoAssembly* assembly = nullptr;
+    MonoAssembly* helper_assembly = nullptr;
     MonoDomain* root_domain = nullptr;
     MonoDomain* app_domain = nullptr;
+    //backing memory of the libMBIN image, must outlive the domain
+    MappedFile assembly_file;
+
+    nmspp::RuntimeOptions options;
+    nmspp::StartupTimings startup_timings;
+    std::atomic<bool> initialized = false;
+    bool aot_active = false;
+    //a failed startup is not retried, mono cannot be initialized twice in one process
+    bool startup_attempted = false;
+    mutable std::mutex init_mutex;
+
+    struct MethodKey
+    {
+        MonoClass* _class;
+        std::string name;
+        int param_count;
+
+        bool operator==(const MethodKey& other) const { return _class == other._class && param_count == other.param_count && name == other.name; }
+    };
 
+    struct MethodKeyHash
+    {
+        size_t operator()(const MethodKey& key) const
+        {
+            return std::hash<MonoClass*>()(key._class) ^ (std::hash<std::string>()(key.name) << 1) ^ (static_cast<size_t>(key.param_count) << 2);
+        }
+    };
+
+    struct CachedMethod
+    {
+        MonoMethod* method = nullptr;
+        std::atomic<uint64_t> calls = 0;
+    };
+
+    struct AtomicInvokeStats
+    {
+        std::atomic<uint64_t> runtime_invokes = 0;
+        std::atomic<uint64_t> thunk_invokes = 0;
+        std::atomic<uint64_t> method_lookups = 0;
+        std::atomic<uint64_t> method_cache_hits = 0;
+    };
+
+    CachedMethod* FindMethod(MonoClass* _class, const char* method_name, int param_count);
 
+    //the caches are filled lazily from any attached thread. entries are never removed, so references stay valid.
+    std::unordered_map<MethodKey, CachedMethod, MethodKeyHash> method_cache;
+    mutable std::shared_mutex method_cache_mutex;
+    AtomicInvokeStats invoke_stats;
+
+    std::unordered_map<MonoClass*, MonoClassLayout> class_layouts;
+    std::unordered_map<MonoClass*, MonoListLayout> list_layouts;
+    std::shared_mutex layouts_mutex;
 
 };
 
@@ -70,7 +261,7 @@ MonoObject* MonoLayer::CreateInstanceOfClass(MonoClass* mono_class, Args&&... ar
         return nullptr;
     }
 
-    RuntimeInvoke(mono_class, mono_object, ".ctor", std::forward(args)...);
+    RuntimeInvoke(mono_class, mono_object, ".ctor", std::forward<Args>(args)...);
 
     return mono_object;
 }
@@ -78,26 +269,25 @@ MonoObject* MonoLayer::CreateInstanceOfClass(MonoClass* mono_class, Args&&... ar
 template<typename ...Args>
 MonoObject* MonoLayer::RuntimeInvoke(MonoClass* _class, MonoObject* object, const char* const& invokable_name, Args&& ...args)
 {
-    const char* mono_class_name = mono_class_get_name(_class);
-    MonoMethod* invokable = mono_class_get_method_from_name(_class, invokable_name, sizeof...(Args));
+    CachedMethod* invokable = FindMethod(_class, invokable_name, sizeof...(Args));
     if (!invokable)
     {
-        Logger::Error("Invalid parameter arguments for invokable {0}::{1}", mono_class_name, invokable_name);
+        Logger::Error("Invalid parameter arguments for invokable {0}::{1}", mono_class_get_name(_class), invokable_name);
         return nullptr;
     }
 
-    std::vector<void*> args_vector;
-    //Logger::Info("args size: {0}", sizeof...(Args));
-    if(sizeof...(Args) > 0)
-    {
-        PrepareArgsVec(args_vector, std::forward<Args>(args)...);
-    }
+    invokable->calls.fetch_add(1, std::memory_order_relaxed);
+    invoke_stats.runtime_invokes.fetch_add(1, std::memory_order_relaxed);
+
+    //args outlive the call, so value types can be passed by address without copies
+    std::array<void*, sizeof...(Args)> params = { MarshalArgument(args)... };
 
     MonoObject* exception = nullptr;
-    MonoObject* return_object = mono_runtime_invoke(invokable, object, args_vector.empty() ? nullptr : args_vector.data(), &exception); 
+    MonoObject* return_object = mono_runtime_invoke(invokable->method, object, sizeof...(Args) > 0 ? params.data() : nullptr, &exception); 
 
     if (exception)
     {
+        const char* mono_class_name = mono_class_get_name(_class);
         HandleMonoException(exception, mono_class_name);
         return nullptr;
     }
@@ -105,12 +295,103 @@ MonoObject* MonoLayer::RuntimeInvoke(MonoClass* _class, MonoObject* object, cons
     return return_object; 
 }
 
-template <typename T, typename... Rest>
-void MonoLayer::PrepareArgsVec(std::vector<void*>& args_vec, T&& first, Rest&&... rest)
+template <typename Ret, typename... Params>
+ManagedThunk<Ret, Params...> MonoLayer::GetUnmanagedThunk(MonoClass* _class, const char* method_name)
+{
+    ManagedThunk<Ret, Params...> thunk;
+    thunk.name = method_name;
+
+    //the object is passed as first parameter for instance methods, so the managed arity is not known up front
+    MonoMethod* method = GetMethod(_class, method_name, sizeof...(Params));
+    bool is_instance = false;
+    if (!method && sizeof...(Params) > 0)
+    {
+        method = GetMethod(_class, method_name, static_cast<int>(sizeof...(Params)) - 1);
+        is_instance = true;
+    }
+
+    if (!method)
+    {
+        Logger::Error("No method {0}::{1} to create a thunk for", mono_class_get_name(_class), method_name);
+        return thunk;
+    }
+
+    MonoMethodSignature* signature = mono_method_signature(method);
+    if (static_cast<bool>(mono_signature_is_instance(signature)) != is_instance)
+    {
+        Logger::Error("Thunk parameters for {0}::{1} do not match the managed signature", mono_class_get_name(_class), method_name);
+        return thunk;
+    }
+
+    thunk.function = reinterpret_cast<typename ManagedThunk<Ret, Params...>::Function>(mono_method_get_unmanaged_thunk(method));
+    return thunk;
+}
+
+template <typename Ret, typename... Params>
+Ret MonoLayer::InvokeThunk(const ManagedThunk<Ret, Params...>& thunk, Params... params)
 {
-    args_vec.push_back(object_converter.ConvertToMonoObject(std::forward<T>(first)));
+    invoke_stats.thunk_invokes.fetch_add(1, std::memory_order_relaxed);
 
-    PrepareArgsVec(args_vec, std::forward<Rest>(rest)...);
+    const char* thunk_name = thunk.name;
+    MonoException* exception = nullptr;
+    if constexpr (std::is_void_v<Ret>)
+    {
+        thunk.function(params..., &exception);
+        if (exception) HandleMonoException(reinterpret_cast<MonoObject*>(exception), thunk_name);
+    }
+    else
+    {
+        Ret result = thunk.function(params..., &exception);
+        if (exception)
+        {
+            HandleMonoException(reinterpret_cast<MonoObject*>(exception), thunk_name);
+            return Ret{};
+        }
+        return result;
+    }
+}
+
+//handles of managed objects, mono_runtime_invoke takes these as they are
+template <typename T>
+constexpr bool is_managed_reference_v =
+    std::is_same_v<T, MonoObject*> || std::is_same_v<T, MonoString*> || std::is_same_v<T, MonoArray*> ||
+    std::is_same_v<T, MonoException*> || std::is_same_v<T, MonoDelegate*> || std::is_same_v<T, MonoThread*> ||
+    std::is_same_v<T, MonoReflectionType*> || std::is_same_v<T, MonoReflectionMethod*> || std::is_same_v<T, MonoReflectionField*> ||
+    std::is_same_v<T, MonoReflectionProperty*> || std::is_same_v<T, MonoReflectionEvent*> || std::is_same_v<T, MonoReflectionModule*> ||
+    std::is_same_v<T, MonoReflectionAssembly*>;
+
+template <typename T>
+void* MonoLayer::MarshalArgument(T& arg)
+{
+    using ArgType = std::decay_t<T>;
+
+    if constexpr (std::is_arithmetic_v<ArgType> || std::is_enum_v<ArgType>)
+    {
+        return const_cast<ArgType*>(&arg);
+    }
+    else if constexpr (is_managed_reference_v<ArgType>)
+    {
+        return arg;
+    }
+    else if constexpr (std::is_same_v<ArgType, std::string>)
+    {
+        return mono_string_new(app_domain, arg.c_str());
+    }
+    else if constexpr (std::is_same_v<ArgType, const char*> || std::is_same_v<ArgType, char*>)
+    {
+        return mono_string_new(app_domain, arg);
+    }
+    else if constexpr (std::is_pointer_v<ArgType> && (std::is_arithmetic_v<std::remove_cv_t<std::remove_pointer_t<ArgType>>> || std::is_void_v<std::remove_pointer_t<ArgType>>))
+    {
+        //unmanaged pointer parameters (byte*, IntPtr) are passed by address like any other value.
+        //other pointers may be mono handles this does not know, those have to be cast to MonoObject* first
+        return const_cast<void*>(reinterpret_cast<const void*>(&arg));
+    }
+    else
+    {
+        static_assert(!sizeof(T), "Unsupported argument type for RuntimeInvoke");
+        return nullptr;
+    }
 }
 
 extern MonoLayer mono_layer;
\ No newline at end of file
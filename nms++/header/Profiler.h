@@ -0,0 +1,61 @@
+#pragma once
+#include "Runtime.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace nmspp
+{
+	struct MethodProfile
+	{
+		std::string name;
+		uint64_t calls = 0;
+		//inclusive time, recursive calls are counted once per frame
+		double total_ms = 0.0;
+		//total minus the time spent in instrumented callees
+		double self_ms = 0.0;
+		//objects allocated while the method was on top of the stack
+		uint64_t allocations = 0;
+		uint64_t allocated_bytes = 0;
+		uint64_t jit_compilations = 0;
+		double jit_ms = 0.0;
+	};
+
+	struct GcCycleProfile
+	{
+		uint32_t generation = 0;
+		//GC start to GC end
+		double duration_ms = 0.0;
+		//world stopped to world restarted
+		double pause_ms = 0.0;
+	};
+
+	struct ProfileReport
+	{
+		//sorted by self time, slowest first
+		std::vector<MethodProfile> methods;
+		std::vector<GcCycleProfile> gc_cycles;
+		//cycles that did not fit the preallocated cycle buffer
+		uint64_t dropped_gc_cycles = 0;
+		uint64_t allocations = 0;
+		uint64_t allocated_bytes = 0;
+		double jit_ms = 0.0;
+		double gc_pause_ms = 0.0;
+	};
+
+	//aggregates mono profiler events per managed method and per GC cycle. enabled through RuntimeOptions::profiler.
+	class Profiler
+	{
+	public:
+		static bool IsEnabled();
+
+		//merges the per thread data. meant for quiet points, e.g. between batches or before shutdown.
+		static ProfileReport GetReport();
+		static bool WriteJson(const std::string& path);
+		//ProfilerOptions::json_path, if set. called by the runtime before mono is torn down.
+		static void WriteShutdownReport();
+
+		//called by the runtime before mono_jit_init, later calls are ignored
+		static void Install(const ProfilerOptions& options);
+	};
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <type_traits>
+
+namespace nmspp
+{
+	//member path into a generated type, e.g. Path<&GcExternalObjectList::Objects, &GcEnvironmentSpawnData::DistantObjects>.
+	//lists and arrays are stepped through, the member after one belongs to its element type. the last member is read whole.
+	template <auto... Members>
+	struct Path {};
+
+	//the fields a projected load reads, see IO::TryGetProjectedObject. everything else keeps its default value,
+	//except primitives next to a selected field, which come along with the single copy of their object's access plan.
+	template <typename... Paths>
+	struct Projection {};
+
+	namespace projection_traits
+	{
+		template <typename T>
+		struct member_pointer;
+
+		template <typename Owner, typename Member>
+		struct member_pointer<Member Owner::*>
+		{
+			using owner = Owner;
+			using member = Member;
+		};
+
+		template <typename PathType>
+		struct path;
+
+		template <auto Head, auto... Tail>
+		struct path<Path<Head, Tail...>>
+		{
+			static constexpr auto head = Head;
+			using owner = typename member_pointer<decltype(Head)>::owner;
+			using member = typename member_pointer<decltype(Head)>::member;
+			using tail = Path<Tail...>;
+		};
+
+		template <typename ProjectionType, typename Owner>
+		struct starts_at;
+
+		template <typename... Paths, typename Owner>
+		struct starts_at<Projection<Paths...>, Owner> : std::bool_constant<(std::is_same_v<typename path<Paths>::owner, Owner> && ...)> {};
+	}
+
+	template <typename... Paths, typename Func>
+	void ForEachPath(Projection<Paths...>, Func&& func)
+	{
+		(func(Paths{}), ...);
+	}
+}
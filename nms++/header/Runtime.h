@@ -0,0 +1,79 @@
+#pragma once
+#include <string>
+
+namespace nmspp
+{
+	//see Profiler.h. installed during startup, before the JIT compiles anything.
+	struct ProfilerOptions
+	{
+		bool enabled = false;
+		//method enter/leave instrumentation, by far the most expensive part. AOT compiled code is not instrumented.
+		bool calls = true;
+		bool allocations = true;
+		//only instrument methods of assemblies whose name contains this, e.g. "libMBIN". empty instruments everything.
+		std::string assembly_filter;
+		//written when the runtime shuts down, empty to skip
+		std::string json_path = "nms_profile.json";
+	};
+
+	struct RuntimeOptions
+	{
+		//mono trace level: "error", "critical", "warning", "message", "info" or "debug"
+		std::string trace_level = "warning";
+		//comma separated mono trace mask, e.g. "asm,dll". empty keeps the mono default.
+		std::string trace_mask;
+		//directory holding mscorlib and the other framework assemblies
+		std::string assemblies_path = "lib/mono/";
+		//directory and file name of the machine.config for the app domain
+		std::string config_dir = "lib/mono/";
+		std::string config_file = "machine.config";
+		//libMBIN assembly to load
+		std::string dll_path = "libMBIN.dll";
+		//helper assembly built from nms++/managed, moves whole object graphs in one call. skipped if the file is missing.
+		std::string helper_path = "nmspp_helper.dll";
+		//types and enums extracted from dll_path, reused by CSharpInterpreter::GenerateCppWrappers while the dll is unchanged
+		std::string schema_cache_path = "generated/libMBIN.schema";
+
+		//load libMBIN and the framework assemblies from the AOT cache built by Runtime::BuildAotCache.
+		//a missing or stale cache falls back to the JIT. the "aot" trace mask shows which images mono accepted.
+		bool use_aot = false;
+		std::string aot_cache_dir = "lib/aot/";
+		//mono executable of the same version as the embedded runtime, only needed to build the cache
+		std::string aot_compiler = "mono";
+
+		ProfilerOptions profiler;
+	};
+
+	//wall time of each startup phase in milliseconds, all zero until the runtime is up
+	struct StartupTimings
+	{
+		double tracing_ms = 0.0;
+		double jit_init_ms = 0.0;
+		double domain_ms = 0.0;
+		double assembly_load_ms = 0.0;
+		double total_ms = 0.0;
+		//true if the assemblies came from a current AOT cache
+		bool aot = false;
+	};
+
+	//mono is started on first use of the library or by an explicit Initialize call, never during static initialization
+	class Runtime
+	{
+	public:
+		//options for the upcoming startup, ignored with a warning once the runtime is running
+		static void Configure(const RuntimeOptions& options);
+
+		//starts the runtime now instead of on first use. returns false if startup failed.
+		static bool Initialize();
+		static bool Initialize(const RuntimeOptions& options);
+
+		static bool IsInitialized();
+
+		//AOT compiles libMBIN and every assembly it references into options.aot_cache_dir.
+		//meant as a build step, run it from a process that did not start the runtime with use_aot.
+		static bool BuildAotCache();
+
+		static StartupTimings GetStartupTimings();
+		static void LogStartupTimings();
+	};
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
+
+//fixed set of threads that are attached to the mono app domain for their whole lifetime.
+//IO::LoadFile, TryGetNativeObject, PushData and IO::Write may be called from tasks.
+//tasks should hand back native types; MonoObjects kept in futures or heap memory are invisible to the GC.
+class MonoWorkerPool
+{
+public:
+	//thread_count of 0 uses one thread per hardware thread
+	explicit MonoWorkerPool(unsigned int thread_count = 0);
+
+	//finishes queued tasks, then detaches and joins all workers
+	~MonoWorkerPool();
+
+	MonoWorkerPool(const MonoWorkerPool&) = delete;
+	MonoWorkerPool& operator=(const MonoWorkerPool&) = delete;
+
+	template <typename Func>
+	[[nodiscard]] std::future<std::invoke_result_t<Func>> Submit(Func&& task);
+
+	//blocks until the queue is empty and no task is running
+	void WaitIdle();
+
+	unsigned int GetThreadCount() const { return static_cast<unsigned int>(workers.size()); }
+
+private:
+	void WorkerLoop();
+
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> tasks;
+
+	std::mutex mutex;
+	std::condition_variable task_condition;
+	std::condition_variable idle_condition;
+	unsigned int active_tasks = 0;
+	bool stopping = false;
+};
+
+template <typename Func>
+std::future<std::invoke_result_t<Func>> MonoWorkerPool::Submit(Func&& task)
+{
+	using Result = std::invoke_result_t<Func>;
+
+	//std::function needs a copyable target, packaged_task is move only
+	auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<Func>(task));
+	std::future<Result> future = packaged->get_future();
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		tasks.emplace_back([packaged]() { (*packaged)(); });
+	}
+	task_condition.notify_one();
+
+	return future;
+}
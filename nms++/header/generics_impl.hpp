@@ -2,209 +2,250 @@
 
 #include "MonoLayer.h"
 #include "traits_ext.h"
+#include "flat_codec.hpp"
+#include "mbin_codec.hpp"
+#include "mxml_codec.hpp"
+#include "MappedFile.h"
+#include "Projection.h"
 
 #include "../header/Logger.h" 
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+#include <shared_mutex>
+#include <atomic>
+#include <typeinfo>
+#include <filesystem>
 
 
 template<typename NativeType>
 NativeType IO::TryGetNativeObject(ResourceHandle handle)
 {
-	NativeType type{};
-
 	if(!handle.obj)
 	{
 		Logger::Error("[IO, GetNativeObject] Handle with path %s is not valid!", handle.path);
-		return type;
+		return NativeType{};
 	}
 
-	MonoClass* object_class = mono_object_get_class(handle.obj);
+	//one managed call for the whole graph when the helper assembly is loaded
+	NativeType type{};
+	if (ReadFlat(handle.obj, type)) return type;
 
-	std::vector<MonoClassField*> mono_fields;
-	void* iter = nullptr;
-	MonoClassField* field;
+	return ReadObject<NativeType>(handle.obj);
+}
 
-	while ((field = mono_class_get_fields(object_class, &iter)))
-	{
-		mono_fields.push_back(field);
-		// Logger::Info("{0}", mono_field_get_name(field));
-	}
+template<typename NativeType>
+NativeType IO::ReadObject(MonoObject* obj)
+{
+	NativeType type{};
 
-	//if auto is used, this may come in handy
-	constexpr std::size_t field_count = pfr::tuple_size<NativeType>::value;
-	if (field_count != mono_fields.size())
+	MonoClass* object_class = mono_object_get_class(obj);
+
+	const NativeAccessPlan* plan = GetAccessPlan<NativeType>(object_class);
+	if (!plan)
 	{
 		Logger::Error("[IO, GetNativeObject] field count does not match! possibly wrong object -> native type mapping");
 		return NativeType{};
 	}
 
-	// Map fields
+	//primitives and enums are copied straight out of object memory
+	const char* managed_base = reinterpret_cast<const char*>(obj);
+	char* native_base = reinterpret_cast<char*>(&type);
+	for (const NativeAccessPlan::Run& run : plan->runs)
+	{
+		std::memcpy(native_base + run.native_offset, managed_base + run.managed_offset, run.size);
+	}
+
 	std::size_t index = 0;
 	pfr::for_each_field(type, [&](auto& field_value)
 		{
-			MonoClassField* mono_field = mono_fields[index];
+			ReadField(obj, plan->layout->fields[index], field_value);
+			index++;
+		});
 
-			using FieldType = std::decay_t<decltype(field_value)>;
-			using BareFieldType = std::remove_reference_t<decltype(field_value)>;
+	return type;
+}
 
-			if constexpr (std::is_same_v<FieldType, uint32_t>)
-			{
-				uint32_t value;
-				mono_field_get_value(handle.obj, mono_field, &value);
-				field_value = value;
-			}
-			else if constexpr (std::is_same_v<FieldType, int32_t>)
-			{
-				int32_t value;
-				mono_field_get_value(handle.obj, mono_field, &value);
-				field_value = value;
-			}
-			else if constexpr (std::is_same_v<FieldType, uint64_t>)
-			{
-				uint64_t value;
-				mono_field_get_value(handle.obj, mono_field, &value);
-				field_value = value;
-			}
-			else if constexpr (std::is_same_v<FieldType, int64_t>)
-			{
-				int64_t value;
-				mono_field_get_value(handle.obj, mono_field, &value);
-				field_value = value;
-			}
-			else if constexpr (std::is_same_v<FieldType, int16_t>)
-			{
-				int16_t value;
-				mono_field_get_value(handle.obj, mono_field, &value);
-				field_value = value;
-			}
-			else if constexpr (std::is_same_v<FieldType, uint16_t>)
-			{
-				uint16_t value;
-				mono_field_get_value(handle.obj, mono_field, &value);
-				field_value = value;
-			}
-			else if constexpr (std::is_same_v<FieldType, bool>)
-			{
-				bool value;
-				mono_field_get_value(handle.obj, mono_field, &value);
-				field_value = (value != 0);
-			}
-			else if constexpr (std::is_same_v<FieldType, float>)
-			{
-				float value;
-				mono_field_get_value(handle.obj, mono_field, &value);
-				field_value = value;
-			}
-			else if constexpr (std::is_same_v<FieldType, std::string>)
+template<typename FieldType>
+void IO::ReadField(MonoObject* obj, const MonoFieldLayout& field_layout, FieldType& field_value)
+{
+	MonoClassField* mono_field = field_layout.field;
+
+	//the native member of a static field keeps its default
+	if (field_layout.is_static) return;
+
+	if constexpr (traits_ext::is_blittable<FieldType>::value)
+	{
+		//handled by the access plan
+	}
+	else if constexpr (std::is_same_v<FieldType, std::string>)
+	{
+		MonoString* monoStr = reinterpret_cast<MonoString*>(MonoLayer::GetReferenceField(obj, field_layout));
+		if (monoStr)
+		{
+			char* utf8Str = mono_string_to_utf8(monoStr);
+			field_value = utf8Str;
+			mono_free(utf8Str);
+		}
+		else
+		{
+			field_value.clear();
+		}
+	}
+	else if constexpr (std::is_array<FieldType>::value)
+	{
+		using ElementType = std::remove_extent_t<FieldType>;
+		MonoArray* mono_array = reinterpret_cast<MonoArray*>(MonoLayer::GetReferenceField(obj, field_layout));
+		if (mono_array)
+		{
+			constexpr size_t array_size = std::extent_v<FieldType>;
+			const size_t length = std::min<size_t>(mono_array_length(mono_array), array_size);
+
+			if constexpr (traits_ext::is_blittable<ElementType>::value)
 			{
-				MonoString* monoStr;
-				mono_field_get_value(handle.obj, mono_field, &monoStr);
-				if (monoStr)
-				{
-					char* utf8Str = mono_string_to_utf8(monoStr);
-					field_value = utf8Str;
-					mono_free(utf8Str);
-				}
-				else
+				if (field_layout.element_size == sizeof(ElementType))
 				{
-					field_value.clear();
+					std::memcpy(field_value, mono_array_addr_with_size(mono_array, sizeof(ElementType), 0), length * sizeof(ElementType));
 				}
 			}
-			else if constexpr (std::is_array<BareFieldType>::value)
+			else
 			{
-				using ElementType = std::remove_extent_t<BareFieldType>;
-				MonoArray* mono_array;
-				mono_field_get_value(handle.obj, mono_field, &mono_array);
-				if (mono_array)
+				for (size_t i = 0; i < length; i++)
 				{
-					const uint32_t length = static_cast<uint32_t>(mono_array_length(mono_array));
-
-					for (size_t i = 0; i < length; i++)
-					{
-						if constexpr (std::is_class_v<ElementType>)
-						{
-							MonoObject* element_obj = mono_array_get(mono_array, MonoObject*, i);
-							if (element_obj) {
-								field_value[i] = TryGetNativeObject<ElementType>(element_obj);
-							}
-							else {
-								field_value[i] = ElementType{};
-							}
-						}
-						else {
-							ElementType element_value = mono_array_get(mono_array, ElementType, i);
-							field_value[i] = element_value;
-						}
+					MonoObject* element_obj = mono_array_get(mono_array, MonoObject*, i);
+					if (element_obj) {
+						field_value[i] = ReadObject<ElementType>(element_obj);
+					}
+					else {
+						field_value[i] = ElementType{};
 					}
 				}
 			}
-			else if constexpr (std::is_enum_v<FieldType>)
-			{
-				FieldType type{};
-				mono_field_get_value(handle.obj, mono_field, &type);
-				field_value = type;
-			}
-			else if constexpr (traits_ext::is_vector<FieldType>::value)
-			{
-				using ElementType = typename FieldType::value_type;
+		}
+	}
+	else if constexpr (traits_ext::is_vector<FieldType>::value)
+	{
+		MonoObject* list_obj = MonoLayer::GetReferenceField(obj, field_layout);
 
-				MonoObject* list_obj = mono_field_get_value_object(mono_layer.GetDomain(), mono_field, handle.obj);
+		if (list_obj)
+		{
+			ReadList(list_obj, field_value);
+		}
+		else
+		{
+			field_value.clear();
+		}
+	}
+	else if constexpr (std::is_class_v<FieldType>)
+	{
+		//value type fields live inline in the object and have to be boxed first
+		MonoObject* nested_object = field_layout.type_kind == MONO_TYPE_VALUETYPE
+			? mono_field_get_value_object(mono_layer.GetDomain(), mono_field, obj)
+			: MonoLayer::GetReferenceField(obj, field_layout);
+		if (nested_object)
+		{
+			field_value = ReadObject<FieldType>(nested_object);
+		}
+		else
+		{
+			field_value = FieldType{};
+		}
+	}
+}
 
-				if (list_obj)
-				{
-					MonoClass* list_class = mono_object_get_class(list_obj);
-					MonoProperty* count_prop = mono_class_get_property_from_name(list_class, "Count");
-					MonoMethod* get_count_method = mono_property_get_get_method(count_prop);
+template<typename NativeType, typename ProjectionType>
+NativeType IO::TryGetProjectedObject(ResourceHandle handle)
+{
+	if (!handle.obj)
+	{
+		Logger::Error("[IO, TryGetProjectedObject] Handle with path {0} is not valid!", handle.path);
+		return NativeType{};
+	}
 
-					//void* args[] = {};
-					MonoObject* count_obj = mono_runtime_invoke(get_count_method, list_obj, nullptr, nullptr);
-					int count = *(int*)mono_object_unbox(count_obj);
+	//the flat helper always moves the whole graph, a projection is read field by field
+	NativeType type{};
+	ReadProjected<ProjectionType>(handle.obj, type);
 
-					// Get the Item[] property (indexer)
-					MonoMethod* get_item_method = mono_class_get_method_from_name(list_class, "get_Item", 1);
+	return type;
+}
 
-					field_value.reserve(count);
+template<typename ProjectionType, typename NativeType>
+void IO::ReadProjected(MonoObject* obj, NativeType& out)
+{
+	static_assert(nmspp::projection_traits::starts_at<ProjectionType, NativeType>::value, "every path of the projection has to start with a member of this type");
 
-					for (int i = 0; i < count; ++i) {
-						void* index_args[] = { &i };
+	MonoClass* object_class = mono_object_get_class(obj);
 
-						MonoObject* exception = nullptr;
-						MonoObject* item_obj = mono_runtime_invoke(get_item_method, list_obj, index_args, &exception);
+	const NativeAccessPlan* plan = GetAccessPlan<NativeType>(object_class);
+	if (!plan)
+	{
+		Logger::Error("[IO, TryGetProjectedObject] field count does not match! possibly wrong object -> native type mapping");
+		return;
+	}
 
-						const char* list_name = "Generic.List";
-						mono_layer.HandleMonoException(exception, list_name);
+	//primitives are a few memcpys, picking out the selected ones would cost more than copying all of them
+	const char* managed_base = reinterpret_cast<const char*>(obj);
+	char* native_base = reinterpret_cast<char*>(&out);
+	for (const NativeAccessPlan::Run& run : plan->runs)
+	{
+		std::memcpy(native_base + run.native_offset, managed_base + run.managed_offset, run.size);
+	}
 
-						// Process item_obj based on ElementType
-						if constexpr (std::is_class_v<ElementType>) {
-							field_value.push_back(TryGetNativeObject<ElementType>(item_obj));
-						}
-						else {
-							ElementType value = *(ElementType*)mono_object_unbox(item_obj);
-							field_value.push_back(value);
-						}
-					}
-				}
-				else
-				{
-					field_value.clear();
-				}
-			}
-			else if constexpr (std::is_class_v<FieldType>)
-			{
-				MonoObject* nested_object = mono_field_get_value_object(mono_layer.GetDomain(), mono_field, handle.obj);
-				if (nested_object)
-				{
-					field_value = TryGetNativeObject<FieldType>(ResourceHandle(nested_object));
-				}
-				else
+	std::size_t index = 0;
+	pfr::for_each_field(out, [&](auto& field_value)
+		{
+			using FieldType = std::remove_reference_t<decltype(field_value)>;
+
+			nmspp::ForEachPath(ProjectionType{}, [&](auto path)
 				{
-					field_value = FieldType{};
-				}
-			}
+					using PathTraits = nmspp::projection_traits::path<decltype(path)>;
+
+					//paths sharing a member are followed one after another into the same field
+					if constexpr (std::is_same_v<typename PathTraits::member, FieldType>)
+					{
+						if (&(out.*PathTraits::head) == &field_value) ReadPathField<typename PathTraits::tail>(obj, plan->layout->fields[index], field_value);
+					}
+				});
 
 			index++;
 		});
+}
 
-	return type;
+template<typename PathType, typename FieldType>
+void IO::ReadPathField(MonoObject* obj, const MonoFieldLayout& field_layout, FieldType& field_value)
+{
+	if (field_layout.is_static) return;
+
+	if constexpr (std::is_same_v<PathType, nmspp::Path<>>)
+	{
+		ReadField(obj, field_layout, field_value);
+	}
+	else if constexpr (std::is_array<FieldType>::value)
+	{
+		MonoArray* mono_array = reinterpret_cast<MonoArray*>(MonoLayer::GetReferenceField(obj, field_layout));
+		if (!mono_array) return;
+
+		const size_t length = std::min<size_t>(mono_array_length(mono_array), std::extent_v<FieldType>);
+		for (size_t i = 0; i < length; i++)
+		{
+			MonoObject* element_obj = mono_array_get(mono_array, MonoObject*, i);
+			if (element_obj) ReadProjected<nmspp::Projection<PathType>>(element_obj, field_value[i]);
+		}
+	}
+	else if constexpr (traits_ext::is_vector<FieldType>::value)
+	{
+		MonoObject* list_obj = MonoLayer::GetReferenceField(obj, field_layout);
+		if (list_obj) ReadListProjected<nmspp::Projection<PathType>>(list_obj, field_value);
+	}
+	else
+	{
+		static_assert(std::is_class_v<FieldType> && !traits_ext::is_basic_string<FieldType>::value, "a path can only continue through structs and lists or arrays of structs");
+
+		MonoObject* nested_object = field_layout.type_kind == MONO_TYPE_VALUETYPE
+			? mono_field_get_value_object(mono_layer.GetDomain(), field_layout.field, obj)
+			: MonoLayer::GetReferenceField(obj, field_layout);
+		if (nested_object) ReadProjected<nmspp::Projection<PathType>>(nested_object, field_value);
+	}
 }
 
 template<typename NativeType>
@@ -216,83 +257,52 @@ bool IO::PushData(NativeType& native_type, ResourceHandle handle)
 		return false;
 	}
 
-	MonoClass* object_class = mono_object_get_class(handle.obj);
+	if (WriteFlat(native_type, handle.obj)) return true;
 
-	std::vector<MonoClassField*> mono_fields;
-	void* iter = nullptr;
-	MonoClassField* field;
+	return WriteObject(native_type, handle.obj);
+}
 
-	while ((field = mono_class_get_fields(object_class, &iter)))
-	{
-		mono_fields.push_back(field);
-		//Logger::Info("{0}", mono_field_get_name(field));
-	}
+template<typename NativeType>
+bool IO::WriteObject(NativeType& native_type, MonoObject* obj)
+{
+	MonoClass* object_class = mono_object_get_class(obj);
 
-	//if auto is used, this may come in handy
-	constexpr std::size_t field_count = pfr::tuple_size<NativeType>::value;
-	if (field_count != mono_fields.size())
+	const NativeAccessPlan* plan = GetAccessPlan<NativeType>(object_class);
+	if (!plan)
 	{
 		Logger::Error("[IO, PushData] No matching field count results in a no-op.");
 		return false;
 	}
 
+	//primitives and enums hold no references, so they need no write barrier
+	char* managed_base = reinterpret_cast<char*>(obj);
+	const char* native_base = reinterpret_cast<const char*>(&native_type);
+	for (const NativeAccessPlan::Run& run : plan->runs)
+	{
+		std::memcpy(managed_base + run.managed_offset, native_base + run.native_offset, run.size);
+	}
+
 	std::size_t index = 0;
 	pfr::for_each_field(native_type, [&](auto& field_value)
 		{
-			if (index > mono_fields.size() - 1) return;
-
-			MonoClassField* mono_field = mono_fields[index];
+			const MonoFieldLayout& field_layout = plan->layout->fields[index];
+			MonoClassField* mono_field = field_layout.field;
 
 			using FieldType = std::decay_t<decltype(field_value)>;
 			using BareFieldType = std::remove_reference_t<decltype(field_value)>;
-			//using UnderlyingType = typename traits_ext::underlying_type<FieldType>::type; 
-
-			//Logger::Info("{0}", typeid(UnderlyingType).name());
 
-			if constexpr (std::is_same_v<FieldType, uint32_t>)
-			{
-				uint32_t value = field_value;
-				mono_field_set_value(handle.obj, mono_field, &value);
-			}
-			else if constexpr (std::is_same_v<FieldType, int32_t>)
+			if (field_layout.is_static)
 			{
-				int32_t value = field_value;
-				mono_field_set_value(handle.obj, mono_field, &value);
+				//static state is not part of the object, it is left alone
 			}
-			else if constexpr (std::is_same_v<FieldType, uint64_t>)
+			else if constexpr (traits_ext::is_blittable<FieldType>::value)
 			{
-				uint64_t value = field_value;
-				mono_field_set_value(handle.obj, mono_field, &value);
-			}
-			else if constexpr (std::is_same_v<FieldType, int64_t>)
-			{
-				int64_t value = field_value;
-				mono_field_set_value(handle.obj, mono_field, &value);
-			}
-			else if constexpr (std::is_same_v<FieldType, int16_t>)
-			{
-				int16_t value = field_value;
-				mono_field_set_value(handle.obj, mono_field, &value);
-			}
-			else if constexpr (std::is_same_v<FieldType, uint16_t>)
-			{
-				uint16_t value = field_value;
-				mono_field_set_value(handle.obj, mono_field, &value);
-			}
-			else if constexpr (std::is_same_v<FieldType, bool>)
-			{
-				bool value = field_value;
-				mono_field_set_value(handle.obj, mono_field, &value);
-			}
-			else if constexpr (std::is_same_v<FieldType, float>)
-			{
-				float value = field_value;
-				mono_field_set_value(handle.obj, mono_field, &value);
+				//handled by the access plan
 			}
 			else if constexpr (std::is_same_v<FieldType, std::string>)
 			{
 				MonoString* mono_str = mono_string_new(mono_layer.GetDomain(), field_value.c_str());
-				mono_field_set_value(handle.obj, mono_field, mono_str);
+				MonoLayer::SetReferenceField(obj, field_layout, reinterpret_cast<MonoObject*>(mono_str));
 			}
 			else if constexpr (std::is_array<BareFieldType>::value)
 			{
@@ -300,46 +310,50 @@ bool IO::PushData(NativeType& native_type, ResourceHandle handle)
 
 				//Logger::Info("{0}", typeid(ElementType).name());
 
-				MonoType* field_mono_type = mono_field_get_type(mono_field);
-				MonoClass* element_class = mono_type_get_array_type(field_mono_type)->eklass;
+				MonoClass* element_class = field_layout.element_class;
 
 				constexpr size_t array_size = std::extent_v<BareFieldType>;
 
-				if constexpr (std::is_class_v<ElementType>)
+				//a blittable element of another size means the native type does not describe this array, keep what is there
+				if (!std::is_class_v<ElementType> && field_layout.element_size != sizeof(ElementType))
 				{
-					MonoArray* mono_array;
-					mono_field_get_value(handle.obj, mono_field, &mono_array);
-
-					if(mono_array == nullptr)
+					Logger::Error("[IO, WriteObject] Element size mismatch for {0}", field_layout.name);
+				}
+				else
+				{
+					//reuse the managed array when it already has the right length
+					MonoArray* mono_array = reinterpret_cast<MonoArray*>(MonoLayer::GetReferenceField(obj, field_layout));
+					const bool reuse_array = mono_array != nullptr && mono_array_length(mono_array) == array_size;
+					if (!reuse_array)
 					{
 						mono_array = mono_array_new(mono_layer.GetDomain(), element_class, array_size);
-						mono_field_set_value(handle.obj, mono_field, mono_array);
 					}
 
-					for (size_t i = 0; i < array_size; i++)
+					if constexpr (std::is_class_v<ElementType>)
 					{
-						MonoObject* element_obj = mono_object_new(mono_layer.GetDomain(), element_class);
-						PushData(field_value[i], element_obj);
+						for (size_t i = 0; i < array_size; i++)
+						{
+							MonoObject* element_obj = reuse_array ? mono_array_get(mono_array, MonoObject*, i) : nullptr;
+							if (!element_obj)
+							{
+								element_obj = mono_object_new(mono_layer.GetDomain(), element_class);
+								mono_array_setref(mono_array, i, element_obj);
+							}
 
-						mono_array_setref(mono_array, i, element_obj);
+							WriteObject(field_value[i], element_obj);
+						}
 					}
-				}
-				else
-				{
-					MonoArray* mono_array = mono_array_new(mono_layer.GetDomain(), element_class, array_size);
-
-					for (size_t i = 0; i < array_size; i++)
+					else
 					{
-						mono_array_set(mono_array, ElementType, i, field_value[i]);
+						std::memcpy(mono_array_addr_with_size(mono_array, sizeof(ElementType), 0), field_value, array_size * sizeof(ElementType));
 					}
 
-					//MonoObject* element_obj = mono_value_box(mono_layer.GetDomain(), element_class, value_array);
-
-					mono_field_set_value(handle.obj, mono_field, mono_array);
+					if (!reuse_array)
+					{
+						MonoLayer::SetReferenceField(obj, field_layout, reinterpret_cast<MonoObject*>(mono_array));
+					}
 				}
 
-
-
 				//if(!mono_array)
 				//{
 				//    const char* name = mono_field_get_name(mono_field);
@@ -354,19 +368,12 @@ bool IO::PushData(NativeType& native_type, ResourceHandle handle)
 				//}
 
 
-			}
-			else if constexpr (std::is_enum_v<FieldType>)
-			{
-				FieldType type = field_value;
-				mono_field_set_value(handle.obj, mono_field, &type);
 			}
 			else if constexpr (traits_ext::is_vector<FieldType>::value)
 			{
-				using ElementType = typename FieldType::value_type;
-
 				//Logger::Info("{0}", mono_field_get_name(mono_field));
 
-				MonoObject* list_obj = mono_field_get_value_object(mono_layer.GetDomain(), mono_field, handle.obj);
+				MonoObject* list_obj = MonoLayer::GetReferenceField(obj, field_layout);
 
 				if (list_obj == nullptr)
 				{
@@ -383,106 +390,35 @@ bool IO::PushData(NativeType& native_type, ResourceHandle handle)
 					const char* list_class_name = mono_class_get_name(list_class);
 					mono_layer.HandleMonoException(exception, list_class_name);
 
-					mono_field_set_value(handle.obj, mono_field, list_obj);
+					MonoLayer::SetReferenceField(obj, field_layout, list_obj);
 				}
 
-				MonoClass* list_class = mono_object_get_class(list_obj);
-				MonoProperty* count_prop = mono_class_get_property_from_name(list_class, "Count");
-				MonoMethod* get_count_method = mono_property_get_get_method(count_prop);
-				//MonoObject* count_obj = mono_runtime_invoke(get_count_method, list_obj, nullptr, nullptr);
-				//int count = *(int*)mono_object_unbox(count_obj);
-
-				MonoMethod* set_item_method = mono_class_get_method_from_name(list_class, "set_Item", 2);
-				MonoMethod* add_item_method = mono_class_get_method_from_name(list_class, "Add", 1);
-				MonoMethod* get_item_method = mono_class_get_method_from_name(list_class, "get_Item", 1);
-				MonoMethod* clear_list_method = mono_class_get_method_from_name(list_class, "Clear", 0);
-
-				MonoMethodSignature* add_sig = mono_method_signature(add_item_method);
-
-				void* iter = nullptr;
-				MonoType* element_type = mono_signature_get_params(add_sig, &iter);
-
-				MonoClass* element_class = mono_class_from_mono_type(element_type);
-
-				/*int index_p = 0;
-			   void* index_args[] = { &index_p };
-
-
-			   MonoObject* underlying_element_obj = mono_runtime_invoke(get_item_method, list_obj, index_args, nullptr);
-			   MonoClass* element_class = mono_object_get_class(underlying_element_obj);*/
-
-				mono_runtime_invoke(clear_list_method, list_obj, nullptr, nullptr);
-				MonoObject* count_obj = mono_runtime_invoke(get_count_method, list_obj, nullptr, nullptr);
-				int count = *(int*)mono_object_unbox(count_obj);
-				for (int i = 0; i < field_value.size(); ++i)
-				{
-					void* args[1];
-
-					if constexpr (std::is_class_v<ElementType>)
-					{
-						MonoObject* element_obj = mono_object_new(mono_layer.GetDomain(), element_class);
-
-						mono_runtime_object_init(element_obj);
-
-						ElementType& elem = field_value[i];
-
-						//Logger::Info("elem type: {0}", typeid(elem).name());
-
-						PushData(elem, element_obj);
-
-						args[0] = element_obj;
-					}
-					else
-					{
-						//value types
-						MonoObject* boxed_value = mono_value_box(mono_layer.GetDomain(), element_class, (void*)&field_value[i]);
-						if (!boxed_value)
-						{
-							Logger::Error("failed to box value!");
-							continue;
-						}
-
-						args[0] = boxed_value;
-					}
-
-					MonoObject* exception = nullptr;
-					mono_runtime_invoke(add_item_method, list_obj, args, &exception);
-
-					if (exception)
-					{
-						const char* list_class_name = mono_class_get_name(list_class);
-						mono_layer.HandleMonoException(exception, list_class_name);
-					}
-					//}
-
-				}
+				WriteList(list_obj, field_value);
 			}
 			else if constexpr (std::is_class_v<FieldType>)
 			{
 				// Logger::Info("field name: {0}", mono_field_get_name(mono_field));
-				MonoObject* nested_object = mono_field_get_value_object(mono_layer.GetDomain(), mono_field, handle.obj);
-
-				if (nested_object)
+				if (field_layout.type_kind == MONO_TYPE_VALUETYPE)
 				{
-					FieldType field_type = field_value;
-					//field_value = GetNativeObject<FieldType>(nested_object);
-					PushData(field_type, nested_object);
+					//value types live inline, fill a boxed copy and write it back
+					MonoObject* boxed_value = mono_field_get_value_object(mono_layer.GetDomain(), mono_field, obj);
+					WriteObject(field_value, boxed_value);
 
-					mono_field_set_value(handle.obj, mono_field, nested_object);
+					mono_field_set_value(obj, mono_field, mono_object_unbox(boxed_value));
 				}
 				else
 				{
-					// Logger::Critical("Could not find object for {0}", typeid(FieldType).name());
+					MonoObject* nested_object = MonoLayer::GetReferenceField(obj, field_layout);
 
-					MonoType* nested_type = mono_field_get_type(mono_field);
-					MonoClass* nested_class = mono_class_from_mono_type(nested_type);
-					FieldType field_type = field_value;
-
-					nested_object = mono_object_new(mono_layer.GetDomain(), nested_class);
+					if (!nested_object)
+					{
+						// Logger::Critical("Could not find object for {0}", typeid(FieldType).name());
+						nested_object = mono_object_new(mono_layer.GetDomain(), mono_class_from_mono_type(field_layout.type));
 
-					PushData(field_type, nested_object);
+						MonoLayer::SetReferenceField(obj, field_layout, nested_object);
+					}
 
-					mono_field_set_value(handle.obj, mono_field, nested_object);
+					WriteObject(field_value, nested_object);
 				}
 			}
 
@@ -520,6 +456,632 @@ IO::ResourceHandle IO::PushData(NativeType& native_type)
 	return new_resource_handle;
 }
 
+template<typename ElementType>
+void IO::ReadList(MonoObject* list_obj, std::vector<ElementType>& out)
+{
+	MonoClass* list_class = mono_object_get_class(list_obj);
+	const MonoListLayout* list_layout = mono_layer.GetListLayout(list_class);
+
+	if (!list_layout)
+	{
+		ReadListReflected(list_obj, out);
+		return;
+	}
+
+	//read the backing array and size once instead of invoking get_Item per element
+	const char* list_base = reinterpret_cast<const char*>(list_obj);
+	MonoArray* items = *reinterpret_cast<MonoArray* const*>(list_base + list_layout->items_offset);
+	const int32_t size = *reinterpret_cast<const int32_t*>(list_base + list_layout->size_offset);
+
+	out.clear();
+	if (!items || size <= 0) return;
+
+	const size_t count = std::min<size_t>(static_cast<size_t>(size), mono_array_length(items));
+
+	if constexpr (traits_ext::is_blittable<ElementType>::value && !std::is_same_v<ElementType, bool>)
+	{
+		if (list_layout->element_size != sizeof(ElementType))
+		{
+			Logger::Error("[IO, ReadList] Element size mismatch for {0}", mono_class_get_name(list_class));
+			return;
+		}
+
+		out.resize(count);
+		std::memcpy(out.data(), mono_array_addr_with_size(items, sizeof(ElementType), 0), count * sizeof(ElementType));
+	}
+	else if constexpr (std::is_same_v<ElementType, bool>)
+	{
+		out.reserve(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			out.push_back(mono_array_get(items, MonoBoolean, i) != 0);
+		}
+	}
+	else
+	{
+		out.resize(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			//value type elements are stored inline and need a box to be walked like an object
+			MonoObject* element_obj = list_layout->element_is_valuetype
+				? mono_value_box(mono_layer.GetDomain(), list_layout->element_class, mono_array_addr_with_size(items, list_layout->element_size, i))
+				: mono_array_get(items, MonoObject*, i);
+
+			if (element_obj)
+			{
+				out[i] = ReadObject<ElementType>(element_obj);
+			}
+		}
+	}
+}
+
+template<typename ProjectionType, typename ElementType>
+void IO::ReadListProjected(MonoObject* list_obj, std::vector<ElementType>& out)
+{
+	MonoClass* list_class = mono_object_get_class(list_obj);
+	const MonoListLayout* list_layout = mono_layer.GetListLayout(list_class);
+
+	//lists without the expected storage fields are read whole
+	if (!list_layout)
+	{
+		ReadListReflected(list_obj, out);
+		return;
+	}
+
+	const char* list_base = reinterpret_cast<const char*>(list_obj);
+	MonoArray* items = *reinterpret_cast<MonoArray* const*>(list_base + list_layout->items_offset);
+	const int32_t size = *reinterpret_cast<const int32_t*>(list_base + list_layout->size_offset);
+
+	if (!items || size <= 0)
+	{
+		out.clear();
+		return;
+	}
+
+	//resized rather than cleared, an earlier path through this list has filled other fields of the elements
+	const size_t count = std::min<size_t>(static_cast<size_t>(size), mono_array_length(items));
+	out.resize(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		MonoObject* element_obj = list_layout->element_is_valuetype
+			? mono_value_box(mono_layer.GetDomain(), list_layout->element_class, mono_array_addr_with_size(items, list_layout->element_size, i))
+			: mono_array_get(items, MonoObject*, i);
+
+		if (element_obj) ReadProjected<ProjectionType>(element_obj, out[i]);
+	}
+}
+
+template<typename ElementType>
+void IO::ReadListReflected(MonoObject* list_obj, std::vector<ElementType>& out)
+{
+	MonoClass* list_class = mono_object_get_class(list_obj);
+	MonoProperty* count_prop = mono_class_get_property_from_name(list_class, "Count");
+	MonoMethod* get_count_method = mono_property_get_get_method(count_prop);
+
+	//void* args[] = {};
+	MonoObject* count_obj = mono_runtime_invoke(get_count_method, list_obj, nullptr, nullptr);
+	int count = *(int*)mono_object_unbox(count_obj);
+
+	// Get the Item[] property (indexer)
+	MonoMethod* get_item_method = mono_class_get_method_from_name(list_class, "get_Item", 1);
+
+	out.reserve(count);
+
+	for (int i = 0; i < count; ++i) {
+		void* index_args[] = { &i };
+
+		MonoObject* exception = nullptr;
+		MonoObject* item_obj = mono_runtime_invoke(get_item_method, list_obj, index_args, &exception);
+
+		const char* list_name = "Generic.List";
+		mono_layer.HandleMonoException(exception, list_name);
+
+		// Process item_obj based on ElementType
+		if constexpr (std::is_class_v<ElementType>) {
+			out.push_back(ReadObject<ElementType>(item_obj));
+		}
+		else {
+			ElementType value = *(ElementType*)mono_object_unbox(item_obj);
+			out.push_back(value);
+		}
+	}
+}
+
+template<typename ElementType>
+void IO::WriteList(MonoObject* list_obj, std::vector<ElementType>& values)
+{
+	MonoClass* list_class = mono_object_get_class(list_obj);
+	const MonoListLayout* list_layout = mono_layer.GetListLayout(list_class);
+
+	if (!list_layout)
+	{
+		WriteListReflected(list_obj, values);
+		return;
+	}
+
+	if constexpr (traits_ext::is_blittable<ElementType>::value && !std::is_same_v<ElementType, bool>)
+	{
+		if (list_layout->element_size != sizeof(ElementType))
+		{
+			Logger::Error("[IO, WriteList] Element size mismatch for {0}", mono_class_get_name(list_class));
+			return;
+		}
+	}
+
+	char* list_base = reinterpret_cast<char*>(list_obj);
+	MonoArray* items = *reinterpret_cast<MonoArray**>(list_base + list_layout->items_offset);
+	int32_t& size = *reinterpret_cast<int32_t*>(list_base + list_layout->size_offset);
+
+	const size_t count = values.size();
+	const size_t old_size = items ? std::min<size_t>(static_cast<size_t>(std::max(size, 0)), mono_array_length(items)) : 0;
+
+	//size the backing array once, the old one is kept if it is large enough
+	MonoArray* new_items = items;
+	if (!items || mono_array_length(items) < count)
+	{
+		new_items = mono_array_new(mono_layer.GetDomain(), list_layout->element_class, std::max<size_t>(count, 4));
+	}
+
+	if constexpr (traits_ext::is_blittable<ElementType>::value && !std::is_same_v<ElementType, bool>)
+	{
+		if (count > 0)
+		{
+			std::memcpy(mono_array_addr_with_size(new_items, sizeof(ElementType), 0), values.data(), count * sizeof(ElementType));
+		}
+	}
+	else if constexpr (std::is_same_v<ElementType, bool>)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			//bool[] elements are one byte MonoBooleans, mono_bool is 4 bytes wide
+			mono_array_set(new_items, MonoBoolean, i, values[i] ? 1 : 0);
+		}
+	}
+	else
+	{
+		MonoClass* element_class = list_layout->element_class;
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (list_layout->element_is_valuetype)
+			{
+				//fill a boxed copy and store it inline
+				MonoObject* boxed_value = mono_object_new(mono_layer.GetDomain(), element_class);
+				WriteObject(values[i], boxed_value);
+				mono_value_copy_array(new_items, static_cast<int>(i), mono_object_unbox(boxed_value), 1);
+				continue;
+			}
+
+			//update the objects the list already holds, only the tail is allocated
+			MonoObject* element_obj = i < old_size ? mono_array_get(items, MonoObject*, i) : nullptr;
+			if (element_obj && mono_object_get_class(element_obj) != element_class) element_obj = nullptr;
+
+			const bool is_new_element = element_obj == nullptr;
+			if (is_new_element)
+			{
+				element_obj = mono_object_new(mono_layer.GetDomain(), element_class);
+				mono_runtime_object_init(element_obj);
+			}
+
+			WriteObject(values[i], element_obj);
+
+			if (is_new_element || new_items != items)
+			{
+				mono_array_setref(new_items, i, element_obj);
+			}
+		}
+
+		//drop references past the new end like List<T>.Clear would, storing null needs no barrier
+		if (new_items == items && old_size > count && !list_layout->element_is_valuetype)
+		{
+			std::memset(mono_array_addr_with_size(items, sizeof(MonoObject*), count), 0, (old_size - count) * sizeof(MonoObject*));
+		}
+	}
+
+	if (new_items != items)
+	{
+		mono_gc_wbarrier_set_field(list_obj, list_base + list_layout->items_offset, reinterpret_cast<MonoObject*>(new_items));
+	}
+
+	size = static_cast<int32_t>(count);
+	if (list_layout->version_offset)
+	{
+		++*reinterpret_cast<int32_t*>(list_base + list_layout->version_offset);
+	}
+}
+
+template<typename ElementType>
+void IO::WriteListReflected(MonoObject* list_obj, std::vector<ElementType>& values)
+{
+	MonoClass* list_class = mono_object_get_class(list_obj);
+	MonoMethod* add_item_method = mono_class_get_method_from_name(list_class, "Add", 1);
+	MonoMethod* clear_list_method = mono_class_get_method_from_name(list_class, "Clear", 0);
+
+	MonoMethodSignature* add_sig = mono_method_signature(add_item_method);
+
+	void* iter = nullptr;
+	MonoType* element_type = mono_signature_get_params(add_sig, &iter);
+
+	MonoClass* element_class = mono_class_from_mono_type(element_type);
+
+	mono_runtime_invoke(clear_list_method, list_obj, nullptr, nullptr);
+	for (size_t i = 0; i < values.size(); ++i)
+	{
+		void* args[1];
+
+		if constexpr (std::is_class_v<ElementType>)
+		{
+			MonoObject* element_obj = mono_object_new(mono_layer.GetDomain(), element_class);
+
+			mono_runtime_object_init(element_obj);
+
+			ElementType& elem = values[i];
+
+			//Logger::Info("elem type: {0}", typeid(elem).name());
+
+			WriteObject(elem, element_obj);
+
+			args[0] = element_obj;
+		}
+		else
+		{
+			//value types
+			MonoObject* boxed_value = mono_value_box(mono_layer.GetDomain(), element_class, (void*)&values[i]);
+			if (!boxed_value)
+			{
+				Logger::Error("failed to box value!");
+				continue;
+			}
+
+			args[0] = boxed_value;
+		}
+
+		MonoObject* exception = nullptr;
+		mono_runtime_invoke(add_item_method, list_obj, args, &exception);
+
+		if (exception)
+		{
+			const char* list_class_name = mono_class_get_name(list_class);
+			mono_layer.HandleMonoException(exception, list_class_name);
+		}
+	}
+}
+
+template<typename NativeType>
+const NativeAccessPlan* IO::GetAccessPlan(MonoClass* mono_class)
+{
+	//plans stay put once built, nested marshalling may still be iterating over one
+	static std::unordered_map<MonoClass*, NativeAccessPlan> plans;
+	static std::shared_mutex plans_mutex;
+	//a native type practically always maps to one managed class, remembered per thread without locking
+	static thread_local MonoClass* last_class = nullptr;
+	static thread_local const NativeAccessPlan* last_plan = nullptr;
+
+	if (last_class == mono_class) return last_plan;
+
+	const NativeAccessPlan* plan = nullptr;
+	{
+		std::shared_lock<std::shared_mutex> lock(plans_mutex);
+
+		auto found = plans.find(mono_class);
+		if (found != plans.end()) plan = &found->second;
+	}
+
+	if (!plan)
+	{
+		NativeAccessPlan built_plan = BuildAccessPlan<NativeType>(mono_class);
+
+		std::unique_lock<std::shared_mutex> lock(plans_mutex);
+		plan = &plans.emplace(mono_class, std::move(built_plan)).first->second;
+	}
+
+	last_class = mono_class;
+	//a plan without layout marks a field count mismatch
+	last_plan = plan->layout ? plan : nullptr;
+
+	return last_plan;
+}
+
+template<typename NativeType>
+NativeAccessPlan IO::BuildAccessPlan(MonoClass* mono_class)
+{
+	NativeAccessPlan plan;
+
+	const MonoClassLayout& layout = mono_layer.GetClassLayout(mono_class);
+
+	constexpr std::size_t field_count = pfr::tuple_size<NativeType>::value;
+	if (field_count != layout.fields.size()) return plan;
+
+	plan.layout = &layout;
+
+	NativeType probe{};
+	const char* probe_base = reinterpret_cast<const char*>(&probe);
+
+	std::size_t index = 0;
+	pfr::for_each_field(probe, [&](auto& field_value)
+		{
+			using FieldType = std::decay_t<decltype(field_value)>;
+			const MonoFieldLayout& field_layout = layout.fields[index++];
+
+			//the offset of a static field points into static storage, not into the object
+			if (field_layout.is_static) return;
+
+			if constexpr (traits_ext::is_blittable<FieldType>::value)
+			{
+				int align = 0;
+				if (mono_type_is_reference(field_layout.type) || mono_type_size(field_layout.type, &align) != static_cast<int>(sizeof(FieldType)))
+				{
+					Logger::Warning("[IO] Size mismatch for {0}.{1}, field will not be marshalled", mono_class_get_name(mono_class), field_layout.name);
+					return;
+				}
+
+				const uint32_t native_offset = static_cast<uint32_t>(reinterpret_cast<const char*>(&field_value) - probe_base);
+				const uint32_t size = static_cast<uint32_t>(sizeof(FieldType));
+
+				//merge with the previous run if both sides are contiguous
+				if (!plan.runs.empty())
+				{
+					NativeAccessPlan::Run& last = plan.runs.back();
+					if (last.managed_offset + last.size == field_layout.offset && last.native_offset + last.size == native_offset)
+					{
+						last.size += size;
+						return;
+					}
+				}
+
+				plan.runs.push_back({ field_layout.offset, native_offset, size });
+			}
+		});
+
+	return plan;
+}
+
+template<typename NativeType>
+bool IO::ReadFlat(MonoObject* obj, NativeType& out)
+{
+	//a type whose graph the helper cannot express, or that does not match its class, is not tried again
+	static std::atomic<bool> unsupported = false;
+	if (!flatten_thunk || unsupported.load(std::memory_order_relaxed)) return false;
+
+	MonoArray* buffer = mono_layer.InvokeThunk(flatten_thunk, obj);
+	if (!buffer)
+	{
+		unsupported.store(true, std::memory_order_relaxed);
+		return false;
+	}
+
+	//the array is referenced from this stack frame, the GC keeps it alive and in place
+	const char* data = mono_array_addr(buffer, char, 0);
+	if (!flat_codec::Decode(data, mono_array_length(buffer), out))
+	{
+		Logger::Warning("[IO] Flat decode of {0} failed, using per field marshalling", typeid(NativeType).name());
+		unsupported.store(true, std::memory_order_relaxed);
+		out = NativeType{};
+		return false;
+	}
+
+	return true;
+}
+
+template<typename NativeType>
+bool IO::WriteFlat(NativeType& native_type, MonoObject* obj)
+{
+	static std::atomic<bool> unsupported = false;
+	if (!rebuild_thunk || unsupported.load(std::memory_order_relaxed)) return false;
+
+	flat_codec::Writer writer;
+	flat_codec::Encode(writer, native_type);
+	const std::vector<char>& bytes = writer.Buffer();
+
+	MonoArray* buffer = mono_array_new(mono_layer.GetDomain(), mono_get_byte_class(), bytes.size());
+	std::memcpy(mono_array_addr(buffer, char, 0), bytes.data(), bytes.size());
+
+	//a failed rebuild may leave the object half written, the per field pass below overwrites all of it
+	if (!mono_layer.InvokeThunk(rebuild_thunk, obj, buffer))
+	{
+		Logger::Warning("[IO] Flat rebuild of {0} failed, using per field marshalling", typeid(NativeType).name());
+		unsupported.store(true, std::memory_order_relaxed);
+		return false;
+	}
+
+	return true;
+}
+
+template<typename NativeType>
+void IO::Write(NativeType& native_type, const std::string& path)
+{
+	size_t dot_offset = path.find_last_of('.');
+	std::string extension = dot_offset != std::string::npos ? path.substr(dot_offset) : std::string();
+
+	if constexpr (mbin_codec::is_writable<NativeType>::value)
+	{
+		if (extension == ".MBIN")
+		{
+			mbin_codec::Writer writer;
+			mbin_codec::Encode(writer, native_type);
+
+			const std::vector<char>& bytes = writer.Buffer();
+			WriteBuffer(path, bytes.data(), bytes.size());
+			return;
+		}
+	}
+
+	if constexpr (mxml_codec::is_writable<NativeType>::value)
+	{
+		if (extension == ".MXML")
+		{
+			mxml_codec::Writer writer;
+			mxml_codec::Encode(writer, native_type);
+
+			const std::string& text = writer.Buffer();
+			WriteBuffer(path, text.data(), text.size());
+			return;
+		}
+	}
+
+	ResourceHandle handle = PushData(native_type);
+	Write(handle, path);
+}
+
+template<typename NativeType>
+bool IO::ReadNativeMbin(const std::string& path, NativeType& out)
+{
+	MappedFile file;
+	if (!file.Open(path)) return false;
+
+	if (!mbin_codec::HeaderMatches<NativeType>(file.Data(), file.Size()))
+	{
+		Logger::Error("[IO, ReadNativeMbin] {0} is not an MBIN of {1} in this template version", path, typeid(NativeType).name());
+		return false;
+	}
+
+	if (!mbin_codec::Decode(file.Data(), file.Size(), out))
+	{
+		Logger::Error("[IO, ReadNativeMbin] {0} is truncated", path);
+		return false;
+	}
+
+	return true;
+}
+
+template<typename NativeType>
+bool IO::ReadNativeMbin(BufferView buffer, NativeType& out)
+{
+	const char* data = reinterpret_cast<const char*>(buffer.data);
+	if (!mbin_codec::HeaderMatches<NativeType>(data, buffer.size))
+	{
+		Logger::Error("[IO, ReadNativeMbin] Buffer is not an MBIN of {0} in this template version", typeid(NativeType).name());
+		return false;
+	}
+
+	if (!mbin_codec::Decode(data, buffer.size, out))
+	{
+		Logger::Error("[IO, ReadNativeMbin] Buffer is truncated");
+		return false;
+	}
+
+	return true;
+}
+
+template<typename NativeType>
+std::vector<NativeType> IO::ReadNativeMbinDirectory(const std::string& directory)
+{
+	std::vector<NativeType> natives;
+
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+	{
+		if (!entry.is_regular_file() || entry.path().extension() != ".MBIN") continue;
+
+		MappedFile file;
+		if (!file.Open(entry.path().string())) continue;
+
+		//only the header is touched for other templates
+		if (!mbin_codec::HeaderMatches<NativeType>(file.Data(), file.Size())) continue;
+
+		NativeType native{};
+		if (!mbin_codec::Decode(file.Data(), file.Size(), native))
+		{
+			Logger::Error("[IO, ReadNativeMbinDirectory] {0} is truncated", entry.path().string());
+			continue;
+		}
+
+		natives.push_back(std::move(native));
+	}
+
+	if (error) Logger::Error("[IO, ReadNativeMbinDirectory] Could not read directory {0}", directory);
+
+	return natives;
+}
+
+template<typename ViewType>
+bool IO::OpenMbinView(const std::string& path, MappedFile& file, ViewType& out)
+{
+	if (!file.Open(path)) return false;
+
+	if (!mbin_codec::HeaderMatches<typename ViewType::native_type>(file.Data(), file.Size()))
+	{
+		Logger::Error("[IO, OpenMbinView] {0} is not an MBIN of {1} in this template version", path, typeid(typename ViewType::native_type).name());
+		return false;
+	}
+
+	if (!mbin_codec::OpenView(file.Data(), file.Size(), out))
+	{
+		Logger::Error("[IO, OpenMbinView] {0} is truncated", path);
+		return false;
+	}
+
+	return true;
+}
+
+template<typename ViewType, typename Visitor>
+void IO::VisitMbinViews(const std::string& directory, Visitor&& visit)
+{
+	MappedFile file;
+
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+	{
+		if (!entry.is_regular_file() || entry.path().extension() != ".MBIN") continue;
+
+		if (!file.Open(entry.path().string())) continue;
+
+		//only the header is touched for other templates
+		if (!mbin_codec::HeaderMatches<typename ViewType::native_type>(file.Data(), file.Size())) continue;
+
+		ViewType view;
+		if (!mbin_codec::OpenView(file.Data(), file.Size(), view))
+		{
+			Logger::Error("[IO, VisitMbinViews] {0} is truncated", entry.path().string());
+			continue;
+		}
+
+		visit(view, entry.path());
+	}
+
+	if (error) Logger::Error("[IO, VisitMbinViews] Could not read directory {0}", directory);
+}
+
+template<typename NativeType>
+bool IO::ReadNativeMxml(const std::string& path, NativeType& out)
+{
+	MappedFile file;
+	if (!file.Open(path)) return false;
+
+	if (!mxml_codec::TemplateMatches<NativeType>(file.Data(), file.Size()))
+	{
+		Logger::Error("[IO, ReadNativeMxml] {0} is not an MXML of {1}", path, typeid(NativeType).name());
+		return false;
+	}
+
+	if (!mxml_codec::Decode(file.Data(), file.Size(), out))
+	{
+		Logger::Error("[IO, ReadNativeMxml] {0} is malformed", path);
+		return false;
+	}
+
+	return true;
+}
+
+template<typename NativeType>
+bool IO::ReadNativeMxml(BufferView buffer, NativeType& out)
+{
+	const char* data = reinterpret_cast<const char*>(buffer.data);
+	if (!mxml_codec::TemplateMatches<NativeType>(data, buffer.size))
+	{
+		Logger::Error("[IO, ReadNativeMxml] Buffer is not an MXML of {0}", typeid(NativeType).name());
+		return false;
+	}
+
+	if (!mxml_codec::Decode(data, buffer.size, out))
+	{
+		Logger::Error("[IO, ReadNativeMxml] Buffer is malformed");
+		return false;
+	}
+
+	return true;
+}
+
 template<typename NativeType, typename Func>
 void IO::ImmediateEdit(IO::ResourceHandle& handle, Func&& edit)
 {
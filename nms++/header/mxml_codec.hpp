@@ -0,0 +1,1126 @@
+#pragma once
+
+#include "traits_ext.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <type_traits>
+
+#define FMT_HEADER_ONLY
+#include "../external/fmt/include/fmt/format.h"
+
+//runtime half of the generated MXML reader and writer, see CSharpInterpreter::GenerateMxmlCodec.
+//the generated header specializes Names for every type and enum and adds ReadProperty and WriteProperty overloads per type to this namespace,
+//calls from here find them through the Reader or Writer argument at instantiation.
+namespace mxml_codec
+{
+	//FNV-1a with a murmur finalizer, computed once per name
+	constexpr uint32_t Mix(uint32_t hash)
+	{
+		hash ^= hash >> 16;
+		hash *= 0x85EBCA6Bu;
+		hash ^= hash >> 13;
+		hash *= 0xC2B2AE35u;
+		hash ^= hash >> 16;
+		return hash;
+	}
+
+	constexpr uint32_t Hash(std::string_view text)
+	{
+		uint32_t hash = 2166136261u;
+		for (char c : text)
+		{
+			hash ^= static_cast<uint8_t>(c);
+			hash *= 16777619u;
+		}
+
+		return Mix(hash);
+	}
+
+	//hash and displace: the name hash picks a bucket, the seed of the bucket places the name in its own slot.
+	//the generator searches the seeds with these functions, so both sides have to stay the same.
+	constexpr size_t BucketIndex(uint32_t hash, size_t bucket_count) { return hash & (bucket_count - 1); }
+	constexpr size_t SlotIndex(uint32_t hash, uint32_t seed, size_t slot_count) { return Mix(hash ^ seed) & (slot_count - 1); }
+
+	struct NameSlot
+	{
+		std::string_view name;
+		int64_t value = -1;
+	};
+
+	//perfect hash table of MXML names, property name to field index for types and entry name to value for enums.
+	//power of two buckets (seeds) and slots arrays, generated per table.
+	//enums also get their entries sorted by value for the writer, and whether they are flags.
+	template <typename T>
+	struct Names;
+
+	//MBINCompiler version of the libMBIN the codec was generated from, libMBIN writes it into a comment.
+	//defined by the generated header, T only defers the lookup until then.
+	template <typename T>
+	struct CompilerVersion;
+
+	//Byte[] fields are a single base64 value
+	constexpr char base64_digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+	//nullptr if the name is not in the table
+	template <typename T>
+	const NameSlot* Find(std::string_view name)
+	{
+		uint32_t hash = Hash(name);
+		uint32_t seed = Names<T>::buckets[BucketIndex(hash, std::size(Names<T>::buckets))];
+		const NameSlot& slot = Names<T>::slots[SlotIndex(hash, seed, std::size(Names<T>::slots))];
+		return slot.name == name ? &slot : nullptr;
+	}
+
+	//field index of a property, -1 for names the type does not have
+	template <typename T>
+	int64_t Lookup(std::string_view name)
+	{
+		const NameSlot* slot = Find<T>(name);
+		return slot ? slot->value : -1;
+	}
+
+	//one element, the views point into the source buffer and still carry their entities
+	struct Property
+	{
+		std::string_view name;
+		std::string_view value;
+		//LinkableNMSTemplate, the name the template is linked under
+		std::string_view linked;
+		bool has_children = false;
+	};
+
+	//forward only pass over an MXML buffer, nothing is built besides the target. malformed input stops the pass and sets Failed.
+	class Reader
+	{
+	public:
+		Reader(const char* data, size_t size) : cursor(data), end(data + size) {}
+
+		//skips the declaration and comments, root is the <Data> element
+		bool ReadRoot(Property& root, std::string_view& template_name)
+		{
+			if (!NextElement(root, &template_name)) return false;
+			if (root.name != "Data") Fail();
+			return !failed;
+		}
+
+		//next child of parent, false once the end tag of parent is consumed
+		bool Next(const Property& parent, Property& child)
+		{
+			if (!parent.has_children || failed) return false;
+			return NextElement(child, nullptr);
+		}
+
+		//consumes everything below a property that is not read
+		void Skip(const Property& property)
+		{
+			Property child;
+			while (Next(property, child)) Skip(child);
+		}
+
+		template <typename T>
+		void Read(const Property& property, T& out)
+		{
+			if constexpr (std::is_same_v<T, bool>)
+			{
+				if (property.value == "true" || property.value == "True") out = true;
+				else if (property.value == "false" || property.value == "False") out = false;
+				else Fail();
+				Skip(property);
+			}
+			else if constexpr (std::is_floating_point_v<T>)
+			{
+				ReadNumber(property.value, out);
+				Skip(property);
+			}
+			else if constexpr (std::is_integral_v<T>)
+			{
+				ReadInteger(property.value, out);
+				Skip(property);
+			}
+			else if constexpr (std::is_enum_v<T>)
+			{
+				ReadEnum(property.value, out);
+				Skip(property);
+			}
+			else if constexpr (traits_ext::is_basic_string<T>::value)
+			{
+				ReadText(property.value, out);
+				Skip(property);
+			}
+			else if constexpr (traits_ext::is_vector<T>::value)
+			{
+				ReadList(property, out);
+			}
+			else
+			{
+				ReadProperty(*this, property, out);
+			}
+		}
+
+		//elements in order, enum indexed arrays name their elements after the enum instead of _index
+		template <typename T, size_t N>
+		void Read(const Property& property, T (&out)[N])
+		{
+			size_t index = 0;
+			Property child;
+			while (Next(property, child))
+			{
+				if (index < N) Read(child, out[index++]);
+				else Skip(child);
+			}
+		}
+
+		//Colour32 is written as floats in 0..1, libMBIN truncates them back
+		void ReadUnorm8(const Property& property, uint8_t& out)
+		{
+			float value = 0.0f;
+			ReadNumber(property.value, value);
+			out = static_cast<uint8_t>(static_cast<int32_t>(value * 255.0f));
+			Skip(property);
+		}
+
+		template <typename T, size_t N>
+		void ReadBase64(const Property& property, T (&out)[N])
+		{
+			static_assert(sizeof(T) == 1, "base64 is only used for byte arrays");
+
+			size_t count = 0;
+			uint32_t bits = 0;
+			int bit_count = 0;
+			for (char c : property.value)
+			{
+				if (c == '=') break;
+
+				const char* digit = std::strchr(base64_digits, c);
+				if (!digit || c == '\0')
+				{
+					Fail();
+					break;
+				}
+
+				bits = bits << 6 | static_cast<uint32_t>(digit - base64_digits);
+				bit_count += 6;
+				if (bit_count >= 8)
+				{
+					bit_count -= 8;
+					if (count < N) out[count] = static_cast<T>(bits >> bit_count & 0xFF);
+					count++;
+				}
+			}
+
+			Skip(property);
+		}
+
+		//attribute text with its entities resolved
+		void ReadText(std::string_view raw, std::string& out)
+		{
+			size_t amp_pos = raw.find('&');
+			out.assign(raw.data(), std::min(amp_pos, raw.size()));
+			if (amp_pos == std::string_view::npos) return;
+
+			for (size_t i = amp_pos; i < raw.size(); i++)
+			{
+				if (raw[i] != '&')
+				{
+					out += raw[i];
+					continue;
+				}
+
+				size_t semicolon_pos = raw.find(';', i);
+				if (semicolon_pos == std::string_view::npos)
+				{
+					Fail();
+					return;
+				}
+
+				std::string_view entity = raw.substr(i + 1, semicolon_pos - i - 1);
+				if (entity == "amp") out += '&';
+				else if (entity == "lt") out += '<';
+				else if (entity == "gt") out += '>';
+				else if (entity == "quot") out += '"';
+				else if (entity == "apos") out += '\'';
+				else if (!entity.empty() && entity[0] == '#') AppendCodePoint(entity.substr(1), out);
+				else Fail();
+
+				i = semicolon_pos;
+			}
+		}
+
+		bool Failed() const { return failed; }
+		void Fail() { failed = true; }
+
+	private:
+		const char* cursor;
+		const char* end;
+		bool failed = false;
+
+		template <typename T>
+		void ReadNumber(std::string_view text, T& out)
+		{
+			std::from_chars_result result = std::from_chars(text.data(), text.data() + text.size(), out);
+			if (result.ec != std::errc() || result.ptr != text.data() + text.size()) Fail();
+		}
+
+		//parsed at full width, lists of System.Byte come out as int8_t in the generated types
+		template <typename T>
+		void ReadInteger(std::string_view text, T& out)
+		{
+			if (!text.empty() && text[0] == '-')
+			{
+				int64_t value = 0;
+				ReadNumber(text, value);
+				out = static_cast<T>(value);
+			}
+			else
+			{
+				uint64_t value = 0;
+				ReadNumber(text, value);
+				out = static_cast<T>(value);
+			}
+		}
+
+		//an entry name, or several joined by ", " for flags. plain numbers are accepted for values without a name.
+		template <typename T>
+		void ReadEnum(std::string_view text, T& out)
+		{
+			if (!text.empty() && (text[0] == '-' || (text[0] >= '0' && text[0] <= '9')))
+			{
+				std::underlying_type_t<T> value{};
+				ReadInteger(text, value);
+				out = static_cast<T>(value);
+				return;
+			}
+
+			int64_t value = 0;
+			while (!text.empty())
+			{
+				size_t separator_pos = text.find_first_of(",|");
+				std::string_view entry = Trim(text.substr(0, separator_pos));
+
+				const NameSlot* slot = Find<T>(entry);
+				if (!slot)
+				{
+					Fail();
+					return;
+				}
+
+				value |= slot->value;
+				text = separator_pos == std::string_view::npos ? std::string_view() : text.substr(separator_pos + 1);
+			}
+
+			out = static_cast<T>(value);
+		}
+
+		static std::string_view Trim(std::string_view text)
+		{
+			while (!text.empty() && text.front() == ' ') text.remove_prefix(1);
+			while (!text.empty() && text.back() == ' ') text.remove_suffix(1);
+			return text;
+		}
+
+		template <typename T>
+		void ReadList(const Property& property, std::vector<T>& out)
+		{
+			out.clear();
+
+			Property child;
+			while (Next(property, child))
+			{
+				//vector<bool> hands out proxies
+				T value{};
+				Read(child, value);
+				out.push_back(std::move(value));
+			}
+		}
+
+		//&#N; and &#xN; to utf-8
+		void AppendCodePoint(std::string_view digits, std::string& out)
+		{
+			uint32_t code_point = 0;
+			int base = 10;
+			if (!digits.empty() && (digits[0] == 'x' || digits[0] == 'X'))
+			{
+				digits.remove_prefix(1);
+				base = 16;
+			}
+
+			std::from_chars_result result = std::from_chars(digits.data(), digits.data() + digits.size(), code_point, base);
+			if (result.ec != std::errc() || digits.empty() || code_point > 0x10FFFF)
+			{
+				Fail();
+				return;
+			}
+
+			if (code_point < 0x80)
+			{
+				out += static_cast<char>(code_point);
+			}
+			else if (code_point < 0x800)
+			{
+				out += static_cast<char>(0xC0 | code_point >> 6);
+				out += static_cast<char>(0x80 | (code_point & 0x3F));
+			}
+			else if (code_point < 0x10000)
+			{
+				out += static_cast<char>(0xE0 | code_point >> 12);
+				out += static_cast<char>(0x80 | (code_point >> 6 & 0x3F));
+				out += static_cast<char>(0x80 | (code_point & 0x3F));
+			}
+			else
+			{
+				out += static_cast<char>(0xF0 | code_point >> 18);
+				out += static_cast<char>(0x80 | (code_point >> 12 & 0x3F));
+				out += static_cast<char>(0x80 | (code_point >> 6 & 0x3F));
+				out += static_cast<char>(0x80 | (code_point & 0x3F));
+			}
+		}
+
+		bool SkipPast(const char* terminator)
+		{
+			size_t length = std::strlen(terminator);
+			std::string_view rest(cursor, end - cursor);
+			size_t pos = rest.find(std::string_view(terminator, length));
+			if (pos == std::string_view::npos)
+			{
+				Fail();
+				return false;
+			}
+
+			cursor += pos + length;
+			return true;
+		}
+
+		static bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+		void SkipSpace()
+		{
+			while (cursor < end && IsSpace(*cursor)) cursor++;
+		}
+
+		//start tag of the next element at this depth. end tags, text, comments and declarations in between are consumed.
+		bool NextElement(Property& out, std::string_view* template_name)
+		{
+			while (!failed)
+			{
+				const char* tag = static_cast<const char*>(std::memchr(cursor, '<', end - cursor));
+				if (!tag)
+				{
+					Fail();
+					return false;
+				}
+
+				cursor = tag + 1;
+				if (cursor >= end)
+				{
+					Fail();
+					return false;
+				}
+
+				if (*cursor == '/')
+				{
+					SkipPast(">");
+					return false;
+				}
+
+				if (*cursor == '?')
+				{
+					SkipPast("?>");
+					continue;
+				}
+
+				if (*cursor == '!')
+				{
+					SkipPast(cursor + 1 < end && *(cursor + 1) == '-' ? "-->" : ">");
+					continue;
+				}
+
+				return ReadStartTag(out, template_name);
+			}
+
+			return false;
+		}
+
+		bool ReadStartTag(Property& out, std::string_view* template_name)
+		{
+			out = Property();
+
+			const char* name_begin = cursor;
+			while (cursor < end && !IsSpace(*cursor) && *cursor != '/' && *cursor != '>') cursor++;
+			out.name = std::string_view(name_begin, cursor - name_begin);
+			//element names are only needed for the root, properties are named by their attribute
+			bool is_property = out.name == "Property";
+
+			while (true)
+			{
+				SkipSpace();
+				if (cursor >= end)
+				{
+					Fail();
+					return false;
+				}
+
+				if (*cursor == '>')
+				{
+					cursor++;
+					out.has_children = true;
+					return true;
+				}
+
+				if (*cursor == '/')
+				{
+					cursor++;
+					if (cursor >= end || *cursor != '>')
+					{
+						Fail();
+						return false;
+					}
+
+					cursor++;
+					return true;
+				}
+
+				const char* attribute_begin = cursor;
+				while (cursor < end && *cursor != '=' && !IsSpace(*cursor)) cursor++;
+				std::string_view attribute(attribute_begin, cursor - attribute_begin);
+
+				SkipSpace();
+				if (cursor >= end || *cursor != '=')
+				{
+					Fail();
+					return false;
+				}
+				cursor++;
+				SkipSpace();
+				if (cursor >= end || (*cursor != '"' && *cursor != '\''))
+				{
+					Fail();
+					return false;
+				}
+
+				char quote = *cursor++;
+				const char* value_end = static_cast<const char*>(std::memchr(cursor, quote, end - cursor));
+				if (!value_end)
+				{
+					Fail();
+					return false;
+				}
+
+				std::string_view value(cursor, value_end - cursor);
+				cursor = value_end + 1;
+
+				if (attribute == "name" && is_property) out.name = value;
+				else if (attribute == "value") out.value = value;
+				else if (attribute == "linked") out.linked = value;
+				else if (attribute == "template" && template_name) *template_name = value;
+			}
+		}
+	};
+
+	//decimal digits of value rounded to precision significant digits, exponent is the power of ten of the first digit
+	template <typename T>
+	size_t SignificantDigits(T value, int precision, char (&digits)[24], int& exponent)
+	{
+		char text[48];
+		const char* text_end = fmt::format_to_n(text, sizeof(text), "{:.{}e}", std::fabs(value), precision - 1).out;
+
+		size_t count = 0;
+		const char* cursor = text;
+		for (; cursor < text_end && *cursor != 'e'; cursor++)
+		{
+			if (*cursor != '.') digits[count++] = *cursor;
+		}
+
+		//from_chars takes no plus sign
+		if (cursor + 1 < text_end && cursor[1] == '+') cursor++;
+		std::from_chars(cursor + 1, text_end, exponent);
+		return count;
+	}
+
+	//.NET's ToString("0.000000"), the digits are first rounded to the 7 (15 for double) significant digits .NET keeps
+	template <typename T>
+	void AppendFixed(std::string& out, T value)
+	{
+		constexpr int decimals = 6;
+
+		char digits[24];
+		int exponent = 0;
+		int count = static_cast<int>(SignificantDigits(value, std::is_same_v<T, float> ? 7 : 15, digits, exponent));
+		int integer_digits = exponent + 1;
+
+		//rounded half up a second time, on the digits
+		int kept = integer_digits + decimals;
+		if (kept < count)
+		{
+			bool round_up = kept >= 0 && digits[kept] >= '5';
+			count = std::max(kept, 0);
+			if (round_up)
+			{
+				int i = count - 1;
+				while (i >= 0 && digits[i] == '9') digits[i--] = '0';
+
+				if (i >= 0)
+				{
+					digits[i]++;
+				}
+				else
+				{
+					std::memmove(digits + 1, digits, count);
+					digits[0] = '1';
+					count++;
+					integer_digits++;
+				}
+			}
+		}
+
+		if (std::signbit(value)) out += '-';
+
+		if (integer_digits <= 0) out += '0';
+		for (int i = 0; i < integer_digits; i++) out += i < count ? digits[i] : '0';
+
+		out += '.';
+		for (int i = integer_digits; i < integer_digits + decimals; i++) out += i >= 0 && i < count ? digits[i] : '0';
+	}
+
+	//.NET's ToString("G9") for float and ("G17") for double
+	template <typename T>
+	void AppendRoundTrip(std::string& out, T value)
+	{
+		constexpr int precision = std::is_same_v<T, float> ? 9 : 17;
+
+		char digits[24];
+		int exponent = 0;
+		int count = static_cast<int>(SignificantDigits(value, precision, digits, exponent));
+		while (count > 1 && digits[count - 1] == '0') count--;
+
+		if (std::signbit(value)) out += '-';
+
+		if (exponent >= precision || exponent < -4)
+		{
+			out += digits[0];
+			if (count > 1)
+			{
+				out += '.';
+				out.append(digits + 1, count - 1);
+			}
+
+			out += exponent < 0 ? "E-" : "E+";
+			int exponent_magnitude = std::abs(exponent);
+			if (exponent_magnitude < 10) out += '0';
+			fmt::format_int exponent_text(exponent_magnitude);
+			out.append(exponent_text.data(), exponent_text.size());
+		}
+		else if (exponent < 0)
+		{
+			out += "0.";
+			out.append(-exponent - 1, '0');
+			out.append(digits, count);
+		}
+		else
+		{
+			for (int i = 0; i <= exponent; i++) out += i < count ? digits[i] : '0';
+			if (count > exponent + 1)
+			{
+				out += '.';
+				out.append(digits + exponent + 1, count - exponent - 1);
+			}
+		}
+	}
+
+	//libMBIN writes "0.000000" when it reads back to the same value and the shortest round trip form otherwise
+	template <typename T>
+	void AppendNumber(std::string& out, T value)
+	{
+		if (std::isnan(value))
+		{
+			out += "NaN";
+			return;
+		}
+
+		if (std::isinf(value))
+		{
+			out += value < 0 ? "-Infinity" : "Infinity";
+			return;
+		}
+
+		size_t start = out.size();
+		AppendFixed(out, value);
+
+		T parsed{};
+		std::from_chars_result result = std::from_chars(out.data() + start, out.data() + out.size(), parsed);
+		if (result.ec == std::errc() && parsed == value) return;
+
+		out.resize(start);
+		AppendRoundTrip(out, value);
+	}
+
+	//attribute text, escaped the way XmlWriter does
+	inline void AppendEscaped(std::string& out, std::string_view text)
+	{
+		size_t start = 0;
+		for (size_t i = 0; i < text.size(); i++)
+		{
+			std::string_view entity;
+			switch (text[i])
+			{
+			case '&': entity = "&amp;"; break;
+			case '<': entity = "&lt;"; break;
+			case '>': entity = "&gt;"; break;
+			case '"': entity = "&quot;"; break;
+			case '\t': entity = "&#x9;"; break;
+			case '\n': entity = "&#xA;"; break;
+			case '\r': entity = "&#xD;"; break;
+			default: continue;
+			}
+
+			out.append(text.data() + start, i - start);
+			out += entity;
+			start = i + 1;
+		}
+
+		out.append(text.data() + start, text.size() - start);
+	}
+
+	//Enum.ToString: the entry name, the names of the set flags joined by ", ", or the number if neither covers the value
+	template <typename T>
+	void AppendEnum(std::string& out, T value)
+	{
+		using Underlying = std::underlying_type_t<T>;
+		Underlying raw = static_cast<Underlying>(value);
+		uint64_t bits = static_cast<uint64_t>(static_cast<int64_t>(raw));
+
+		//sorted by value as unsigned, the way .NET sorts them
+		const auto& values = Names<T>::values;
+		auto less = [](const NameSlot& slot, uint64_t key) { return static_cast<uint64_t>(slot.value) < key; };
+		auto match = std::lower_bound(std::begin(values), std::end(values), bits, less);
+		if (match != std::end(values) && static_cast<uint64_t>(match->value) == bits)
+		{
+			out += match->name;
+			return;
+		}
+
+		if constexpr (Names<T>::flags)
+		{
+			//highest flags first, written lowest first
+			const NameSlot* found[64];
+			size_t found_count = 0;
+			uint64_t remaining = bits;
+			for (size_t i = std::size(values); i-- > 0 && remaining && found_count < std::size(found);)
+			{
+				uint64_t flag = static_cast<uint64_t>(values[i].value);
+				if (i == 0 && flag == 0) break;
+				if ((remaining & flag) == flag)
+				{
+					remaining -= flag;
+					found[found_count++] = &values[i];
+				}
+			}
+
+			if (!remaining && found_count)
+			{
+				for (size_t i = found_count; i-- > 0;)
+				{
+					out += found[i]->name;
+					if (i) out += ", ";
+				}
+				return;
+			}
+		}
+
+		fmt::format_int number(raw);
+		out.append(number.data(), number.size());
+	}
+
+	//serializes generated types into one growable buffer in the layout libMBIN writes, element by element without building a document.
+	//start tags are finished lazily, a property that ends up without children closes itself.
+	class Writer
+	{
+	public:
+#ifdef _WIN32
+		static constexpr std::string_view new_line = "\r\n";
+#else
+		static constexpr std::string_view new_line = "\n";
+#endif
+
+		//the buffers keep their capacity, a Writer can be reused for any number of files
+		void Clear()
+		{
+			out.clear();
+			depth = 0;
+			tag_open = false;
+			next_index = -1;
+			next_key_size = 0;
+			has_next_key = false;
+		}
+
+		const std::string& Buffer() const { return out; }
+
+		void BeginDocument(std::string_view template_name, std::string_view version)
+		{
+			out += "<?xml version=\"1.0\" encoding=\"utf-8\"?>";
+			out += new_line;
+			out += "<!--File created using MBINCompiler version (";
+			out += version;
+			out += ")-->";
+			out += new_line;
+			out += "<Data template=\"c";
+			AppendEscaped(out, template_name);
+			out += '"';
+
+			tag_open = true;
+			tag_index = -1;
+			tag_has_key = false;
+			depth = 1;
+		}
+
+		void EndDocument()
+		{
+			depth = 0;
+			if (tag_open)
+			{
+				out += " />";
+				tag_open = false;
+			}
+			else
+			{
+				out += "</Data>";
+			}
+		}
+
+		//start tag of a property, the name is already escaped
+		void Begin(std::string_view name)
+		{
+			FinishStartTag();
+
+			out.append(depth, '\t');
+			out += "<Property name=\"";
+			out += name;
+			out += '"';
+
+			tag_open = true;
+			tag_index = next_index;
+			tag_has_key = has_next_key;
+			tag_key_offset = next_key_offset;
+			tag_key_size = next_key_size;
+			next_index = -1;
+			has_next_key = false;
+			depth++;
+		}
+
+		void End()
+		{
+			depth--;
+			if (tag_open)
+			{
+				AppendSuffix();
+				out += " />";
+				tag_open = false;
+			}
+			else
+			{
+				out.append(depth, '\t');
+				out += "</Property>";
+			}
+			out += new_line;
+		}
+
+		//class name of a nested template, already escaped
+		void ClassName(std::string_view name)
+		{
+			out += " value=\"";
+			out += name;
+			out += '"';
+		}
+
+		template <typename T>
+		void Value(const T& value)
+		{
+			out += " value=\"";
+			AppendValue(out, value);
+			out += '"';
+		}
+
+		//LinkableNMSTemplate. libMBIN only writes the link next to its template, the native types only have the link
+		void Linked(std::string_view linked)
+		{
+			if (linked.empty()) return;
+
+			out += " linked=\"";
+			AppendEscaped(out, linked);
+			out += '"';
+		}
+
+		template <typename T>
+		void Write(std::string_view name, const T& value)
+		{
+			if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T> || traits_ext::is_basic_string<T>::value)
+			{
+				Begin(name);
+				Value(value);
+				End();
+			}
+			else if constexpr (traits_ext::is_vector<T>::value)
+			{
+				Begin(name);
+				for (size_t i = 0; i < value.size(); i++)
+				{
+					next_index = static_cast<int64_t>(i);
+					//vector<bool> hands out proxies
+					Write(name, static_cast<const typename T::value_type&>(value[i]));
+				}
+				next_index = -1;
+				End();
+			}
+			else
+			{
+				WriteProperty(*this, name, value);
+			}
+		}
+
+		template <typename T, size_t N>
+		void Write(std::string_view name, const T (&values)[N])
+		{
+			Begin(name);
+			for (size_t i = 0; i < N; i++)
+			{
+				next_index = static_cast<int64_t>(i);
+				Write(name, values[i]);
+			}
+			next_index = -1;
+			End();
+		}
+
+		//enum indexed arrays name their elements after the enum, elements without a name get an _index
+		template <typename T, size_t N>
+		void Write(std::string_view name, const T (&values)[N], const std::string_view (&element_names)[N])
+		{
+			Begin(name);
+			for (size_t i = 0; i < N; i++)
+			{
+				if (element_names[i].empty())
+				{
+					next_index = static_cast<int64_t>(i);
+					Write(name, values[i]);
+				}
+				else
+				{
+					Write(element_names[i], values[i]);
+				}
+			}
+			next_index = -1;
+			End();
+		}
+
+		//HashMap values carry their key as _id. lists of templates with an ID field do too, and number repeated IDs with _index.
+		template <typename T, typename KeyOf>
+		void WriteKeyed(std::string_view name, const std::vector<T>& values, KeyOf key_of, bool number_repeats)
+		{
+			Begin(name);
+
+			size_t keys_base = keys.size();
+			size_t key_text_base = key_text.size();
+			for (const T& element : values)
+			{
+				size_t key_offset = key_text.size();
+				AppendValue(key_text, key_of(element));
+				std::string_view key(key_text.data() + key_offset, key_text.size() - key_offset);
+
+				has_next_key = true;
+				next_key_offset = key_offset;
+				next_key_size = key.size();
+
+				if (number_repeats)
+				{
+					uint32_t hash = Hash(key);
+					auto repeat = std::find_if(keys.begin() + keys_base, keys.end(), [&](const KeyEntry& entry)
+					{
+						return entry.hash == hash && std::string_view(key_text.data() + entry.offset, entry.size) == key;
+					});
+
+					if (repeat == keys.end())
+					{
+						keys.push_back({ hash, key_offset, key.size(), 0 });
+					}
+					else
+					{
+						next_index = ++repeat->count;
+						next_key_offset = repeat->offset;
+						key_text.resize(key_offset);
+					}
+				}
+
+				Write(name, element);
+				has_next_key = false;
+				next_index = -1;
+			}
+
+			keys.resize(keys_base);
+			key_text.resize(key_text_base);
+
+			End();
+		}
+
+		template <typename T, size_t N>
+		void WriteBase64(std::string_view name, const T (&values)[N])
+		{
+			static_assert(sizeof(T) == 1, "base64 is only used for byte arrays");
+
+			Begin(name);
+			out += " value=\"";
+			for (size_t i = 0; i < N; i += 3)
+			{
+				uint32_t bits = static_cast<uint8_t>(values[i]) << 16;
+				if (i + 1 < N) bits |= static_cast<uint8_t>(values[i + 1]) << 8;
+				if (i + 2 < N) bits |= static_cast<uint8_t>(values[i + 2]);
+
+				out += base64_digits[bits >> 18 & 0x3F];
+				out += base64_digits[bits >> 12 & 0x3F];
+				out += i + 1 < N ? base64_digits[bits >> 6 & 0x3F] : '=';
+				out += i + 2 < N ? base64_digits[bits & 0x3F] : '=';
+			}
+			out += '"';
+			End();
+		}
+
+		//Colour32 is written as a Colour, channels in 0..1
+		void WriteUnorm8(std::string_view name, uint8_t value)
+		{
+			Write(name, static_cast<float>(value) / 255.0f);
+		}
+
+	private:
+		std::string out;
+		size_t depth = 0;
+
+		//the start tag still waiting for its _id and _index
+		bool tag_open = false;
+		int64_t tag_index = -1;
+		bool tag_has_key = false;
+		size_t tag_key_offset = 0;
+		size_t tag_key_size = 0;
+
+		//set by lists for the element they write next
+		int64_t next_index = -1;
+		bool has_next_key = false;
+		size_t next_key_offset = 0;
+		size_t next_key_size = 0;
+
+		//keys of the keyed lists being written, nested lists stack on top
+		struct KeyEntry
+		{
+			uint32_t hash;
+			size_t offset;
+			size_t size;
+			int64_t count;
+		};
+		std::vector<KeyEntry> keys;
+		std::string key_text;
+
+		template <typename T>
+		static void AppendValue(std::string& target, const T& value)
+		{
+			if constexpr (std::is_same_v<T, bool>)
+			{
+				target += value ? "true" : "false";
+			}
+			else if constexpr (std::is_floating_point_v<T>)
+			{
+				AppendNumber(target, value);
+			}
+			else if constexpr (std::is_integral_v<T>)
+			{
+				//format_int has no overloads below int
+				fmt::format_int number(static_cast<std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t>>(value));
+				target.append(number.data(), number.size());
+			}
+			else if constexpr (std::is_enum_v<T>)
+			{
+				AppendEnum(target, value);
+			}
+			else
+			{
+				AppendEscaped(target, std::string_view(value));
+			}
+		}
+
+		void AppendSuffix()
+		{
+			if (tag_has_key)
+			{
+				out += " _id=\"";
+				out.append(key_text, tag_key_offset, tag_key_size);
+				out += '"';
+			}
+
+			if (tag_index >= 0)
+			{
+				out += " _index=\"";
+				fmt::format_int index(tag_index);
+				out.append(index.data(), index.size());
+				out += '"';
+			}
+		}
+
+		void FinishStartTag()
+		{
+			if (!tag_open) return;
+
+			AppendSuffix();
+			out += '>';
+			out += new_line;
+			tag_open = false;
+		}
+	};
+
+	//libMBIN writes the class name with a c prefix
+	inline bool IsTemplateName(std::string_view template_name, std::string_view name)
+	{
+		if (!template_name.empty() && template_name[0] == 'c') template_name.remove_prefix(1);
+		return template_name == name;
+	}
+
+	//true if the buffer is an MXML of this template, only the declaration and the root tag are looked at
+	template <typename T>
+	bool TemplateMatches(const char* data, size_t size)
+	{
+		Reader reader(data, size);
+		Property root;
+		std::string_view template_name;
+		return reader.ReadRoot(root, template_name) && IsTemplateName(template_name, Names<T>::name);
+	}
+
+	//whole MXML file, the root holds the fields of the template
+	template <typename T>
+	bool Decode(const char* data, size_t size, T& out)
+	{
+		Reader reader(data, size);
+		Property root;
+		std::string_view template_name;
+		if (!reader.ReadRoot(root, template_name)) return false;
+
+		ReadProperty(reader, root, out);
+		return !reader.Failed();
+	}
+
+	//types with a generated writer, every type written with its fields
+	template <typename T, typename = void>
+	struct is_writable : std::false_type {};
+
+	template <typename T>
+	struct is_writable<T, std::void_t<decltype(WriteFields(std::declval<Writer&>(), std::declval<const T&>()))>> : std::true_type {};
+
+	//whole MXML file, the fields of the template are the children of the root. appends to what the writer already holds.
+	template <typename T>
+	void Encode(Writer& writer, const T& value)
+	{
+		writer.BeginDocument(Names<T>::name, CompilerVersion<T>::value);
+		WriteFields(writer, value);
+		writer.EndDocument();
+	}
+}
@@ -0,0 +1,356 @@
+using System;
+using System.Collections;
+using System.Collections.Generic;
+using System.IO;
+using System.Reflection;
+using System.Text;
+
+namespace NmsPlusPlus
+{
+    //flat binary form of a libMBIN object graph, decoded and encoded on the native side by flat_codec.hpp.
+    //fields are visited in metadata order, the same order mono_class_get_fields reports them in.
+    //
+    //object:     u8 present, u16 field count, per field u8 has value followed by the value
+    //
+    //static fields only keep their slot so the count matches the native type, which has them as members.
+    //their value is never written, and a value the native side sends for one is read and dropped.
+    //primitive:  raw little endian value of the managed size, enums as their underlying type
+    //string:     i32 byte count (-1 for null), utf8 bytes
+    //array/list: i32 element count (-1 for null), elements
+    public static class GraphFlattener
+    {
+        const uint Magic = 0x46534D4E;
+        const ushort Version = 2;
+
+        static readonly Dictionary<Type, FieldInfo[]> fieldCache = new Dictionary<Type, FieldInfo[]>();
+        static readonly Dictionary<Type, Type> listElementCache = new Dictionary<Type, Type>();
+
+        //null if the graph contains a field type the format cannot express
+        public static byte[] Flatten(object root)
+        {
+            try
+            {
+                using (MemoryStream stream = new MemoryStream(4096))
+                using (BinaryWriter writer = new BinaryWriter(stream))
+                {
+                    writer.Write(Magic);
+                    writer.Write(Version);
+                    WriteObject(writer, root);
+                    writer.Flush();
+
+                    return stream.ToArray();
+                }
+            }
+            catch (NotSupportedException e)
+            {
+                LogFailure("Flatten", e);
+                return null;
+            }
+        }
+
+        //fills target from a buffer produced by Flatten or by the native encoder. 1 on success.
+        public static int Rebuild(object target, byte[] buffer)
+        {
+            try
+            {
+                using (BinaryReader reader = new BinaryReader(new MemoryStream(buffer, false)))
+                {
+                    if (reader.ReadUInt32() != Magic || reader.ReadUInt16() != Version) return 0;
+                    if (reader.ReadByte() == 0) return 0;
+
+                    ReadFields(reader, target);
+                    return 1;
+                }
+            }
+            catch (InvalidDataException e)
+            {
+                LogFailure("Rebuild", e);
+                return 0;
+            }
+            catch (EndOfStreamException e)
+            {
+                LogFailure("Rebuild", e);
+                return 0;
+            }
+            catch (NotSupportedException e)
+            {
+                LogFailure("Rebuild", e);
+                return 0;
+            }
+        }
+
+        //the native side falls back to per field marshalling, this only says why
+        static void LogFailure(string operation, Exception e)
+        {
+            Console.Error.WriteLine("[GraphFlattener] " + operation + " failed: " + e.GetType().FullName + ": " + e.Message);
+        }
+
+        static FieldInfo[] GetFields(Type type)
+        {
+            lock (fieldCache)
+            {
+                FieldInfo[] fields;
+                if (!fieldCache.TryGetValue(type, out fields))
+                {
+                    //statics, constants included, are listed for their slot only. mono_class_get_fields and the generated types have them too.
+                    fields = type.GetFields(BindingFlags.DeclaredOnly | BindingFlags.Instance | BindingFlags.Static | BindingFlags.Public | BindingFlags.NonPublic);
+                    Array.Sort(fields, (a, b) => a.MetadataToken.CompareTo(b.MetadataToken));
+                    fieldCache.Add(type, fields);
+                }
+                return fields;
+            }
+        }
+
+        //T of a List<T> or of any class deriving from one, null for everything else
+        static Type GetListElementType(Type type)
+        {
+            lock (listElementCache)
+            {
+                Type element_type;
+                if (!listElementCache.TryGetValue(type, out element_type))
+                {
+                    for (Type current = type; current != null; current = current.BaseType)
+                    {
+                        if (current.IsGenericType && current.GetGenericTypeDefinition() == typeof(List<>))
+                        {
+                            element_type = current.GetGenericArguments()[0];
+                            break;
+                        }
+                    }
+                    listElementCache.Add(type, element_type);
+                }
+                return element_type;
+            }
+        }
+
+        static void WriteObject(BinaryWriter writer, object value)
+        {
+            if (value == null)
+            {
+                writer.Write((byte)0);
+                return;
+            }
+
+            FieldInfo[] fields = GetFields(value.GetType());
+
+            writer.Write((byte)1);
+            writer.Write((ushort)fields.Length);
+            foreach (FieldInfo field in fields)
+            {
+                if (field.IsStatic)
+                {
+                    writer.Write((byte)0);
+                    continue;
+                }
+
+                writer.Write((byte)1);
+                WriteValue(writer, field.FieldType, field.GetValue(value));
+            }
+        }
+
+        static void WriteValue(BinaryWriter writer, Type type, object value)
+        {
+            if (type.IsEnum)
+            {
+                WritePrimitive(writer, Convert.ChangeType(value, Enum.GetUnderlyingType(type)));
+            }
+            else if (type.IsPrimitive)
+            {
+                WritePrimitive(writer, value);
+            }
+            else if (type == typeof(string))
+            {
+                if (value == null)
+                {
+                    writer.Write(-1);
+                    return;
+                }
+
+                byte[] bytes = Encoding.UTF8.GetBytes((string)value);
+                writer.Write(bytes.Length);
+                writer.Write(bytes);
+            }
+            else if (type.IsArray)
+            {
+                Array array = (Array)value;
+                if (array == null)
+                {
+                    writer.Write(-1);
+                    return;
+                }
+
+                Type element_type = type.GetElementType();
+                writer.Write(array.Length);
+
+                if (element_type.IsPrimitive)
+                {
+                    byte[] bytes = new byte[Buffer.ByteLength(array)];
+                    Buffer.BlockCopy(array, 0, bytes, 0, bytes.Length);
+                    writer.Write(bytes);
+                }
+                else
+                {
+                    foreach (object element in array)
+                    {
+                        WriteValue(writer, element_type, element);
+                    }
+                }
+            }
+            else if (GetListElementType(type) != null)
+            {
+                IList list = (IList)value;
+                if (list == null)
+                {
+                    writer.Write(-1);
+                    return;
+                }
+
+                Type element_type = GetListElementType(type);
+                writer.Write(list.Count);
+                foreach (object element in list)
+                {
+                    WriteValue(writer, element_type, element);
+                }
+            }
+            else if (type.IsClass || type.IsValueType)
+            {
+                WriteObject(writer, value);
+            }
+            else
+            {
+                throw new NotSupportedException(type.FullName);
+            }
+        }
+
+        static void WritePrimitive(BinaryWriter writer, object value)
+        {
+            switch (Type.GetTypeCode(value.GetType()))
+            {
+                case TypeCode.Boolean: writer.Write((bool)value); break;
+                case TypeCode.Byte: writer.Write((byte)value); break;
+                case TypeCode.SByte: writer.Write((sbyte)value); break;
+                case TypeCode.Int16: writer.Write((short)value); break;
+                case TypeCode.UInt16: writer.Write((ushort)value); break;
+                //BinaryWriter.Write(char) would write utf8
+                case TypeCode.Char: writer.Write((ushort)(char)value); break;
+                case TypeCode.Int32: writer.Write((int)value); break;
+                case TypeCode.UInt32: writer.Write((uint)value); break;
+                case TypeCode.Int64: writer.Write((long)value); break;
+                case TypeCode.UInt64: writer.Write((ulong)value); break;
+                case TypeCode.Single: writer.Write((float)value); break;
+                case TypeCode.Double: writer.Write((double)value); break;
+                default: throw new NotSupportedException(value.GetType().FullName);
+            }
+        }
+
+        static object ReadPrimitive(BinaryReader reader, Type type)
+        {
+            switch (Type.GetTypeCode(type))
+            {
+                case TypeCode.Boolean: return reader.ReadBoolean();
+                case TypeCode.Byte: return reader.ReadByte();
+                case TypeCode.SByte: return reader.ReadSByte();
+                case TypeCode.Int16: return reader.ReadInt16();
+                case TypeCode.UInt16: return reader.ReadUInt16();
+                case TypeCode.Char: return (char)reader.ReadUInt16();
+                case TypeCode.Int32: return reader.ReadInt32();
+                case TypeCode.UInt32: return reader.ReadUInt32();
+                case TypeCode.Int64: return reader.ReadInt64();
+                case TypeCode.UInt64: return reader.ReadUInt64();
+                case TypeCode.Single: return reader.ReadSingle();
+                case TypeCode.Double: return reader.ReadDouble();
+                default: throw new NotSupportedException(type.FullName);
+            }
+        }
+
+        //existing objects and lists are filled in place, missing ones are created from the declared type
+        static object ReadValue(BinaryReader reader, Type type, object existing)
+        {
+            if (type.IsEnum)
+            {
+                return Enum.ToObject(type, ReadPrimitive(reader, Enum.GetUnderlyingType(type)));
+            }
+            else if (type.IsPrimitive)
+            {
+                return ReadPrimitive(reader, type);
+            }
+            else if (type == typeof(string))
+            {
+                int length = reader.ReadInt32();
+                return length < 0 ? null : Encoding.UTF8.GetString(reader.ReadBytes(length));
+            }
+            else if (type.IsArray)
+            {
+                int length = reader.ReadInt32();
+                if (length < 0) return null;
+
+                Type element_type = type.GetElementType();
+                Array existing_array = existing as Array;
+                Array array = existing_array != null && existing_array.Length == length ? existing_array : Array.CreateInstance(element_type, length);
+
+                if (element_type.IsPrimitive)
+                {
+                    byte[] bytes = reader.ReadBytes(Buffer.ByteLength(array));
+                    Buffer.BlockCopy(bytes, 0, array, 0, bytes.Length);
+                }
+                else
+                {
+                    for (int i = 0; i < length; i++)
+                    {
+                        array.SetValue(ReadValue(reader, element_type, array.GetValue(i)), i);
+                    }
+                }
+                return array;
+            }
+            else if (GetListElementType(type) != null)
+            {
+                int count = reader.ReadInt32();
+                if (count < 0) return null;
+
+                Type element_type = GetListElementType(type);
+                IList list = (IList)(existing ?? Activator.CreateInstance(type));
+                list.Clear();
+                for (int i = 0; i < count; i++)
+                {
+                    list.Add(ReadValue(reader, element_type, null));
+                }
+                return list;
+            }
+            else
+            {
+                if (reader.ReadByte() == 0) return null;
+
+                object target = existing ?? Activator.CreateInstance(type);
+                return ReadFields(reader, target);
+            }
+        }
+
+        //target is boxed for value types, the filled box is returned
+        static object ReadFields(BinaryReader reader, object target)
+        {
+            FieldInfo[] fields = GetFields(target.GetType());
+
+            if (reader.ReadUInt16() != fields.Length)
+            {
+                throw new InvalidDataException(target.GetType().FullName);
+            }
+
+            foreach (FieldInfo field in fields)
+            {
+                byte has_value = reader.ReadByte();
+                if (has_value > 1) throw new InvalidDataException(target.GetType().FullName + "." + field.Name);
+                if (has_value == 0) continue;
+
+                //static state is never touched, the value is read into a fresh object and dropped
+                if (field.IsStatic)
+                {
+                    ReadValue(reader, field.FieldType, null);
+                    continue;
+                }
+
+                field.SetValue(target, ReadValue(reader, field.FieldType, field.GetValue(target)));
+            }
+            return target;
+        }
+    }
+}
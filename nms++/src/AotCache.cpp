@@ -0,0 +1,190 @@
+#include "../header/AotCache.h"
+#include "../header/Logger.h"
+#include "mono/jit/jit.h"
+#include "mono/utils/mono-publib.h"
+#include <filesystem>
+#include <fstream>
+#include <cstdlib>
+#include <charconv>
+
+//extension mono appends to an assembly file name when it looks for its AOT image
+#if defined(_WIN32)
+static constexpr const char* aot_image_extension = ".dll";
+#elif defined(__APPLE__)
+static constexpr const char* aot_image_extension = ".dylib";
+#else
+static constexpr const char* aot_image_extension = ".so";
+#endif
+
+static constexpr const char* manifest_name = "aot.manifest";
+
+std::string AotCache::ManifestPath(const nmspp::RuntimeOptions& options)
+{
+	return (std::filesystem::path(options.aot_cache_dir) / manifest_name).string();
+}
+
+std::string AotCache::ImagePath(const std::string& assembly_path)
+{
+	return assembly_path + aot_image_extension;
+}
+
+std::string AotCache::CachedAssemblyPath(const nmspp::RuntimeOptions& options)
+{
+	std::filesystem::path cached = std::filesystem::path(options.aot_cache_dir) / std::filesystem::path(options.dll_path).filename();
+	return std::filesystem::absolute(cached).string();
+}
+
+std::string AotCache::RuntimeBuild()
+{
+	char* build_info = mono_get_runtime_build_info();
+	std::string result = build_info ? build_info : "";
+	mono_free(build_info);
+
+	return result;
+}
+
+bool AotCache::Stamp(const std::string& path, Entry& entry)
+{
+	std::error_code error;
+	entry.size = std::filesystem::file_size(path, error);
+	if (error) return false;
+
+	auto write_time = std::filesystem::last_write_time(path, error);
+	if (error) return false;
+
+	entry.write_time = static_cast<int64_t>(write_time.time_since_epoch().count());
+	return true;
+}
+
+//manifest layout: first line is the runtime build, then one "file\tsize\twrite time\tsource path" line per assembly
+bool AotCache::IsCurrent(const nmspp::RuntimeOptions& options)
+{
+	std::ifstream manifest(ManifestPath(options));
+	if (!manifest) return false;
+
+	std::string runtime_build;
+	std::getline(manifest, runtime_build);
+	if (runtime_build != RuntimeBuild())
+	{
+		Logger::Info("[AotCache] Built for \"{0}\", runtime is \"{1}\"", runtime_build, RuntimeBuild());
+		return false;
+	}
+
+	bool has_dll = false;
+	std::string dll_name = std::filesystem::path(options.dll_path).filename().string();
+
+	std::string line;
+	while (std::getline(manifest, line))
+	{
+		if (line.empty()) continue;
+
+		size_t first_tab = line.find('\t');
+		size_t second_tab = line.find('\t', first_tab + 1);
+		size_t third_tab = line.find('\t', second_tab + 1);
+		if (third_tab == std::string::npos) return false;
+
+		Entry recorded;
+		recorded.file_name = line.substr(0, first_tab);
+		recorded.source_path = line.substr(third_tab + 1);
+
+		//a manifest that does not parse is as good as none
+		const char* size_end = line.data() + second_tab;
+		const char* write_time_end = line.data() + third_tab;
+		std::from_chars_result size_result = std::from_chars(line.data() + first_tab + 1, size_end, recorded.size);
+		std::from_chars_result write_time_result = std::from_chars(line.data() + second_tab + 1, write_time_end, recorded.write_time);
+		if (size_result.ec != std::errc() || size_result.ptr != size_end || write_time_result.ec != std::errc() || write_time_result.ptr != write_time_end)
+		{
+			Logger::Warning("[AotCache] Malformed manifest line: {0}", line);
+			return false;
+		}
+
+		Entry current;
+		if (!Stamp(recorded.source_path, current) || current.size != recorded.size || current.write_time != recorded.write_time)
+		{
+			Logger::Info("[AotCache] {0} changed since the cache was built", recorded.source_path);
+			return false;
+		}
+
+		std::string cached_path = (std::filesystem::path(options.aot_cache_dir) / recorded.file_name).string();
+		if (!std::filesystem::exists(cached_path) || !std::filesystem::exists(ImagePath(cached_path)))
+		{
+			Logger::Info("[AotCache] {0} or its image is missing", cached_path);
+			return false;
+		}
+
+		if (recorded.file_name == dll_name) has_dll = true;
+	}
+
+	return has_dll;
+}
+
+bool AotCache::Build(const nmspp::RuntimeOptions& options, const std::vector<std::string>& assembly_paths)
+{
+	std::error_code error;
+	std::filesystem::create_directories(options.aot_cache_dir, error);
+	if (error)
+	{
+		Logger::Error("[AotCache] Failed to create {0}", options.aot_cache_dir);
+		return false;
+	}
+
+	//the manifest goes last, an interrupted build leaves no valid cache behind
+	std::filesystem::remove(ManifestPath(options), error);
+
+	std::vector<Entry> entries;
+	entries.reserve(assembly_paths.size());
+
+	//every assembly is copied first, the compiler resolves references from the directory of the assembly it compiles
+	for (const std::string& source : assembly_paths)
+	{
+		Entry entry;
+		entry.source_path = std::filesystem::absolute(source).string();
+		entry.file_name = std::filesystem::path(source).filename().string();
+
+		if (!Stamp(entry.source_path, entry))
+		{
+			Logger::Error("[AotCache] Failed to read {0}", entry.source_path);
+			return false;
+		}
+
+		std::filesystem::path cached = std::filesystem::path(options.aot_cache_dir) / entry.file_name;
+		std::filesystem::copy_file(entry.source_path, cached, std::filesystem::copy_options::overwrite_existing, error);
+		if (error)
+		{
+			Logger::Error("[AotCache] Failed to copy {0} to {1}", entry.source_path, cached.string());
+			return false;
+		}
+
+		entries.push_back(std::move(entry));
+	}
+
+	for (const Entry& entry : entries)
+	{
+		std::string cached = (std::filesystem::path(options.aot_cache_dir) / entry.file_name).string();
+		std::string command = options.aot_compiler + " --aot \"" + cached + "\"";
+
+		Logger::Info("[AotCache] Compiling {0}", entry.file_name);
+		int exit_code = std::system(command.c_str());
+		if (exit_code != 0 || !std::filesystem::exists(ImagePath(cached)))
+		{
+			Logger::Error("[AotCache] \"{0}\" failed with exit code {1}", command, exit_code);
+			return false;
+		}
+	}
+
+	std::ofstream manifest(ManifestPath(options), std::ios::trunc);
+	if (!manifest)
+	{
+		Logger::Error("[AotCache] Failed to write {0}", ManifestPath(options));
+		return false;
+	}
+
+	manifest << RuntimeBuild() << '\n';
+	for (const Entry& entry : entries)
+	{
+		manifest << entry.file_name << '\t' << entry.size << '\t' << entry.write_time << '\t' << entry.source_path << '\n';
+	}
+
+	Logger::Info("[AotCache] Built {0} images in {1}", entries.size(), options.aot_cache_dir);
+	return true;
+}
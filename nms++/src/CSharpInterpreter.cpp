@@ -2,252 +2,421 @@
 #include "../header/engine_io.h"
 #include <sstream>
 #include <set>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <algorithm>
 #include "../header/MonoLayer.h"
+#include "../header/MetadataIndex.h"
+#include "mono/metadata/debug-helpers.h"
+#include "mono/metadata/attrdefs.h"
 
 namespace CSharpInterpreter
 {
-	TypeInfosResult CSharpInterpreter::ExtractTypeInfos()
+	//value of an NMSAttribute property, default if it does not exist
+	template <typename T>
+	static T GetAttributeProperty(MonoObject* attr_instance, const char* property_name)
 	{
-		TypeInfosResult result{};
+		MonoProperty* property = mono_class_get_property_from_name(mono_object_get_class(attr_instance), property_name);
+		if (!property) return T{};
 
-		MonoImage* image = mono_assembly_get_image(mono_layer.GetAssembly());
-		const MonoTableInfo* type_definitions_table = mono_image_get_table_info(image, MONO_TABLE_TYPEDEF);
-		uint32_t type_count = mono_table_info_get_rows(type_definitions_table);
+		MonoObject* value = mono_property_get_value(property, attr_instance, nullptr, nullptr);
+		if (!value) return T{};
+
+		return *reinterpret_cast<T*>(mono_object_unbox(value));
+	}
 
-		const MonoTableInfo* constants_table = mono_image_get_table_info(image, MONO_TABLE_CONSTANT);
-		int constants_count = mono_table_info_get_rows(constants_table);
+	//string NMSAttribute property, empty if it does not exist or is null
+	static std::string GetAttributeString(MonoObject* attr_instance, const char* property_name)
+	{
+		MonoProperty* property = mono_class_get_property_from_name(mono_object_get_class(attr_instance), property_name);
+		if (!property) return {};
+
+		MonoObject* value = mono_property_get_value(property, attr_instance, nullptr, nullptr);
+		if (!value) return {};
+
+		char* chars = mono_string_to_utf8(reinterpret_cast<MonoString*>(value));
+		std::string result = chars;
+		mono_free(chars);
+		return result;
+	}
 
-		for (unsigned int i = 0; i < type_count; i++)
+	static MonoObject* GetNMSAttribute(MonoCustomAttrInfo* attr_info)
+	{
+		for (int i = 0; i < attr_info->num_attrs; i++)
 		{
-			uint32_t data_indexer[MONO_TYPEDEF_SIZE];
-			mono_metadata_decode_row(type_definitions_table, i, data_indexer, MONO_TYPEDEF_SIZE);
-			uint32_t type_token = mono_metadata_make_token(MONO_TABLE_TYPEDEF, i + 1);
+			MonoClass* attr_class = mono_method_get_class(attr_info->attrs[i].ctor);
+			if (strcmp(mono_class_get_name(attr_class), "NMSAttribute") == 0)
+			{
+				return mono_custom_attrs_get_attr(attr_info, attr_class);
+			}
+		}
 
-			MonoClass* type_class = mono_class_get(image, type_token);//mono_class_from_name(image, type_info.namespace_name.c_str(), type_info.name.c_str());
-			if(!type_class) 
+		return nullptr;
+	}
+
+	//signature as in "Namespace.Class:Method(System.Type,string)"
+	static MonoMethod* FindMethodBySignature(MonoClass* mono_class, const char* signature)
+	{
+		MonoMethodDesc* method_desc = mono_method_desc_new(signature, true);
+		MonoMethod* method = mono_method_desc_search_in_class(method_desc, mono_class);
+		mono_method_desc_free(method_desc);
+
+		if (!method) Logger::Error("[CSharpInterpreter] Could not find {0}", signature);
+		return method;
+	}
+
+	//names libMBIN gives the elements of an array with an EnumType or EnumValue
+	static std::vector<std::string> GetArrayElementNames(MonoObject* attr_instance, const FieldInfo& field_info)
+	{
+		std::vector<std::string> names;
+		if (!field_info.size) return names;
+
+		static MonoMethod* get_enum_names = FindMethodBySignature(mono_layer.GetClass("libMBIN", "NMSTemplate"), "libMBIN.NMSTemplate:GetEnumNames(string,int,libMBIN.NMSAttribute)");
+		if (!get_enum_names) return names;
+
+		MonoString* field_name = mono_string_new(mono_layer.GetDomain(), field_info.name.c_str());
+		int32_t length = static_cast<int32_t>(field_info.size);
+		void* params[] = { field_name, &length, attr_instance };
+
+		MonoObject* exception = nullptr;
+		MonoArray* result = reinterpret_cast<MonoArray*>(mono_runtime_invoke(get_enum_names, nullptr, params, &exception));
+		if (exception || !result)
+		{
+			Logger::Warning("[CSharpInterpreter] libMBIN has no element names for {0}, MXML uses _index", field_info.name);
+			return names;
+		}
+
+		for (uintptr_t i = 0; i < mono_array_length(result); i++)
+		{
+			MonoString* name = mono_array_get(result, MonoString*, i);
+			if (!name)
 			{
-				Logger::Warning("[CSharpInterpreter] Could not find class {0}", mono_metadata_string_heap(image, data_indexer[MONO_TYPEDEF_NAME]));
+				names.emplace_back();
 				continue;
 			}
 
-			if(mono_class_is_enum(type_class))
+			char* chars = mono_string_to_utf8(name);
+			names.emplace_back(chars);
+			mono_free(chars);
+		}
+
+		return names;
+	}
+
+	//NMSAttribute properties read through mono, for the defaults and for attributes MetadataIndex cannot decode
+	static NMSAttributeValues GetAttributeValues(MonoObject* attr_instance)
+	{
+		NMSAttributeValues values;
+		values.size = GetAttributeProperty<uint32_t>(attr_instance, "Size");
+		values.alignment = GetAttributeProperty<uint32_t>(attr_instance, "Alignment");
+		values.ignore = GetAttributeProperty<bool>(attr_instance, "Ignore");
+		values.mxml_name = GetAttributeString(attr_instance, "MxmlName");
+		values.index = GetAttributeProperty<int32_t>(attr_instance, "Index");
+		values.key_field = GetAttributeString(attr_instance, "KeyField");
+
+		MonoClass* attr_class = mono_object_get_class(attr_instance);
+		MonoProperty* enum_type = mono_class_get_property_from_name(attr_class, "EnumType");
+		MonoProperty* enum_value = mono_class_get_property_from_name(attr_class, "EnumValue");
+		values.has_enum = (enum_type && mono_property_get_value(enum_type, attr_instance, nullptr, nullptr)) ||
+			(enum_value && mono_property_get_value(enum_value, attr_instance, nullptr, nullptr));
+
+		return values;
+	}
+
+	//NMSAttribute instance of a field, nullptr if it has none
+	static MonoObject* GetFieldNMSAttribute(MonoClass* type_class, MonoClassField* field)
+	{
+		MonoCustomAttrInfo* attr_info = mono_custom_attrs_from_field(type_class, field);
+		if (!attr_info) return nullptr;
+
+		MonoObject* attr_instance = GetNMSAttribute(attr_info);
+		mono_custom_attrs_free(attr_info);
+		return attr_instance;
+	}
+
+	//static libMBIN layout query returning an int, false if it threw
+	static bool InvokeLayoutQuery(MonoMethod* method, void** params, int32_t& out)
+	{
+		MonoObject* exception = nullptr;
+		MonoObject* result = mono_runtime_invoke(method, nullptr, params, &exception);
+		if (exception || !result) return false;
+
+		out = *reinterpret_cast<int32_t*>(mono_object_unbox(result));
+		return true;
+	}
+
+	TypeInfosResult CSharpInterpreter::ExtractTypeInfos()
+	{
+		TypeInfosResult result{};
+
+		MonoImage* image = mono_assembly_get_image(mono_layer.GetAssembly());
+
+		//enums, nesting and NMSAttributes come from the metadata tables, decoded once. mono is only asked for classes and field types.
+		MetadataIndex metadata_index(image);
+		uint32_t type_count = metadata_index.TypeCount();
+
+		//named arguments in an attribute blob are applied over what the attribute constructor sets
+		NMSAttributeValues attribute_defaults;
+		MonoClass* nms_attribute_class = mono_layer.GetClass("libMBIN", "NMSAttribute");
+		if (nms_attribute_class)
+		{
+			MonoObject* default_attribute = mono_object_new(mono_layer.GetDomain(), nms_attribute_class);
+			mono_runtime_object_init(default_attribute);
+			attribute_defaults = GetAttributeValues(default_attribute);
+		}
+
+		for (uint32_t type_row = 1; type_row <= type_count; type_row++)
+		{
+			if (metadata_index.IsEnum(type_row))
 			{
 				EnumInfo enum_info;
-				enum_info.name = mono_class_get_name(type_class);//mono_class_get_name(type_class);
-				
-				MonoClass* nesting_class = mono_class_get_nesting_type(type_class);
-				if(nesting_class)
+				enum_info.name = metadata_index.TypeName(type_row);
+
+				uint32_t nesting_type = metadata_index.EnclosingType(type_row);
+				if (nesting_type)
 				{
-					enum_info.nesting_class_name = mono_class_get_name(nesting_class);
-					enum_info.namespace_name = mono_class_get_namespace(nesting_class);
+					enum_info.nesting_class_name = metadata_index.TypeName(nesting_type);
+					enum_info.namespace_name = metadata_index.TypeNamespace(nesting_type);
 				}
 
-				Logger::Info("[CSharpInterpreter] Identified enum {0}::{1}",enum_info.namespace_name, enum_info.name);
+				Logger::Info("[CSharpInterpreter] Identified enum {0}::{1}", enum_info.namespace_name, enum_info.name);
 
-				void* iter = nullptr;
-				MonoClassField* field;
-				std::unordered_map<uint32_t, std::string> field_token_name_map;
+				enum_info.is_flags = metadata_index.IsFlags(type_row);
+				enum_info.underlying_type = metadata_index.EnumUnderlyingType(type_row);
+				enum_info.entries = metadata_index.EnumEntries(type_row);
 
-				while ((field = mono_class_get_fields(type_class, &iter))) {
-					const char* field_name = mono_field_get_name(field);
-					// skip special fields like 'value__'
-					if (strcmp(field_name, "value__") == 0) continue;
+				result.enum_infos.push_back(std::move(enum_info));
+				continue;
+			}
 
-					uint32_t field_token = mono_class_get_field_token(field);
+			uint32_t type_token = mono_metadata_make_token(MONO_TABLE_TYPEDEF, type_row);
+			MonoClass* type_class = mono_class_get(image, type_token);
+			if(!type_class) 
+			{
+				Logger::Warning("[CSharpInterpreter] Could not find class {0}", metadata_index.TypeName(type_row));
+				continue;
+			}
 
-					field_token_name_map[field_token] = field_name;
-				}
+			TypeInfo type_info;
 
-				for (int i = 0; i < constants_count; ++i) {
-					uint32_t cols[MONO_CONSTANT_SIZE];
-					mono_metadata_decode_row(constants_table, i, cols, MONO_CONSTANT_SIZE);
-
-					uint32_t type = cols[MONO_CONSTANT_TYPE];        // type of the constant
-
-					switch (type) {
-					case MONO_TYPE_I1:
-						enum_info.underlying_type = "int8_t";
-						break;
-					case MONO_TYPE_U1:
-						enum_info.underlying_type = "uint8_t";
-						break;
-					case MONO_TYPE_I2:
-						enum_info.underlying_type = "int16_t";
-						break;
-					case MONO_TYPE_U2:
-						enum_info.underlying_type = "uint16_t";
-						break;
-					case MONO_TYPE_I4:
-						enum_info.underlying_type = "int32_t";
-						break;
-					case MONO_TYPE_U4:
-						enum_info.underlying_type = "uint32_t";
-						break;
-					case MONO_TYPE_I8:
-						enum_info.underlying_type = "int64_t";
-						break;
-					case MONO_TYPE_U8:
-						enum_info.underlying_type = "uint64_t";
-						break;
-					}
+			type_info.name = metadata_index.TypeName(type_row);
+			type_info.namespace_name = metadata_index.TypeNamespace(type_row);
 
-					uint32_t parentIndex = cols[MONO_CONSTANT_PARENT]; // Index into the Field or Param table
-					uint32_t valueIndex = cols[MONO_CONSTANT_VALUE];  // Index into the Blob heap
-
-					uint32_t parentCodedIndex = cols[MONO_CONSTANT_PARENT];
-
-					// Decode the coded index
-					uint32_t tag = parentCodedIndex & 0x3;         // Lower 2 bits for the tag
-					uint32_t index = parentCodedIndex >> 2;        // Remaining bits for the index
-
-					uint32_t tableType;
-					switch (tag) {
-					case 0:
-						tableType = MONO_TABLE_FIELD;
-						break;
-					case 1:
-						tableType = MONO_TABLE_PARAM;
-						break;
-					case 2:
-						tableType = MONO_TABLE_PROPERTY;
-						break;
-					default:
-						continue;  // Skip if tag is not recognized
-					}
+			MonoClass* base_class = mono_class_get_parent(type_class);
+			if (base_class) //most likely to be NMSTemplate
+			{
+				type_info.base_class_name = mono_class_get_name(base_class);
+				type_info.base_class_namespace = mono_class_get_namespace(base_class);
+			}
+			else
+			{
+				Logger::Warning("[CSharpInterpreter] class {0}::{1} does not have a base class, may need handling...", type_info.namespace_name, type_info.name);
+			}
 
-					if (tableType == MONO_TABLE_FIELD) {
-						// construct the full token for the field
-						uint32_t fieldToken = mono_metadata_make_token(MONO_TABLE_FIELD, index);
-
-						// check if this field token is in our enum fields
-						auto it = field_token_name_map.find(fieldToken);
-						if (it != field_token_name_map.end()) {
-							const std::string& fieldName = it->second;
-
-							const char* blob = nullptr;
-							uint32_t blobLength = 0;
-							blob = mono_metadata_blob_heap(image, valueIndex);
-							blobLength = mono_metadata_decode_blob_size(blob, &blob);
-
-							// read based on type
-							int64_t enumValue = 0;
-							switch (type) {
-							case MONO_TYPE_I1:
-								enumValue = *(int8_t*)blob;
-								break;
-							case MONO_TYPE_U1:
-								enumValue = *(uint8_t*)blob;
-								break;
-							case MONO_TYPE_I2:
-								enumValue = *(int16_t*)blob;
-								break;
-							case MONO_TYPE_U2:
-								enumValue = *(uint16_t*)blob;
-								break;
-							case MONO_TYPE_I4:
-								enumValue = *(int32_t*)blob;
-								break;
-							case MONO_TYPE_U4:
-								enumValue = *(uint32_t*)blob;
-								break;
-							case MONO_TYPE_I8:
-								enumValue = *(int64_t*)blob;
-								break;
-							case MONO_TYPE_U8:
-								enumValue = *(uint64_t*)blob;
-								break;
-							default:
-								Logger::Error("[CSharpInterpreter] Unhandled enum underlying type: {0}", (int)type);
-								continue;
-							}
-
-							enum_info.entries.emplace_back(fieldName, enumValue);
-						}
-					}
+			//field processing
+			void* iter = nullptr;
+			MonoClassField* field;
+			while (field = mono_class_get_fields(type_class, &iter))
+			{
+				FieldInfo field_info;
+				field_info.name = mono_field_get_name(field);
+				field_info.mxml_name = field_info.name;
+
+				MonoType* type = mono_field_get_type(field);
+
+				field_info.is_actual_enum = false;
+				if(mono_class_is_enum(mono_class_from_mono_type(mono_field_get_type(field))))
+				{
+					field_info.is_actual_enum = true;
 				}
+				
+				field_info.type_name = mono_type_get_name(type);
 
-				result.enum_infos.push_back(enum_info);
-			}
-			else 
-			{
-				TypeInfo type_info;
+				//statics are not part of the template data
+				field_info.is_serialized = !(mono_field_get_flags(field) & MONO_FIELD_ATTR_STATIC);
 
-				type_info.name = mono_metadata_string_heap(image, data_indexer[MONO_TYPEDEF_NAME]);
-				type_info.namespace_name = mono_metadata_string_heap(image, data_indexer[MONO_TYPEDEF_NAMESPACE]);
+				MonoClass* value_class = mono_class_from_mono_type(type);
+				if (mono_type_get_type(type) == MONO_TYPE_SZARRAY)
+				{
+					value_class = mono_class_get_element_class(value_class);
+				}
+				else if (mono_type_get_type(type) == MONO_TYPE_GENERICINST)
+				{
+					//List<T> keeps its elements in a T[]
+					MonoClassField* items_field = mono_class_get_field_from_name(value_class, "_items");
+					if (items_field) value_class = mono_class_get_element_class(mono_class_from_mono_type(mono_field_get_type(items_field)));
+				}
 
-				MonoClass* base_class = mono_class_get_parent(type_class);
-				if (base_class) //most likely to be NMSTemplate
+				if (mono_class_is_enum(value_class))
 				{
-					type_info.base_class_name = mono_class_get_name(base_class);
-					type_info.base_class_namespace = mono_class_get_namespace(base_class);
+					field_info.enum_size = static_cast<uint32_t>(mono_class_value_size(value_class, nullptr));
 				}
-				else
+
+				//decoded from the attribute blob, an attribute instance is only created when libMBIN has to name array elements
+				uint32_t field_row = mono_metadata_token_index(mono_class_get_field_token(field));
+				NMSAttributeValues attribute_values = attribute_defaults;
+				MonoObject* attr_instance = nullptr;
+				MetadataIndex::AttributeState attribute_state = metadata_index.ReadNMSAttribute(field_row, attribute_values);
+				if (attribute_state == MetadataIndex::AttributeState::Undecodable)
 				{
-					Logger::Warning("[CSharpInterpreter] class {0}::{1} does not have a base class, may need handling...", type_info.namespace_name, type_info.name);
+					attr_instance = GetFieldNMSAttribute(type_class, field);
+					if (attr_instance) attribute_values = GetAttributeValues(attr_instance);
+					else attribute_state = MetadataIndex::AttributeState::None;
 				}
 
-				//field processing
-				void* iter = nullptr;
-				MonoClassField* field;
-				while (field = mono_class_get_fields(type_class, &iter))
+				if (attribute_state != MetadataIndex::AttributeState::None)
 				{
-					FieldInfo field_info;
-					field_info.name = mono_field_get_name(field);
+					//the field is an array.
+					if (attribute_values.size) Logger::Info("[CSharpInterpreter] Found NMSAttribute with size, decoded size of {0}", attribute_values.size);
+					field_info.size = attribute_values.size;
 
-					MonoType* type = mono_field_get_type(field);
+					field_info.alignment = attribute_values.alignment;
+					if (attribute_values.ignore) field_info.is_serialized = false;
+					if (!attribute_values.mxml_name.empty()) field_info.mxml_name = attribute_values.mxml_name;
 
-					field_info.is_actual_enum = false;
-					if(mono_class_is_enum(mono_class_from_mono_type(mono_field_get_type(field))))
+					field_info.index = attribute_values.index;
+					field_info.key_field = attribute_values.key_field;
+					if (mono_type_get_type(type) == MONO_TYPE_SZARRAY && attribute_values.has_enum)
 					{
-						field_info.is_actual_enum = true;
+						if (!attr_instance) attr_instance = GetFieldNMSAttribute(type_class, field);
+						if (attr_instance) field_info.enum_names = GetArrayElementNames(attr_instance, field_info);
 					}
-					
-					field_info.type_name = mono_type_get_name(type);
+				}
 
-					MonoCustomAttrInfo* attr_info = mono_custom_attrs_from_field(type_class, field);
-					if(attr_info)
-					{
-						for (int i = 0; i < attr_info->num_attrs; i++)
-						{
-							MonoCustomAttrEntry entry = attr_info->attrs[i];
-							MonoClass* attr_class = mono_method_get_class(entry.ctor);
-							const char* attr_class_name = mono_class_get_name(attr_class);
-
-							if(strcmp(attr_class_name, "NMSAttribute") == 0)
-							{
-								MonoObject* attr_instance = mono_custom_attrs_get_attr(attr_info, attr_class);
-								if(attr_instance)
-								{
-									MonoProperty* size_property = mono_class_get_property_from_name(attr_class, "Size");
-									if(size_property)
-									{
-										//the field is an array.
-										MonoObject* size_value = mono_property_get_value(size_property, attr_instance, nullptr, nullptr);
-										uint32_t size_value_unboxed = *reinterpret_cast<uint32_t*>(mono_object_unbox(size_value));
-										if(size_value_unboxed) Logger::Info("[CSharpInterpreter] Found NMSAttribute with size, decoded size of {0}", size_value_unboxed);
-										field_info.size = size_value_unboxed;
-									}
-								}
-							}
-						}
-					}
+				type_info.field_infos.push_back(field_info);
+			}
 
-					type_info.field_infos.push_back(field_info);
-				}
+			ExtractBinaryLayout(type_class, type_info);
 
-				//method processing?
-				//...
+			//method processing?
+			//...
 
-				result.type_infos.push_back(type_info);
-			}
+			result.type_infos.push_back(type_info);
 		}
 
 		return result;
 	}
 
+	void ExtractBinaryLayout(MonoClass* type_class, TypeInfo& type_info)
+	{
+		MonoClass* nms_template = mono_layer.GetClass("libMBIN", "NMSTemplate");
+		if (type_class == nms_template || !mono_class_is_subclass_of(type_class, nms_template, false)) return;
+
+		//abstract templates and open generics such as HashMap`1 have no layout of their own
+		if ((mono_class_get_flags(type_class) & MONO_TYPE_ATTR_ABSTRACT) || type_info.name.find('`') != std::string::npos) return;
+
+		//templates that serialize themselves are not described by their field offsets
+		MonoMethod* custom_deserialize = mono_class_get_method_from_name(type_class, "CustomDeserialize", 4);
+		if (custom_deserialize && mono_method_get_class(custom_deserialize) == type_class)
+		{
+			Logger::Info("[CSharpInterpreter] {0} has custom serialization, no native MBIN codec", type_info.name);
+			return;
+		}
+
+		//SizeOf and OffsetOf are overloaded on the parameter type, so they are resolved by signature
+		static MonoMethod* size_of = FindMethodBySignature(nms_template, "libMBIN.NMSTemplate:SizeOf(System.Type)");
+		static MonoMethod* align_of = FindMethodBySignature(nms_template, "libMBIN.NMSTemplate:AlignOf(System.Type)");
+		static MonoMethod* offset_of = FindMethodBySignature(nms_template, "libMBIN.NMSTemplate:OffsetOf(System.Type,string)");
+		if (!size_of || !align_of || !offset_of) return;
+
+		MonoDomain* domain = mono_layer.GetDomain();
+		MonoReflectionType* type_object = mono_type_get_object(domain, mono_class_get_type(type_class));
+
+		int32_t binary_size = 0;
+		int32_t alignment = 0;
+		void* type_params[] = { type_object };
+		if (!InvokeLayoutQuery(size_of, type_params, binary_size) || !InvokeLayoutQuery(align_of, type_params, alignment))
+		{
+			Logger::Warning("[CSharpInterpreter] libMBIN could not lay out {0}, no native MBIN codec", type_info.name);
+			return;
+		}
+
+		for (FieldInfo& field_info : type_info.field_infos)
+		{
+			if (!field_info.is_serialized) continue;
+
+			int32_t offset = 0;
+			void* offset_params[] = { type_object, mono_string_new(domain, field_info.name.c_str()) };
+			if (!InvokeLayoutQuery(offset_of, offset_params, offset))
+			{
+				Logger::Warning("[CSharpInterpreter] libMBIN could not lay out {0}::{1}, no native MBIN codec", type_info.name, field_info.name);
+				return;
+			}
+
+			field_info.offset = static_cast<uint32_t>(offset);
+		}
+
+		//NameHash and GUID identify the template version in the MBIN header
+		MonoCustomAttrInfo* attr_info = mono_custom_attrs_from_class(type_class);
+		if (attr_info)
+		{
+			MonoObject* attr_instance = GetNMSAttribute(attr_info);
+			if (attr_instance)
+			{
+				type_info.name_hash = GetAttributeProperty<uint32_t>(attr_instance, "NameHash");
+				type_info.guid = GetAttributeProperty<uint64_t>(attr_instance, "GUID");
+			}
+
+			mono_custom_attrs_free(attr_info);
+		}
+
+		type_info.binary_size = static_cast<uint32_t>(binary_size);
+		type_info.alignment = static_cast<uint32_t>(alignment);
+		type_info.has_layout = true;
+	}
+
+	MbinHeaderInfo ExtractMbinHeaderInfo()
+	{
+		MbinHeaderInfo header_info;
+
+		MonoClass* mbin_header = mono_layer.GetClass("libMBIN", "MBINHeader");
+		MonoClassField* mbin_version = mono_class_get_field_from_name(mbin_header, "MBIN_VERSION");
+		MonoClassField* header_version = mono_class_get_field_from_name(mbin_header, "MBINCOMPILER_HEADER_VERSION");
+		if (!mbin_version || !header_version)
+		{
+			Logger::Error("[CSharpInterpreter] MBINHeader has no version constants, native MBIN headers will be invalid");
+			return header_info;
+		}
+
+		MonoVTable* vtable = mono_class_vtable(mono_layer.GetDomain(), mbin_header);
+		mono_field_static_get_value(vtable, mbin_version, &header_info.mbin_version);
+		mono_field_static_get_value(vtable, header_version, &header_info.header_version);
+
+		//libMBIN stamps its own version, one byte per part
+		MonoAssemblyName* assembly_name = mono_assembly_get_name(mono_layer.GetAssembly());
+		uint16_t minor = 0, build = 0, revision = 0;
+		uint16_t major = mono_assembly_name_get_version(assembly_name, &minor, &build, &revision);
+		header_info.timestamp = (major & 0xFF) | (minor & 0xFF) << 8 | (build & 0xFF) << 16 | static_cast<uint64_t>(revision & 0xFF) << 24;
+		header_info.compiler_version = fmt::format("{0}.{1:02}.{2}.{3}", major, minor, build, revision);
+
+		return header_info;
+	}
+
+	Schema LoadOrExtractSchema()
+	{
+		//mono is only started when the dll changed since the last extraction
+		const nmspp::RuntimeOptions& options = mono_layer.GetOptions();
+		uint64_t dll_hash = HashFile(options.dll_path);
+
+		Schema schema;
+		if (!dll_hash || !LoadSchema(options.schema_cache_path, dll_hash, schema))
+		{
+			schema.infos = ExtractTypeInfos();
+			schema.header_info = ExtractMbinHeaderInfo();
+			if (dll_hash) SaveSchema(options.schema_cache_path, dll_hash, schema);
+		}
+
+		return schema;
+	}
+
 	void GenerateCppWrappers()
 	{
-		TypeInfosResult infos_result = ExtractTypeInfos();
+		Schema schema = LoadOrExtractSchema();
+
+		TypeInfosResult& infos_result = schema.infos;
+		const MbinHeaderInfo& header_info = schema.header_info;
 
 		std::multimap<std::string, TypeInfo> multimapped_types;
 		for (TypeInfo& type_info : infos_result.type_infos)
@@ -272,70 +441,42 @@ namespace CSharpInterpreter
 			name_namespace_map.emplace(type_info.name, type_info.namespace_name);
 		}
 
-		std::unordered_map<std::string, std::string> write_datas = GenerateTypesStructs(multimapped_types);
-
-		std::unordered_multimap<std::string, EnumInfo> multimapped_enums;
+		//enums are declared inside the struct they are nested in
+		std::unordered_multimap<std::string, const EnumInfo*> nested_enums;
 		for (const EnumInfo& enum_info : infos_result.enum_infos)
 		{
-			multimapped_enums.emplace(enum_info.nesting_class_name, enum_info);
+			nested_enums.emplace(enum_info.nesting_class_name, &enum_info);
 		}
 
-		for (auto iter = write_datas.begin(); iter != write_datas.end(); iter++)
-		{
-			//get possible enum, and insert it into the struct
-			auto range = multimapped_enums.equal_range(iter->first);
-			if (range.first != multimapped_enums.end())
-			{
-				size_t open_bracket_pos = write_datas[iter->first].find_first_of('{');
-				for (auto& it = range.first; it != range.second; ++it)
-				{
-					std::stringstream enum_stringstream;
-					enum_stringstream << "\n\tenum class " << it->second.name << " : " << it->second.underlying_type << "\n\t{\n";
-					for (const std::pair<std::string, uint64_t>& field : it->second.entries)
-					{
-						enum_stringstream << "	\t" << field.first << " = " << field.second << ",\n";
-					}
-					enum_stringstream << "\t};\n";
+		std::unordered_map<std::string, std::string> write_datas = GenerateTypesStructs(multimapped_types, nested_enums);
 
-					write_datas[iter->first].insert(open_bracket_pos + 1, enum_stringstream.str().data());
-				}
-			}
-
-			////NMSTemplate libMBIN namespace fix
-			//size_t nmstemplate_offset = iter->second.find("NMSTemplate");
-			//size_t linkable_nmstemplate_offset = iter->second.find("LinkableNMSTemplate");
-			//if(nmstemplate_offset != std::string::npos && linkable_nmstemplate_offset == std::string::npos)
-			//{
-			//	iter->second.insert(nmstemplate_offset, "libMBIN::");
-			//}
+		//detect dependencies, from the field types rather than the generated text
+		std::unordered_set<std::string> struct_names;
+		for (const auto& [name, _struct] : write_datas)
+		{
+			struct_names.insert(name);
 		}
-		
 
-		//detect dependencies
-		std::unordered_map<std::string, std::unordered_set<std::string>> dependency_graph;
-		for (auto& [name, _struct] : write_datas)
+		std::map<std::string, std::set<std::string>> dependency_graph;
+		size_t dependency_count = 0;
+		for (const TypeInfo& type_info : infos_result.type_infos)
 		{
-			std::unordered_set<std::string> dependencies = RetrieveDependencies(name, _struct);
+			if (struct_names.find(type_info.name) == struct_names.end() || dependency_graph.find(type_info.name) != dependency_graph.end()) continue;
 
-			for (const auto& dependency : dependencies)
-			{
-				Logger::Info("[CSharpInterpreter] Detected dependency for {0}: {1}", name, dependency);
-			}
-
-			dependency_graph.emplace(name, dependencies);
+			std::set<std::string> dependencies = RetrieveDependencies(type_info, struct_names);
+			dependency_count += dependencies.size();
+			dependency_graph.emplace(type_info.name, std::move(dependencies));
 		}
 
+		Logger::Info("[CSharpInterpreter] Detected {0} dependencies between {1} structs", dependency_count, dependency_graph.size());
+
+		//ordered containers, the same libMBIN always generates the same header
 		std::vector<std::string> sorted_struct_names; 
 		std::unordered_set<std::string> visited; 
 		std::unordered_set<std::string> temp_marks;
 		// Perform topological sort
 		for (auto& [struct_name, _] : dependency_graph) 
 		{
-			/*if (struct_name == "GcInventoryCostData")
-			{
-				Logger::Info("");
-			}*/
-
 			if (visited.find(struct_name) == visited.end()) 
 			{
 				if (!Visit(struct_name, visited, temp_marks, sorted_struct_names, dependency_graph)) 
@@ -347,256 +488,332 @@ namespace CSharpInterpreter
 			}
 		}
 
-		std::stringstream ss;
-		std::string last_namespace = "Boo";
-		ss << "//Generated by NMSgen CSharpInterpreter\n\n";
+		//one header per struct, a forward declaration header and GeneratedCppTypes.h including all of them
+		std::map<std::string, std::string> type_headers = GenerateTypeHeaders(sorted_struct_names, write_datas, name_namespace_map, dependency_graph);
+		WriteTypeHeaders("generated/", type_headers);
 
-		ss << "#pragma once\n\n";
+		std::unordered_map<std::string, const TypeInfo*> layout_types;
+		for (const TypeInfo& type_info : infos_result.type_infos)
+		{
+			if (type_info.has_layout) layout_types.emplace(type_info.name, &type_info);
+		}
 
-		ss << "#include <string>\n";
-		ss << "#include <vector>\n";
-		ss << "#include <algorithm>\n\n";
+		std::string mbin_codec = GenerateMbinCodec(sorted_struct_names, layout_types, header_info);
+		IO::WriteBytes("generated/GeneratedMbinCodec.h", reinterpret_cast<const unsigned char*>(mbin_codec.data()));
 
-		//ss << "namespace libMBIN\n{\n";
-		ss << "struct NMSTemplate { friend bool operator==(const NMSTemplate& a, const NMSTemplate& b) {return true;} };\n\n";
-		//ss << "} // namespace libMBIN\n\n";
+		std::string mbin_views = GenerateMbinViews(sorted_struct_names, layout_types);
+		IO::WriteBytes("generated/GeneratedMbinViews.h", reinterpret_cast<const unsigned char*>(mbin_views.data()));
 
-		for (auto iter = sorted_struct_names.begin(); iter != sorted_struct_names.end(); iter++)
+		std::unordered_map<std::string, const TypeInfo*> struct_types;
+		for (const TypeInfo& type_info : infos_result.type_infos)
 		{
-			bool write_namespace = false;
-			std::string associated_namespace = name_namespace_map[*iter];
-			ConvertNamespace(associated_namespace);
-			if (associated_namespace != last_namespace) write_namespace = true;
+			struct_types.emplace(type_info.name, &type_info);
+		}
 
-			bool has_namespace = associated_namespace != "";
+		std::string mxml_codec = GenerateMxmlCodec(sorted_struct_names, struct_types, infos_result.enum_infos, header_info);
+		IO::WriteBytes("generated/GeneratedMxmlCodec.h", reinterpret_cast<const unsigned char*>(mxml_codec.data()));
 
-			//ignore
-			if (!has_namespace) continue;
+		
 
-			//namespace begin
-			if (write_namespace)
-			{
-				ss << "namespace " << associated_namespace << "\n{\n\n";
-				last_namespace = associated_namespace;
-			}
+		/*std::string write_data = GenerateEnumCode(multimapped_enums);
+		
+		IO::WriteBytes("generated/GeneratedCppEnums.h", reinterpret_cast<const unsigned char*>(write_data.data()));*/
+	}
 
-			std::unordered_set<std::string>& type_dependencies = dependency_graph[*iter];
-			for (auto dependency_iter = type_dependencies.begin(); dependency_iter != type_dependencies.end(); dependency_iter++)
-			{
-				ss << "//Dependency: " << *dependency_iter << "\n"; 
-			}
+	//runs task(i) for every i below count on all cores
+	template <typename Task>
+	static void ParallelFor(size_t count, Task&& task)
+	{
+		std::atomic<size_t> next_index = 0;
+		auto worker = [&]()
+		{
+			for (size_t i = next_index++; i < count; i = next_index++) task(i);
+		};
 
-			ss << write_datas[*iter];
+		unsigned int thread_count = std::max(1u, std::min(std::thread::hardware_concurrency(), static_cast<unsigned int>(count)));
+		std::vector<std::thread> threads;
+		for (unsigned int i = 1; i < thread_count; i++) threads.emplace_back(worker);
 
-			auto iter_peek = std::next(iter);
+		worker();
+		for (std::thread& thread : threads) thread.join();
+	}
 
-			//namespace end
-			if (iter_peek != sorted_struct_names.end() )
-			{
-				std::string next_namespace = name_namespace_map[*iter_peek];
-				ConvertNamespace(next_namespace);
-				if(next_namespace != last_namespace)
-				{
-					ss << "\n} //namespace " << associated_namespace << "\n\n";
-				}
-			}
-			else 
+	//one struct with its nested enums, only touches type_info and its own buffer
+	static std::string GenerateTypeStruct(TypeInfo& type_info, const std::vector<const EnumInfo*>& enums)
+	{
+		std::stringstream ss;
+
+		//declaration begin
+		ss << "struct " << type_info.name << "\n{";
+
+		for (const EnumInfo* enum_info : enums)
+		{
+			bool is_unsigned = enum_info->underlying_type.rfind("uint", 0) == 0;
+
+			ss << "\n\tenum class " << enum_info->name << " : " << enum_info->underlying_type << "\n\t{\n";
+			for (const auto& [entry_name, entry_value] : enum_info->entries)
 			{
-				ss << "\n} //namespace " << associated_namespace << "\n";
+				ss << "	\t" << entry_name << " = ";
+				if (is_unsigned) ss << static_cast<uint64_t>(entry_value);
+				else ss << entry_value;
+				ss << ",\n";
 			}
+			ss << "\t};\n";
 		}
 
-		IO::WriteBytes("generated/GeneratedCppTypes.h", reinterpret_cast<const unsigned char*>(ss.str().data()));
+		ss << "\n";
 
-		
+		std::vector<bool> is_array;
+		is_array.reserve(type_info.field_infos.size());
 
-		/*std::string write_data = GenerateEnumCode(multimapped_enums);
+		for (FieldInfo& field : type_info.field_infos)
+		{
+			std::pair<std::string, bool> cpp_member = ParseToCppMember(field);
+			ss << "	" << cpp_member.first << ";\n";
+
+			is_array.push_back(cpp_member.second);
+		}
 		
-		IO::WriteBytes("generated/GeneratedCppEnums.h", reinterpret_cast<const unsigned char*>(write_data.data()));*/
+		//== operator
+		ss << "\n\tfriend bool operator==(const " << type_info.name << "& lhs, const " << type_info.name << "& rhs) \n\t{\n";
+
+		ss << "\t\treturn ";
+
+		if (!type_info.field_infos.empty())
+		{
+			unsigned int count = 0;
+			for (FieldInfo& field : type_info.field_infos)
+			{
+				if (is_array[count]) ss << "std::equal(std::begin(lhs." << field.name << "), std::end(lhs." << field.name << "), std::begin(rhs." << field.name << "))";
+				else ss << "lhs." << field.name << " == " << "rhs." << field.name;
+				if (count++ < type_info.field_infos.size() - 1) ss << " &&\n\t\t";
+				else ss << ";";
+			}
+		}
+		else 
+		{
+			ss << "true;";
+		}
+		//== end
+		ss << "\n\t}\n";
+
+		//declaration end
+		ss << "};\n\n";
+
+		return ss.str();
 	}
 
-	std::unordered_map<std::string, std::string> GenerateTypesStructs(std::multimap<std::string, TypeInfo>& multimapped_types)
+	std::unordered_map<std::string, std::string> GenerateTypesStructs(std::multimap<std::string, TypeInfo>& multimapped_types, const std::unordered_multimap<std::string, const EnumInfo*>& nested_enums)
 	{
-		std::unordered_map<std::string, std::string> write_datas;
-
+		std::vector<TypeInfo*> emitted_types;
+		std::vector<std::vector<const EnumInfo*>> emitted_enums;
 		for (auto iter = multimapped_types.begin(); iter != multimapped_types.end(); iter++)
 		{
-			std::stringstream ss;
-
 			TypeInfo& type_info = iter->second;
 			bool has_namespace = !type_info.namespace_name.empty();
-			bool has_base_class = !type_info.base_class_name.empty();
 
 			//ignore
 			if (!has_namespace || type_info.base_class_name == "Object" || type_info.namespace_name == "libMBIN") continue;
 
-			//declaration begin
-			/*if (has_base_class)
-			{
-				ss << "struct " << type_info.name << " : public " << type_info.base_class_namespace << "::" << type_info.base_class_name << "\n{\n";
-			}
-			else*/
-			{
-				ss << "struct " << type_info.name << "\n{\n";
-			}
+			emitted_types.push_back(&type_info);
 
-			std::vector<bool> is_array;
-			is_array.reserve(type_info.field_infos.size());
+			std::vector<const EnumInfo*>& enums = emitted_enums.emplace_back();
+			auto range = nested_enums.equal_range(type_info.name);
+			for (auto it = range.first; it != range.second; ++it) enums.push_back(it->second);
 
-			for (FieldInfo& field : type_info.field_infos)
-			{
-				std::pair<std::string, bool> cpp_member = ParseToCppMember(field);
-				ss << "	" << cpp_member.first << ";\n";
+			//declaration order in libMBIN, not hash order
+			std::sort(enums.begin(), enums.end());
+		}
 
-				is_array.push_back(cpp_member.second);
-			}
-			
-			//== operator
-			ss << "\n\tfriend bool operator==(const " << type_info.name << "& lhs, const " << type_info.name << "& rhs) \n\t{\n";
+		//every type into its own buffer, joined in multimap order so the first type of a name wins like before
+		std::vector<std::string> structs(emitted_types.size());
+		ParallelFor(emitted_types.size(), [&](size_t i) { structs[i] = GenerateTypeStruct(*emitted_types[i], emitted_enums[i]); });
 
-			ss << "\t\treturn ";
+		std::unordered_map<std::string, std::string> write_datas;
+		write_datas.reserve(emitted_types.size());
+		for (size_t i = 0; i < emitted_types.size(); i++)
+		{
+			write_datas.emplace(emitted_types[i]->name, std::move(structs[i]));
+		}
+
+		return write_datas;
+	}
+
+	//generated struct namespace, empty for types GeneratedCppTypes.h leaves out
+	static std::string StructNamespace(const std::string& struct_name, const std::unordered_map<std::string, std::string>& name_namespace_map)
+	{
+		auto found = name_namespace_map.find(struct_name);
+		if (found == name_namespace_map.end()) return {};
+
+		std::string associated_namespace = found->second;
+		ConvertNamespace(associated_namespace);
+		return associated_namespace;
+	}
+
+	std::map<std::string, std::string> GenerateTypeHeaders(const std::vector<std::string>& sorted_struct_names, const std::unordered_map<std::string, std::string>& write_datas,
+		const std::unordered_map<std::string, std::string>& name_namespace_map, const std::map<std::string, std::set<std::string>>& dependency_graph)
+	{
+		std::map<std::string, std::string> headers;
+
+		std::stringstream umbrella;
+		umbrella << "//Generated by NMSgen CSharpInterpreter\n\n";
+		umbrella << "#pragma once\n\n";
+		umbrella << "//every generated struct. include single headers from types/ to only parse the structs used, GeneratedCppTypesFwd.h declares all of them.\n";
+		umbrella << "#include \"GeneratedCppTypesFwd.h\"\n";
+
+		std::map<std::string, std::vector<std::string>> namespace_structs;
+
+		//same dependency order the single file header used
+		for (const std::string& struct_name : sorted_struct_names)
+		{
+			std::string associated_namespace = StructNamespace(struct_name, name_namespace_map);
+
+			//ignore
+			if (associated_namespace.empty()) continue;
 
-			if (!type_info.field_infos.empty() /*&& !only_contains_nmstemplate*/)
+			auto write_data = write_datas.find(struct_name);
+			if (write_data == write_datas.end()) continue;
+
+			namespace_structs[associated_namespace].push_back(struct_name);
+
+			std::string header_path = "types/" + associated_namespace + "/" + struct_name + ".h";
+			umbrella << "#include \"" << header_path << "\"\n";
+
+			std::stringstream ss;
+			ss << "//Generated by NMSgen CSharpInterpreter\n\n";
+			ss << "#pragma once\n\n";
+			ss << "#include \"../../GeneratedCppTypesFwd.h\"\n";
+
+			auto dependencies = dependency_graph.find(struct_name);
+			if (dependencies != dependency_graph.end())
 			{
-				unsigned int count = 0;
-				for (FieldInfo& field : type_info.field_infos)
+				for (const std::string& dependency : dependencies->second)
 				{
-					/*if(field.type_name == "NMSTemplate") 
-					{
-						if(count == type_info.field_infos.size()-1)
-						{
-							std::string cur_str = ss.str();
-							size_t p = cur_str.rfind(" &&");
-							if(p != std::string::npos)
-							{
-								cur_str.replace(p, 3, ";");
-
-								ss.str(cur_str);
-								ss.seekp(0, std::ios::end);
-							}
-						}
-
-						count++;
-						continue;
-					}*/
-
-					if (is_array[count]) ss << "std::equal(std::begin(lhs." << field.name << "), std::end(lhs." << field.name << "), std::begin(rhs." << field.name << "))";
-					else ss << "lhs." << field.name << " == " << "rhs." << field.name;
-					if (count++ < type_info.field_infos.size() - 1) ss << " &&\n\t\t";
-					else ss << ";";
+					std::string dependency_namespace = StructNamespace(dependency, name_namespace_map);
+					if (!dependency_namespace.empty()) ss << "#include \"../" << dependency_namespace << "/" << dependency << ".h\"\n";
 				}
 			}
-			else 
-			{
-				ss << "true;";
-			}
-			//== end
-			ss << "\n\t}\n";
-			
 
-			//declaration end
-			ss << "};\n\n";
+			ss << "\nnamespace " << associated_namespace << "\n{\n\n";
+			ss << write_data->second;
+			ss << "} //namespace " << associated_namespace << "\n";
 
-			write_datas.emplace(type_info.name, ss.str());
+			headers.emplace(header_path, ss.str());
 		}
 
-		return write_datas;
-	}
+		std::stringstream forward;
+		forward << "//Generated by NMSgen CSharpInterpreter\n\n";
+		forward << "#pragma once\n\n";
+		forward << "#include <string>\n";
+		forward << "#include <vector>\n";
+		forward << "#include <algorithm>\n";
+		forward << "#include <cstdint>\n\n";
+		forward << "struct NMSTemplate { friend bool operator==(const NMSTemplate& a, const NMSTemplate& b) {return true;} };\n";
 
-	//https://stackoverflow.com/a/46711735
-	constexpr uint32_t hash(std::string_view data) noexcept {
-		uint32_t hash = 5381;
+		for (const auto& [associated_namespace, struct_names] : namespace_structs)
+		{
+			forward << "\nnamespace " << associated_namespace << "\n{\n";
+			for (const std::string& struct_name : struct_names)
+			{
+				forward << "\tstruct " << struct_name << ";\n";
+			}
+			forward << "} //namespace " << associated_namespace << "\n";
+		}
 
-		for (const char* c = data.data(); c < data.data() + data.size(); ++c)
-			hash = ((hash << 5) + hash) + (unsigned char)*c;
+		headers.emplace("GeneratedCppTypesFwd.h", forward.str());
+		headers.emplace("GeneratedCppTypes.h", umbrella.str());
 
-		return hash;
+		return headers;
 	}
 
-	std::set<std::string> surrogates;
-	std::unordered_set<std::string> RetrieveDependencies(const std::string& self_name, const std::string& from_struct)
+	void WriteTypeHeaders(const std::string& directory, const std::map<std::string, std::string>& headers)
 	{
-		std::vector<std::string> dependencies_vec;
-		
-		ExtractTypesFromStruct("NMS_GameComponents::", from_struct, dependencies_vec);
-		ExtractTypesFromStruct("NMS_Toolkit::", from_struct, dependencies_vec);
-		ExtractTypesFromStruct("NMS_Globals::", from_struct, dependencies_vec);
-		ExtractTypesFromStruct("NMS::", from_struct, dependencies_vec);
+		std::error_code error;
+		size_t written_count = 0;
 
-		if(self_name == "GcModelExplosionRule")
+		for (const auto& [relative_path, contents] : headers)
 		{
-			printf("sym");
-		}
+			std::filesystem::path path = directory + relative_path;
 
-		//> cancel (vector types)
-		for (size_t i = 0; i < dependencies_vec.size(); i++)
-		{
-			size_t p = dependencies_vec[i].find(">");
-			if (p != std::string::npos)
+			//unchanged headers keep their timestamp, only translation units using a changed struct rebuild
+			if (std::filesystem::exists(path, error) && std::filesystem::file_size(path, error) == contents.size())
 			{
-				dependencies_vec[i].replace(p, strlen(">"), "");
+				std::ifstream existing(path, std::ios::binary);
+				std::string existing_contents(contents.size(), '\0');
+				if (existing.read(existing_contents.data(), existing_contents.size()) && existing_contents == contents) continue;
 			}
-		}
 
-		size_t offset = 0;
-		size_t enum_p = from_struct.find("enum class", offset);
-		std::vector<std::string> enum_names;
-		while(enum_p != std::string::npos)
-		{
-			size_t start_pos = enum_p + 11;
-			size_t end_pos = from_struct.find_first_of(' ', start_pos);
-			enum_names.push_back(from_struct.substr(start_pos, end_pos - start_pos));
+			std::filesystem::create_directories(path.parent_path(), error);
+			std::ofstream out(path, std::ios::binary | std::ios::trunc);
+			if (!out || !out.write(contents.data(), contents.size()))
+			{
+				Logger::Error("[CSharpInterpreter] Failed to write {0}", path.string());
+				continue;
+			}
 
-			offset = end_pos;
-			enum_p = from_struct.find("enum class", offset);
+			written_count++;
 		}
 
-		//self-declared enum cancel and self cancel
-		auto iter = dependencies_vec.begin();
-		while(iter != dependencies_vec.end())
+		//headers of structs libMBIN no longer has
+		std::filesystem::path types_directory = directory + "types";
+		if (std::filesystem::exists(types_directory, error))
 		{
-			bool has_enum = false;
-			for (auto& s : enum_names)
+			std::vector<std::filesystem::path> stale_headers;
+			for (const auto& entry : std::filesystem::recursive_directory_iterator(types_directory, error))
 			{
-				if(iter->find(s) != std::string::npos) 
-				{
-					has_enum = true;
-				}
+				if (!entry.is_regular_file()) continue;
+
+				std::string relative_path = std::filesystem::relative(entry.path(), directory, error).generic_string();
+				if (headers.find(relative_path) == headers.end()) stale_headers.push_back(entry.path());
 			}
 
-			bool same = *iter == self_name;
-			if(same || has_enum) 
+			for (const std::filesystem::path& stale_header : stale_headers)
 			{
-				iter = dependencies_vec.erase(iter);
+				std::filesystem::remove(stale_header, error);
 			}
-			else iter++;
+
+			if (!stale_headers.empty()) Logger::Info("[CSharpInterpreter] Removed {0} headers of structs no longer in libMBIN", stale_headers.size());
 		}
 
-		std::unordered_set<std::string> dependencies_set;
+		Logger::Info("[CSharpInterpreter] Wrote {0} of {1} type headers, the others were unchanged", written_count, headers.size());
+	}
 
-		for (size_t i = 0; i < dependencies_vec.size(); i++)
-		{
-			dependencies_set.insert(dependencies_vec[i]);
-		}
+	//https://stackoverflow.com/a/46711735
+	constexpr uint32_t hash(std::string_view data) noexcept {
+		uint32_t hash = 5381;
 
-		return dependencies_set;
+		for (const char* c = data.data(); c < data.data() + data.size(); ++c)
+			hash = ((hash << 5) + hash) + (unsigned char)*c;
+
+		return hash;
 	}
 
-	void ExtractTypesFromStruct(const char* find_namespace, const std::string& from_struct, std::vector<std::string>& types)
+	std::set<std::string> surrogates;
+	std::mutex surrogates_mutex;
+
+	std::set<std::string> RetrieveDependencies(const TypeInfo& type_info, const std::unordered_set<std::string>& struct_names)
 	{
-		size_t pos = from_struct.find(find_namespace);
-		while (pos != std::string::npos)
+		std::set<std::string> dependencies;
+		for (const FieldInfo& field_info : type_info.field_infos)
 		{
-			size_t end_pos = from_struct.find_first_of(" ", pos);
-			size_t str_len = strlen(find_namespace);
-			size_t length = end_pos - (pos + str_len);
-			types.push_back(from_struct.substr(pos + str_len, length));
+			std::string element_name = ElementTypeName(field_info.type_name);
+			std::string dependency = ShortTypeName(element_name);
+
+			//an enum needs the struct it is declared in, GcFoo/BarEnum needs GcFoo
+			if (field_info.is_actual_enum || field_info.enum_size)
+			{
+				size_t name_pos = element_name.find_last_of("./+");
+				if (name_pos == std::string::npos) continue;
+				dependency = ShortTypeName(element_name.substr(0, name_pos));
+			}
 
-			pos = from_struct.find(find_namespace, pos + 1);
+			if (dependency != type_info.name && struct_names.find(dependency) != struct_names.end()) dependencies.insert(dependency);
 		}
+
+		return dependencies;
 	}
 
-	bool Visit(const std::string& struct_name, std::unordered_set<std::string>& visited, std::unordered_set<std::string>& temp_marks, std::vector<std::string>& sorted_struct_names, const std::unordered_map<std::string, std::unordered_set<std::string>>& dependency_graph)
+	bool Visit(const std::string& struct_name, std::unordered_set<std::string>& visited, std::unordered_set<std::string>& temp_marks, std::vector<std::string>& sorted_struct_names, const std::map<std::string, std::set<std::string>>& dependency_graph)
 	{
 		if (temp_marks.find(struct_name) != temp_marks.end()) {
 			// Detected a cycle
@@ -677,10 +894,14 @@ namespace CSharpInterpreter
 		case hash("System.Double"):
 			return "double";
 		default:
-			if(surrogates.find(field_info.type_name) == surrogates.end())
 			{
-				surrogates.emplace(field_info.type_name);
-				Logger::Info("[CSharpInterpreter] Possibly implement surrogate for {0}", field_info.type_name);
+				//structs are generated on several threads
+				std::lock_guard<std::mutex> lock(surrogates_mutex);
+				if(surrogates.find(field_info.type_name) == surrogates.end())
+				{
+					surrogates.emplace(field_info.type_name);
+					Logger::Info("[CSharpInterpreter] Possibly implement surrogate for {0}", field_info.type_name);
+				}
 			}
 			
 			ConvertMemberNamespace(field_info);
@@ -0,0 +1,620 @@
+#include "../header/Dom.h"
+#include "../header/CSharpInterpreter.h"
+#include "../header/MappedFile.h"
+#include "../header/mbin_codec.hpp"
+#include "../header/Logger.h"
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+
+namespace nmspp
+{
+	using CSharpInterpreter::FieldKind;
+	using CSharpInterpreter::FieldInfo;
+	using CSharpInterpreter::TypeInfo;
+	using CSharpInterpreter::EnumInfo;
+
+	void* Arena::Allocate(size_t size, size_t alignment)
+	{
+		uintptr_t aligned = (reinterpret_cast<uintptr_t>(cursor) + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+		if (!cursor || aligned + size > reinterpret_cast<uintptr_t>(end))
+		{
+			//oversized requests get a block of their own size, the rest of the current block is given up
+			size_t new_block_size = std::max(block_size, size + alignment);
+			blocks.push_back(std::make_unique<char[]>(new_block_size));
+			if (blocks.size() == 1) first_block_size = new_block_size;
+
+			cursor = blocks.back().get();
+			end = cursor + new_block_size;
+			aligned = (reinterpret_cast<uintptr_t>(cursor) + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+		}
+
+		cursor = reinterpret_cast<char*>(aligned + size);
+		bytes_used += size;
+		return reinterpret_cast<void*>(aligned);
+	}
+
+	std::string_view Arena::CopyString(std::string_view text)
+	{
+		if (text.empty()) return {};
+
+		char* chars = static_cast<char*>(Allocate(text.size(), 1));
+		std::memcpy(chars, text.data(), text.size());
+		return std::string_view(chars, text.size());
+	}
+
+	void Arena::Reset()
+	{
+		if (blocks.size() > 1) blocks.erase(blocks.begin() + 1, blocks.end());
+
+		cursor = blocks.empty() ? nullptr : blocks.front().get();
+		end = cursor ? cursor + first_block_size : nullptr;
+		bytes_used = 0;
+	}
+
+	const Node* Node::Find(std::string_view field_name) const
+	{
+		if (kind != NodeKind::Struct) return nullptr;
+
+		for (uint32_t i = 0; i < child_count; i++)
+		{
+			if (field_names[i] == field_name) return &children[i];
+		}
+
+		return nullptr;
+	}
+
+	const Node* Node::FindPath(std::string_view path) const
+	{
+		const Node* node = this;
+		while (node && !path.empty())
+		{
+			size_t dot_pos = path.find('.');
+			std::string_view part = path.substr(0, dot_pos);
+			path = dot_pos == std::string_view::npos ? std::string_view() : path.substr(dot_pos + 1);
+
+			if (node->kind == NodeKind::Struct)
+			{
+				node = node->Find(part);
+				continue;
+			}
+
+			uint32_t index = 0;
+			for (char c : part)
+			{
+				if (c < '0' || c > '9') return nullptr;
+				index = index * 10 + static_cast<uint32_t>(c - '0');
+			}
+
+			node = (part.empty() || index >= node->child_count) ? nullptr : &node->children[index];
+		}
+
+		return node;
+	}
+
+	struct EnumPlan
+	{
+		std::string_view name;
+		bool is_signed = true;
+		std::unordered_map<int64_t, std::string_view> names;
+	};
+
+	struct TypePlan;
+
+	//how one value is stored: a field itself, or each element of a list or array
+	struct ElementPlan
+	{
+		NodeKind kind = NodeKind::Opaque;
+		std::string_view type_name;
+		//bytes of a value or enum, binary size of a struct. the stride in lists and arrays.
+		uint32_t width = 0;
+		const EnumPlan* enum_plan = nullptr;
+		const TypePlan* type = nullptr;
+	};
+
+	struct FieldPlan
+	{
+		FieldKind kind = FieldKind::Unsupported;
+		uint32_t offset = 0;
+		//capacity of a fixed string, length of an array
+		uint32_t size = 0;
+		ElementPlan element;
+	};
+
+	struct TypePlan
+	{
+		std::string_view name;
+		uint32_t size = 0;
+		//serialized by hand in libMBIN (halfVector4), skipped over but not decoded
+		bool opaque = false;
+		uint32_t name_hash = 0;
+		uint64_t guid = 0;
+		std::vector<FieldPlan> fields;
+		//parallel to fields, Node::field_names points here
+		std::vector<std::string_view> field_names;
+	};
+
+	struct TypeSchema::Impl
+	{
+		CSharpInterpreter::Schema schema;
+
+		//types by name without namespace, which is unique in libMBIN. node based, plans point at each other.
+		std::unordered_map<std::string_view, TypePlan> types;
+		std::unordered_multimap<uint32_t, const TypePlan*> types_by_hash;
+
+		//"Nesting/Name", and by name alone for enums that are not nested
+		std::unordered_map<std::string, EnumPlan> enums;
+		std::unordered_map<std::string_view, const EnumPlan*> enums_by_name;
+
+		const EnumPlan* FindEnum(const std::string& type_name) const
+		{
+			size_t name_pos = type_name.find_last_of("./+");
+			std::string name = name_pos == std::string::npos ? type_name : type_name.substr(name_pos + 1);
+
+			if (name_pos != std::string::npos)
+			{
+				size_t nesting_pos = type_name.find_last_of("./+", name_pos - 1);
+				std::string nesting = type_name.substr(nesting_pos == std::string::npos ? 0 : nesting_pos + 1, name_pos - (nesting_pos == std::string::npos ? 0 : nesting_pos + 1));
+
+				auto found = enums.find(nesting + "/" + name);
+				if (found != enums.end()) return &found->second;
+			}
+
+			auto found = enums_by_name.find(name);
+			return found != enums_by_name.end() ? found->second : nullptr;
+		}
+
+		ElementPlan PlanElement(const FieldInfo& field_info, FieldKind kind) const
+		{
+			//values with their MBIN width, everything the codec generators map to arithmetic types
+			static const std::unordered_map<std::string_view, std::pair<NodeKind, uint32_t>> value_types =
+			{
+				{ "System.Boolean", { NodeKind::Bool, 1 } },
+				{ "System.Byte", { NodeKind::UInt, 1 } },
+				{ "System.SByte", { NodeKind::Int, 1 } },
+				{ "System.Int16", { NodeKind::Int, 2 } },
+				{ "System.UInt16", { NodeKind::UInt, 2 } },
+				{ "System.Int32", { NodeKind::Int, 4 } },
+				{ "System.UInt32", { NodeKind::UInt, 4 } },
+				{ "System.Int64", { NodeKind::Int, 8 } },
+				{ "System.UInt64", { NodeKind::UInt, 8 } },
+				{ "System.Single", { NodeKind::Float, 4 } },
+				{ "System.Double", { NodeKind::Float, 8 } },
+			};
+
+			std::string element_name = CSharpInterpreter::ElementTypeName(field_info.type_name);
+
+			ElementPlan element;
+			if (field_info.enum_size)
+			{
+				element.enum_plan = FindEnum(element_name);
+				element.kind = NodeKind::Enum;
+				element.width = field_info.enum_size;
+				element.type_name = element.enum_plan ? element.enum_plan->name : std::string_view(field_info.type_name);
+				return element;
+			}
+
+			if (kind == FieldKind::Template || element_name == "libMBIN.NMSTemplate")
+			{
+				element.kind = NodeKind::Template;
+				element.type_name = "NMSTemplate";
+				element.width = 0x10;
+				return element;
+			}
+
+			auto value_type = value_types.find(element_name);
+			if (value_type != value_types.end())
+			{
+				element.kind = value_type->second.first;
+				element.type_name = value_type->first;
+				element.width = value_type->second.second;
+				return element;
+			}
+
+			auto type = types.find(CSharpInterpreter::ShortTypeName(element_name));
+			if (type != types.end())
+			{
+				element.kind = type->second.opaque ? NodeKind::Opaque : NodeKind::Struct;
+				element.type_name = type->second.name;
+				element.width = type->second.size;
+				element.type = &type->second;
+			}
+
+			return element;
+		}
+
+		void Compile()
+		{
+			for (const EnumInfo& enum_info : schema.infos.enum_infos)
+			{
+				EnumPlan& enum_plan = enums[enum_info.nesting_class_name + "/" + enum_info.name];
+				enum_plan.name = enum_info.name;
+				enum_plan.is_signed = enum_info.underlying_type.rfind("uint", 0) != 0;
+				for (const auto& [entry_name, entry_value] : enum_info.entries)
+				{
+					enum_plan.names.emplace(entry_value, entry_name);
+				}
+
+				if (enum_info.nesting_class_name.empty()) enums_by_name.emplace(enum_info.name, &enum_plan);
+			}
+
+			//all plans exist before any field refers to one
+			for (const TypeInfo& type_info : schema.infos.type_infos)
+			{
+				if (!type_info.has_layout) continue;
+
+				TypePlan& type_plan = types[type_info.name];
+				type_plan.name = type_info.name;
+				//libMBIN writes nothing for a marker template, SizeOf still reports 1
+				bool has_fields = CSharpInterpreter::HasSerializedFields(type_info);
+				type_plan.size = has_fields || type_info.binary_size > 1 ? type_info.binary_size : 0;
+				type_plan.opaque = !has_fields && type_info.binary_size > 1;
+				type_plan.name_hash = type_info.name_hash;
+				type_plan.guid = type_info.guid;
+				types_by_hash.emplace(type_info.name_hash, &type_plan);
+			}
+
+			for (const TypeInfo& type_info : schema.infos.type_infos)
+			{
+				if (!type_info.has_layout) continue;
+
+				TypePlan& type_plan = types[type_info.name];
+				for (const FieldInfo& field_info : type_info.field_infos)
+				{
+					if (!field_info.is_serialized) continue;
+
+					FieldPlan field_plan;
+					field_plan.kind = CSharpInterpreter::ClassifyField(field_info);
+					field_plan.offset = field_info.offset;
+					field_plan.size = field_info.size;
+					if (field_plan.kind != FieldKind::String && field_plan.kind != FieldKind::DynamicString && field_plan.kind != FieldKind::Unsupported)
+					{
+						field_plan.element = PlanElement(field_info, field_plan.kind);
+					}
+
+					type_plan.fields.push_back(field_plan);
+					type_plan.field_names.push_back(field_info.name);
+				}
+			}
+		}
+
+		const TypePlan* FindTemplate(uint32_t name_hash, uint64_t guid) const
+		{
+			auto range = types_by_hash.equal_range(name_hash);
+			for (auto iter = range.first; iter != range.second; ++iter)
+			{
+				if (iter->second->guid == guid) return iter->second;
+			}
+
+			return nullptr;
+		}
+	};
+
+	//walks an MBIN along the plans, everything it produces goes into the arena. out of bounds data leaves nodes empty and sets failed.
+	class Decoder
+	{
+	public:
+		Decoder(const char* data, size_t size, Arena& arena) : data(data), size(size), arena(arena) {}
+
+		void Struct(const TypePlan& type, size_t offset, Node& out)
+		{
+			out.kind = NodeKind::Struct;
+			out.type_name = type.name;
+			if (!InBounds(offset, type.size)) return;
+
+			Node* children = arena.AllocateArray<Node>(type.fields.size());
+			for (size_t i = 0; i < type.fields.size(); i++)
+			{
+				Field(type.fields[i], offset + type.fields[i].offset, children[i]);
+			}
+
+			out.children = children;
+			out.field_names = type.field_names.data();
+			out.child_count = static_cast<uint32_t>(type.fields.size());
+		}
+
+		bool Failed() const { return failed; }
+
+	private:
+		void Field(const FieldPlan& field, size_t offset, Node& out)
+		{
+			size_t data_offset = 0;
+			size_t count = 0;
+
+			switch (field.kind)
+			{
+			case FieldKind::String:
+				out.kind = NodeKind::String;
+				out.type_name = "System.String";
+				if (InBounds(offset, field.size)) out.text = Text(offset, field.size);
+				break;
+			case FieldKind::DynamicString:
+				out.kind = NodeKind::String;
+				out.type_name = "System.String";
+				if (ListHeader(offset, data_offset, count) && InBounds(data_offset, count)) out.text = Text(data_offset, count);
+				break;
+			case FieldKind::List:
+			case FieldKind::EnumList:
+				if (!ListHeader(offset, data_offset, count)) count = 0;
+				Sequence(field.element, data_offset, count, NodeKind::List, out);
+				break;
+			case FieldKind::Array:
+			case FieldKind::EnumArray:
+				Sequence(field.element, offset, field.size, NodeKind::Array, out);
+				break;
+			case FieldKind::Unsupported:
+				out.kind = NodeKind::Opaque;
+				break;
+			default:
+				Element(field.element, offset, out);
+				break;
+			}
+		}
+
+		void Sequence(const ElementPlan& element, size_t offset, size_t count, NodeKind kind, Node& out)
+		{
+			out.kind = kind;
+			out.type_name = element.type_name;
+			if (count == 0 || element.kind == NodeKind::Opaque || !InBounds(offset, count * element.width)) return;
+			//elements without a width take no bytes, a count past what is left can only come from a corrupt header
+			if (element.width == 0 && count > size - offset)
+			{
+				failed = true;
+				return;
+			}
+
+			Node* items = arena.AllocateArray<Node>(count);
+			for (size_t i = 0; i < count; i++)
+			{
+				Element(element, offset + i * element.width, items[i]);
+			}
+
+			out.children = items;
+			out.child_count = static_cast<uint32_t>(count);
+		}
+
+		void Element(const ElementPlan& element, size_t offset, Node& out)
+		{
+			out.kind = element.kind;
+			out.type_name = element.type_name;
+
+			switch (element.kind)
+			{
+			case NodeKind::Struct:
+				Struct(*element.type, offset, out);
+				break;
+			case NodeKind::Bool:
+				if (InBounds(offset, 1)) out.value.boolean = data[offset] != 0;
+				break;
+			case NodeKind::Int:
+				out.value.integer = Signed(offset, element.width);
+				break;
+			case NodeKind::UInt:
+				out.value.unsigned_integer = Unsigned(offset, element.width);
+				break;
+			case NodeKind::Float:
+				if (element.width == sizeof(float))
+				{
+					float value = 0.f;
+					if (InBounds(offset, sizeof(float))) std::memcpy(&value, data + offset, sizeof(float));
+					out.value.real = value;
+				}
+				else if (InBounds(offset, sizeof(double)))
+				{
+					std::memcpy(&out.value.real, data + offset, sizeof(double));
+				}
+				break;
+			case NodeKind::Enum:
+				out.value.integer = !element.enum_plan || element.enum_plan->is_signed ? Signed(offset, element.width) : static_cast<int64_t>(Unsigned(offset, element.width));
+				if (element.enum_plan)
+				{
+					auto name = element.enum_plan->names.find(out.value.integer);
+					if (name != element.enum_plan->names.end()) out.text = name->second;
+				}
+				break;
+			default:
+				break;
+			}
+		}
+
+		uint64_t Unsigned(size_t offset, uint32_t width)
+		{
+			if (width > sizeof(uint64_t) || !InBounds(offset, width)) return 0;
+
+			//little endian, the low bytes come first
+			uint64_t value = 0;
+			std::memcpy(&value, data + offset, width);
+			return value;
+		}
+
+		int64_t Signed(size_t offset, uint32_t width)
+		{
+			uint64_t value = Unsigned(offset, width);
+			if (width == 0 || width >= sizeof(uint64_t)) return static_cast<int64_t>(value);
+
+			uint64_t sign_bit = uint64_t(1) << (width * 8 - 1);
+			return static_cast<int64_t>((value ^ sign_bit) - sign_bit);
+		}
+
+		std::string_view Text(size_t offset, size_t capacity)
+		{
+			const char* chars = data + offset;
+			return arena.CopyString(std::string_view(chars, std::find(chars, chars + capacity, '\0') - chars));
+		}
+
+		//same header mbin_codec::Reader reads, false for empty lists
+		bool ListHeader(size_t offset, size_t& data_offset, size_t& count)
+		{
+			if (!InBounds(offset, sizeof(int64_t) + sizeof(int32_t))) return false;
+
+			int64_t relative_offset = 0;
+			int32_t list_count = 0;
+			std::memcpy(&relative_offset, data + offset, sizeof(int64_t));
+			std::memcpy(&list_count, data + offset + sizeof(int64_t), sizeof(int32_t));
+			if (list_count <= 0) return false;
+
+			if (!mbin_codec::ListDataOffset(offset, relative_offset, size, data_offset))
+			{
+				failed = true;
+				return false;
+			}
+
+			count = static_cast<size_t>(list_count);
+			return true;
+		}
+
+		bool InBounds(size_t offset, size_t length)
+		{
+			if (offset <= size && size - offset >= length) return true;
+
+			failed = true;
+			return false;
+		}
+
+		const char* data;
+		size_t size;
+		Arena& arena;
+		bool failed = false;
+	};
+
+	TypeSchema::TypeSchema(std::unique_ptr<Impl> impl) : impl(std::move(impl)) {}
+
+	TypeSchema::~TypeSchema() = default;
+
+	size_t TypeSchema::TypeCount() const
+	{
+		return impl->types.size();
+	}
+
+	std::shared_ptr<const TypeSchema> TypeSchema::Load()
+	{
+		auto impl = std::make_unique<Impl>();
+		impl->schema = CSharpInterpreter::LoadOrExtractSchema();
+		impl->Compile();
+
+		return std::shared_ptr<const TypeSchema>(new TypeSchema(std::move(impl)));
+	}
+
+	std::shared_ptr<const TypeSchema> TypeSchema::Load(const std::string& schema_path, const std::string& dll_path)
+	{
+		uint64_t dll_hash = CSharpInterpreter::HashFile(dll_path);
+
+		auto impl = std::make_unique<Impl>();
+		if (!dll_hash || !CSharpInterpreter::LoadSchema(schema_path, dll_hash, impl->schema))
+		{
+			Logger::Error("[TypeSchema] No current schema for {0} at {1}", dll_path, schema_path);
+			return nullptr;
+		}
+
+		impl->Compile();
+
+		return std::shared_ptr<const TypeSchema>(new TypeSchema(std::move(impl)));
+	}
+
+	Document::Document(std::shared_ptr<const TypeSchema> schema) : schema(std::move(schema)) {}
+
+	void Document::Clear()
+	{
+		root = nullptr;
+		arena.Reset();
+	}
+
+	bool Document::ReadMbin(const char* data, size_t size)
+	{
+		Clear();
+
+		mbin_codec::Header header{};
+		if (size < sizeof(header))
+		{
+			Logger::Error("[Document] Data is too small for an MBIN header");
+			return false;
+		}
+
+		std::memcpy(&header, data, sizeof(header));
+		if (header.magic_id != mbin_codec::magic && header.magic_id != mbin_codec::magic_pc)
+		{
+			Logger::Error("[Document] Data is not an MBIN");
+			return false;
+		}
+
+		const TypePlan* root_type = schema->impl->FindTemplate(header.name_hash, header.template_guid);
+		if (!root_type)
+		{
+			Logger::Error("[Document] No type with name hash {0:#x} and GUID {1:#x} in the schema", header.name_hash, header.template_guid);
+			return false;
+		}
+
+		Node* root_node = arena.AllocateArray<Node>(1);
+		Decoder decoder(data, size, arena);
+		decoder.Struct(*root_type, sizeof(header), *root_node);
+		if (decoder.Failed()) Logger::Warning("[Document] {0} is truncated, some values are left empty", root_type->name);
+
+		root = root_node;
+		return true;
+	}
+
+	bool Document::ReadMbin(const std::string& path)
+	{
+		MappedFile file;
+		if (!file.Open(path)) return false;
+
+		return ReadMbin(file.Data(), file.Size());
+	}
+
+	static void DumpNode(const Node& node, std::string_view name, size_t depth, std::string& out)
+	{
+		out.append(depth, '\t');
+		out.append(name);
+		out += " (";
+		out.append(node.type_name);
+		out += ")";
+
+		switch (node.kind)
+		{
+		case NodeKind::Bool:
+			out += node.value.boolean ? " = true" : " = false";
+			break;
+		case NodeKind::Int:
+			out += " = " + std::to_string(node.value.integer);
+			break;
+		case NodeKind::UInt:
+			out += " = " + std::to_string(node.value.unsigned_integer);
+			break;
+		case NodeKind::Float:
+			out += " = " + fmt::format("{}", node.value.real);
+			break;
+		case NodeKind::String:
+			out += " = \"";
+			out.append(node.text);
+			out += "\"";
+			break;
+		case NodeKind::Enum:
+			out += " = ";
+			if (node.text.empty()) out += std::to_string(node.value.integer);
+			else out.append(node.text);
+			break;
+		case NodeKind::List:
+		case NodeKind::Array:
+			out += " [" + std::to_string(node.child_count) + "]";
+			break;
+		default:
+			break;
+		}
+		out += '\n';
+
+		for (uint32_t i = 0; i < node.child_count; i++)
+		{
+			std::string index_name;
+			if (!node.field_names) index_name = std::to_string(i);
+
+			DumpNode(node.children[i], node.field_names ? node.field_names[i] : std::string_view(index_name), depth + 1, out);
+		}
+	}
+
+	std::string Document::Dump() const
+	{
+		std::string out;
+		if (root) DumpNode(*root, "Template", 0, out);
+		return out;
+	}
+}
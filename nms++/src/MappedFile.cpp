@@ -0,0 +1,151 @@
+#include "../header/MappedFile.h"
+#include "../header/Logger.h"
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path)
+{
+	Open(path);
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other)
+	{
+		Close();
+
+		data = std::exchange(other.data, nullptr);
+		size = std::exchange(other.size, 0);
+#ifdef _WIN32
+		file_handle = std::exchange(other.file_handle, nullptr);
+		mapping_handle = std::exchange(other.mapping_handle, nullptr);
+#endif
+	}
+
+	return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& path)
+{
+	Close();
+
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		Logger::Error("[MappedFile] Failed to open file {0}", path);
+		return false;
+	}
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+	{
+		Logger::Error("[MappedFile] File {0} is empty!", path);
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping)
+	{
+		Logger::Error("[MappedFile] Failed to map file {0}", path);
+		CloseHandle(file);
+		return false;
+	}
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!view)
+	{
+		Logger::Error("[MappedFile] Failed to map a view of file {0}", path);
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	file_handle = file;
+	mapping_handle = mapping;
+	data = static_cast<const char*>(view);
+	size = static_cast<size_t>(file_size.QuadPart);
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (data) UnmapViewOfFile(data);
+	if (mapping_handle) CloseHandle(mapping_handle);
+	if (file_handle) CloseHandle(file_handle);
+
+	data = nullptr;
+	size = 0;
+	mapping_handle = nullptr;
+	file_handle = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& path)
+{
+	Close();
+
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		Logger::Error("[MappedFile] Failed to open file {0}", path);
+		return false;
+	}
+
+	struct stat file_stat;
+	if (fstat(file, &file_stat) != 0 || file_stat.st_size == 0)
+	{
+		Logger::Error("[MappedFile] File {0} is empty!", path);
+		close(file);
+		return false;
+	}
+
+	void* view = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	//the mapping keeps its own reference to the file
+	close(file);
+
+	if (view == MAP_FAILED)
+	{
+		Logger::Error("[MappedFile] Failed to map file {0}", path);
+		return false;
+	}
+
+	data = static_cast<const char*>(view);
+	size = static_cast<size_t>(file_stat.st_size);
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (data) munmap(const_cast<char*>(data), size);
+
+	data = nullptr;
+	size = 0;
+}
+
+#endif
@@ -0,0 +1,514 @@
+#include "../header/CSharpInterpreter.h"
+#include "../header/Logger.h"
+#include <sstream>
+#include <unordered_set>
+#include <algorithm>
+
+namespace CSharpInterpreter
+{
+	FieldKind ClassifyField(const FieldInfo& field_info)
+	{
+		const std::string& type_name = field_info.type_name;
+
+		//HashMap<T> starts with the list of its values
+		if (type_name.find("System.Collections.Generic.List") != std::string::npos || type_name.find("libMBIN.NMS.HashMap") != std::string::npos)
+		{
+			return field_info.enum_size ? FieldKind::EnumList : FieldKind::List;
+		}
+
+		if (type_name.find("[]") != std::string::npos)
+		{
+			//unsized arrays are only used by templates with custom serialization
+			if (!field_info.size) return FieldKind::Unsupported;
+			return field_info.enum_size ? FieldKind::EnumArray : FieldKind::Array;
+		}
+
+		if (field_info.is_actual_enum) return FieldKind::Enum;
+		if (type_name == "System.String") return field_info.size ? FieldKind::String : FieldKind::DynamicString;
+		if (type_name == "libMBIN.NMSTemplate") return FieldKind::Template;
+		if (type_name.rfind("System.", 0) == 0) return FieldKind::Value;
+
+		return FieldKind::Struct;
+	}
+
+	std::string ElementTypeName(const std::string& type_name)
+	{
+		std::string element_name = type_name;
+
+		size_t open_pos = element_name.find('<');
+		if (open_pos != std::string::npos)
+		{
+			element_name = element_name.substr(open_pos + 1, element_name.find_last_of('>') - open_pos - 1);
+		}
+
+		size_t array_pos = element_name.find("[]");
+		if (array_pos != std::string::npos) element_name.erase(array_pos);
+
+		return element_name;
+	}
+
+	std::string ShortTypeName(const std::string& full_name)
+	{
+		size_t separator_pos = full_name.find_last_of("./+");
+		return separator_pos == std::string::npos ? full_name : full_name.substr(separator_pos + 1);
+	}
+
+	std::string CppTypeName(const TypeInfo& type_info)
+	{
+		std::string cpp_namespace = type_info.namespace_name;
+		ConvertNamespace(cpp_namespace);
+		return cpp_namespace + "::" + type_info.name;
+	}
+
+	static const char* EnumBinaryType(uint32_t enum_size)
+	{
+		switch (enum_size)
+		{
+		case 1:
+			return "uint8_t";
+		case 2:
+			return "uint16_t";
+		case 8:
+			return "uint64_t";
+		default:
+			return "uint32_t";
+		}
+	}
+
+	static std::string Hex(uint64_t value)
+	{
+		std::stringstream ss;
+		ss << "0x" << std::uppercase << std::hex << value;
+		return ss.str();
+	}
+
+	bool HasSerializedFields(const TypeInfo& type_info)
+	{
+		return std::any_of(type_info.field_infos.begin(), type_info.field_infos.end(), [](const FieldInfo& field_info) { return field_info.is_serialized; });
+	}
+
+	static bool HasCodecFields(const TypeInfo& type_info, const std::unordered_set<std::string>& codec_types)
+	{
+		//data without fields (halfVector4) is serialized by hand in libMBIN, marker templates only take a placeholder byte
+		if (!HasSerializedFields(type_info) && type_info.binary_size > 1) return false;
+
+		for (const FieldInfo& field_info : type_info.field_infos)
+		{
+			if (!field_info.is_serialized) continue;
+
+			FieldKind kind = ClassifyField(field_info);
+			if (kind == FieldKind::Unsupported) return false;
+			if (kind != FieldKind::Struct && kind != FieldKind::List && kind != FieldKind::Array) continue;
+
+			std::string element_name = ElementTypeName(field_info.type_name);
+			if (element_name.rfind("System.", 0) == 0 || element_name == "libMBIN.NMSTemplate") continue;
+
+			if (codec_types.find(ShortTypeName(element_name)) == codec_types.end()) return false;
+		}
+
+		return true;
+	}
+
+	//a type gets a codec if libMBIN could lay it out and everything it embeds gets one as well
+	static std::unordered_set<std::string> CollectCodecTypes(const std::vector<std::string>& sorted_struct_names, const std::unordered_map<std::string, const TypeInfo*>& layout_types)
+	{
+		std::unordered_set<std::string> codec_types;
+		for (const std::string& struct_name : sorted_struct_names)
+		{
+			auto layout_iter = layout_types.find(struct_name);
+
+			//types without namespace are not written to GeneratedCppTypes.h either
+			if (layout_iter != layout_types.end() && !layout_iter->second->namespace_name.empty()) codec_types.insert(struct_name);
+		}
+
+		bool removed = true;
+		while (removed)
+		{
+			removed = false;
+			for (auto iter = codec_types.begin(); iter != codec_types.end();)
+			{
+				if (HasCodecFields(*layout_types.at(*iter), codec_types))
+				{
+					iter++;
+					continue;
+				}
+
+				iter = codec_types.erase(iter);
+				removed = true;
+			}
+		}
+
+		return codec_types;
+	}
+
+	//polymorphic templates and hash maps (which carry a lookup table libMBIN builds itself) are left to libMBIN
+	static bool HasWritableFields(const TypeInfo& type_info, const std::unordered_set<std::string>& writable_types)
+	{
+		for (const FieldInfo& field_info : type_info.field_infos)
+		{
+			if (!field_info.is_serialized) continue;
+
+			FieldKind kind = ClassifyField(field_info);
+			if (kind == FieldKind::Template || field_info.type_name.find("libMBIN.NMS.HashMap") != std::string::npos) return false;
+			if (kind != FieldKind::Struct && kind != FieldKind::List && kind != FieldKind::Array) continue;
+
+			std::string element_name = ElementTypeName(field_info.type_name);
+			if (element_name.rfind("System.", 0) == 0) continue;
+
+			if (writable_types.find(ShortTypeName(element_name)) == writable_types.end()) return false;
+		}
+
+		return true;
+	}
+
+	static std::unordered_set<std::string> CollectWritableTypes(const std::unordered_set<std::string>& codec_types, const std::unordered_map<std::string, const TypeInfo*>& layout_types)
+	{
+		std::unordered_set<std::string> writable_types = codec_types;
+
+		bool removed = true;
+		while (removed)
+		{
+			removed = false;
+			for (auto iter = writable_types.begin(); iter != writable_types.end();)
+			{
+				if (HasWritableFields(*layout_types.at(*iter), writable_types))
+				{
+					iter++;
+					continue;
+				}
+
+				iter = writable_types.erase(iter);
+				removed = true;
+			}
+		}
+
+		return writable_types;
+	}
+
+	//reader and writer share their method names, only the prefix differs
+	static void WriteFieldAccess(std::stringstream& ss, const FieldInfo& field_info, const char* verb, const char* codec, const char* object)
+	{
+		std::string offset = "offset + " + Hex(field_info.offset);
+		std::string member = std::string(object) + "." + field_info.name;
+
+		switch (ClassifyField(field_info))
+		{
+		case FieldKind::Value:
+			ss << "\t" << codec << "." << verb << "Value(" << offset << ", " << member << ");\n";
+			break;
+		case FieldKind::Enum:
+			ss << "\t" << codec << "." << verb << "Enum<" << EnumBinaryType(field_info.enum_size) << ">(" << offset << ", " << member << ");\n";
+			break;
+		case FieldKind::String:
+			ss << "\t" << codec << "." << verb << "String(" << offset << ", " << field_info.size << ", " << member << ");\n";
+			break;
+		case FieldKind::DynamicString:
+			ss << "\t" << codec << "." << verb << "DynamicString(" << offset << ", " << member << ");\n";
+			break;
+		case FieldKind::Struct:
+			ss << "\t" << verb << "Fields(" << codec << ", " << offset << ", " << member << ");\n";
+			break;
+		case FieldKind::Template:
+			ss << "\t//" << field_info.name << ": polymorphic template, not represented by the generated types\n";
+			break;
+		case FieldKind::List:
+			ss << "\t" << codec << "." << verb << "List(" << offset << ", " << member << ");\n";
+			break;
+		case FieldKind::EnumList:
+			ss << "\t" << codec << "." << verb << "EnumList<" << EnumBinaryType(field_info.enum_size) << ">(" << offset << ", " << member << ");\n";
+			break;
+		case FieldKind::Array:
+			ss << "\t" << codec << "." << verb << "Array(" << offset << ", " << member << ");\n";
+			break;
+		case FieldKind::EnumArray:
+			ss << "\t" << codec << "." << verb << "EnumArray<" << EnumBinaryType(field_info.enum_size) << ">(" << offset << ", " << member << ");\n";
+			break;
+		case FieldKind::Unsupported:
+			break;
+		}
+	}
+
+	static void WriteFieldsFunction(std::stringstream& ss, const TypeInfo& type_info, bool is_writer)
+	{
+		const char* verb = is_writer ? "Write" : "Read";
+		const char* codec_type = is_writer ? "Writer" : "Reader";
+		const char* codec = is_writer ? "writer" : "reader";
+		const char* object = is_writer ? "value" : "out";
+
+		std::stringstream body;
+		for (const FieldInfo& field_info : type_info.field_infos)
+		{
+			if (field_info.is_serialized) WriteFieldAccess(body, field_info, verb, codec, object);
+		}
+
+		std::string signature_type = (is_writer ? "const " : "") + CppTypeName(type_info) + "&";
+		if (body.str().empty())
+		{
+			ss << "inline void " << verb << "Fields(" << codec_type << "&, size_t, " << signature_type << ") {}\n\n";
+			return;
+		}
+
+		ss << "inline void " << verb << "Fields(" << codec_type << "& " << codec << ", size_t offset, " << signature_type << " " << object << ")\n{\n";
+		ss << body.str();
+		ss << "}\n\n";
+	}
+
+	std::string GenerateMbinCodec(const std::vector<std::string>& sorted_struct_names, const std::unordered_map<std::string, const TypeInfo*>& layout_types, const MbinHeaderInfo& header_info)
+	{
+		std::unordered_set<std::string> codec_types = CollectCodecTypes(sorted_struct_names, layout_types);
+		std::unordered_set<std::string> writable_types = CollectWritableTypes(codec_types, layout_types);
+
+		std::vector<const TypeInfo*> types;
+		for (const std::string& struct_name : sorted_struct_names)
+		{
+			auto layout_iter = layout_types.find(struct_name);
+			if (layout_iter == layout_types.end() || layout_iter->second->namespace_name.empty()) continue;
+
+			if (codec_types.find(struct_name) != codec_types.end()) types.push_back(layout_iter->second);
+			else Logger::Info("[CSharpInterpreter] {0} has fields without a native MBIN encoding, no native MBIN codec", struct_name);
+		}
+
+		Logger::Info("[CSharpInterpreter] Generating native MBIN codec for {0} of {1} types, {2} writable", types.size(), sorted_struct_names.size(), writable_types.size());
+
+		std::stringstream ss;
+		ss << "//Generated by NMSgen CSharpInterpreter\n\n";
+
+		ss << "#pragma once\n\n";
+
+		ss << "#include \"GeneratedCppTypes.h\"\n";
+		ss << "#include \"nms++/details/mbin_codec.hpp\"\n\n";
+
+		ss << "namespace mbin_codec\n{\n\n";
+
+		ss << "template <typename T>\nstruct HeaderDefaults\n{\n";
+		ss << "\tstatic constexpr uint16_t mbin_version = " << header_info.mbin_version << ";\n";
+		ss << "\tstatic constexpr uint16_t header_version = " << header_info.header_version << ";\n";
+		ss << "\tstatic constexpr uint64_t timestamp = " << Hex(header_info.timestamp) << ";\n";
+		ss << "};\n\n";
+
+		//only the slot of a polymorphic template is known, its data is not represented by the generated types
+		ss << "template <>\nstruct TypeLayout<NMSTemplate>\n{\n";
+		ss << "\tstatic constexpr size_t size = 0x10;\n";
+		ss << "\tstatic constexpr size_t alignment = 0x8;\n";
+		ss << "\tstatic constexpr uint32_t name_hash = 0x0;\n";
+		ss << "\tstatic constexpr uint64_t guid = 0x0;\n";
+		ss << "\tstatic constexpr bool writable = false;\n";
+		ss << "};\n\n";
+		ss << "inline void ReadFields(Reader&, size_t, NMSTemplate&) {}\n\n";
+
+		for (const TypeInfo* type_info : types)
+		{
+			bool writable = writable_types.find(type_info->name) != writable_types.end();
+
+			ss << "template <>\nstruct TypeLayout<" << CppTypeName(*type_info) << ">\n{\n";
+			//libMBIN writes nothing for a marker template, SizeOf still reports 1
+			uint32_t binary_size = HasSerializedFields(*type_info) ? type_info->binary_size : 0;
+
+			ss << "\tstatic constexpr size_t size = " << Hex(binary_size) << ";\n";
+			ss << "\tstatic constexpr size_t alignment = " << Hex(type_info->alignment) << ";\n";
+			ss << "\tstatic constexpr uint32_t name_hash = " << Hex(type_info->name_hash) << ";\n";
+			ss << "\tstatic constexpr uint64_t guid = " << Hex(type_info->guid) << ";\n";
+			ss << "\tstatic constexpr bool writable = " << (writable ? "true" : "false") << ";\n";
+			ss << "};\n\n";
+		}
+
+		//declared up front so the definitions do not depend on the struct order
+		for (const TypeInfo* type_info : types)
+		{
+			ss << "inline void ReadFields(Reader& reader, size_t offset, " << CppTypeName(*type_info) << "& out);\n";
+			if (writable_types.find(type_info->name) != writable_types.end())
+			{
+				ss << "inline void WriteFields(Writer& writer, size_t offset, const " << CppTypeName(*type_info) << "& value);\n";
+			}
+		}
+		ss << "\n";
+
+		for (const TypeInfo* type_info : types)
+		{
+			WriteFieldsFunction(ss, *type_info, false);
+			if (writable_types.find(type_info->name) != writable_types.end()) WriteFieldsFunction(ss, *type_info, true);
+		}
+
+		ss << "} //namespace mbin_codec\n";
+
+		return ss.str();
+	}
+
+	//NMSString*, VariableSizeString and HashedString hold their string in a leading Value field, views hand it out directly
+	static const FieldInfo* StringValueField(const TypeInfo& type_info)
+	{
+		auto first_field = std::find_if(type_info.field_infos.begin(), type_info.field_infos.end(), [](const FieldInfo& field_info) { return field_info.is_serialized; });
+		if (first_field == type_info.field_infos.end() || first_field->name != "Value") return nullptr;
+
+		FieldKind kind = ClassifyField(*first_field);
+		return kind == FieldKind::String || kind == FieldKind::DynamicString ? &*first_field : nullptr;
+	}
+
+	//string access for a string field at offset
+	static std::string StringAccess(const FieldInfo& field_info, uint32_t offset)
+	{
+		if (ClassifyField(field_info) == FieldKind::String) return "StringAt(" + Hex(offset) + ", " + std::to_string(field_info.size) + ")";
+		return "DynamicStringAt(" + Hex(offset) + ")";
+	}
+
+	//the element a view hands out for a list, an array or a struct field: the member's own element type for values and enums,
+	//the view of the element type otherwise
+	static std::string ViewElementType(const TypeInfo& type_info, const FieldInfo& field_info, FieldKind kind, const std::unordered_map<std::string, const TypeInfo*>& layout_types)
+	{
+		std::string member_type = "decltype(" + CppTypeName(type_info) + "::" + field_info.name + ")";
+		std::string element_name = ElementTypeName(field_info.type_name);
+
+		if (kind == FieldKind::Struct || (element_name.rfind("System.", 0) != 0 && (kind == FieldKind::List || kind == FieldKind::Array)))
+		{
+			return CppTypeName(*layout_types.at(ShortTypeName(element_name))) + "View";
+		}
+
+		if (kind == FieldKind::List || kind == FieldKind::EnumList) return member_type + "::value_type";
+		return "std::remove_extent_t<" + member_type + ">";
+	}
+
+	//declared in the view and defined after all views, an accessor can hand out a view that is declared later
+	static void WriteViewAccessor(std::stringstream& declarations, std::stringstream& definitions, const TypeInfo& type_info, const FieldInfo& field_info, const std::unordered_map<std::string, const TypeInfo*>& layout_types)
+	{
+		FieldKind kind = ClassifyField(field_info);
+		std::string offset = Hex(field_info.offset);
+		std::string member_type = "decltype(" + CppTypeName(type_info) + "::" + field_info.name + ")";
+
+		if (kind == FieldKind::Template || ElementTypeName(field_info.type_name) == "libMBIN.NMSTemplate")
+		{
+			declarations << "\t//" << field_info.name << ": polymorphic template, not represented by the generated types\n";
+			return;
+		}
+
+		std::string return_type;
+		std::string access;
+		switch (kind)
+		{
+		case FieldKind::Value:
+			return_type = member_type;
+			access = "ValueAt<" + member_type + ">(" + offset + ")";
+			break;
+		case FieldKind::Enum:
+			return_type = member_type;
+			access = std::string("EnumAt<") + EnumBinaryType(field_info.enum_size) + ", " + member_type + ">(" + offset + ")";
+			break;
+		case FieldKind::String:
+		case FieldKind::DynamicString:
+			return_type = "std::string_view";
+			access = StringAccess(field_info, field_info.offset);
+			break;
+		case FieldKind::Struct:
+		{
+			const TypeInfo& field_type = *layout_types.at(ShortTypeName(field_info.type_name));
+			if (const FieldInfo* value_field = StringValueField(field_type))
+			{
+				return_type = "std::string_view";
+				access = StringAccess(*value_field, field_info.offset + value_field->offset);
+				break;
+			}
+
+			return_type = ViewElementType(type_info, field_info, kind, layout_types);
+			access = "StructAt<" + return_type + ">(" + offset + ")";
+			break;
+		}
+		case FieldKind::List:
+		case FieldKind::EnumList:
+		case FieldKind::Array:
+		case FieldKind::EnumArray:
+		{
+			std::string element_type = ViewElementType(type_info, field_info, kind, layout_types);
+			if (kind == FieldKind::EnumList || kind == FieldKind::EnumArray) element_type += std::string(", ") + EnumBinaryType(field_info.enum_size);
+
+			return_type = "mbin_codec::ListView<" + element_type + ">";
+			if (kind == FieldKind::List || kind == FieldKind::EnumList)
+			{
+				access = "ListAt<" + element_type + ">(" + offset + ")";
+			}
+			else
+			{
+				//ArrayAt takes the length ahead of the enum width
+				std::string length = ", " + std::to_string(field_info.size);
+				size_t binary_pos = kind == FieldKind::EnumArray ? element_type.rfind(", ") : element_type.size();
+				access = "ArrayAt<" + element_type.substr(0, binary_pos) + length + element_type.substr(binary_pos) + ">(" + offset + ")";
+			}
+			break;
+		}
+		default:
+			return;
+		}
+
+		declarations << "\t" << return_type << " " << field_info.name << "() const;\n";
+		definitions << "inline " << return_type << " " << CppTypeName(type_info) << "View::" << field_info.name << "() const { return " << access << "; }\n";
+	}
+
+	std::string GenerateMbinViews(const std::vector<std::string>& sorted_struct_names, const std::unordered_map<std::string, const TypeInfo*>& layout_types)
+	{
+		std::unordered_set<std::string> codec_types = CollectCodecTypes(sorted_struct_names, layout_types);
+
+		//accessors are only declared in the views, so the views can go by namespace instead of in struct order
+		std::vector<std::pair<std::string, std::vector<const TypeInfo*>>> namespaces;
+		size_t view_count = 0;
+		for (const std::string& struct_name : sorted_struct_names)
+		{
+			if (codec_types.find(struct_name) == codec_types.end()) continue;
+
+			const TypeInfo* type_info = layout_types.at(struct_name);
+			std::string cpp_namespace = type_info->namespace_name;
+			ConvertNamespace(cpp_namespace);
+
+			auto namespace_iter = std::find_if(namespaces.begin(), namespaces.end(), [&](const auto& entry) { return entry.first == cpp_namespace; });
+			if (namespace_iter == namespaces.end()) namespace_iter = namespaces.insert(namespaces.end(), { cpp_namespace, {} });
+
+			namespace_iter->second.push_back(type_info);
+			view_count++;
+		}
+
+		Logger::Info("[CSharpInterpreter] Generating MBIN views for {0} types", view_count);
+
+		std::stringstream ss;
+		ss << "//Generated by NMSgen CSharpInterpreter\n\n";
+
+		ss << "#pragma once\n\n";
+
+		ss << "#include \"GeneratedMbinCodec.h\"\n";
+		ss << "#include <string_view>\n\n";
+
+		for (const auto& [cpp_namespace, types] : namespaces)
+		{
+			ss << "namespace " << cpp_namespace << "\n{\n";
+			for (const TypeInfo* type_info : types)
+			{
+				ss << "class " << type_info->name << "View;\n";
+			}
+			ss << "} //namespace " << cpp_namespace << "\n\n";
+		}
+
+		std::stringstream definitions;
+		for (const auto& [cpp_namespace, types] : namespaces)
+		{
+			ss << "namespace " << cpp_namespace << "\n{\n\n";
+			for (const TypeInfo* type_info : types)
+			{
+				ss << "class " << type_info->name << "View : public mbin_codec::View\n{\npublic:\n";
+				ss << "\tusing native_type = " << type_info->name << ";\n";
+				ss << "\tstatic constexpr size_t binary_size = mbin_codec::TypeLayout<" << type_info->name << ">::size;\n\n";
+				ss << "\tusing View::View;\n\n";
+
+				for (const FieldInfo& field_info : type_info->field_infos)
+				{
+					if (field_info.is_serialized) WriteViewAccessor(ss, definitions, *type_info, field_info, layout_types);
+				}
+
+				//lists of strings hand out the string types, which read as their string
+				if (StringValueField(*type_info)) ss << "\n\toperator std::string_view() const { return Value(); }\n";
+
+				ss << "};\n\n";
+			}
+			ss << "} //namespace " << cpp_namespace << "\n\n";
+		}
+
+		ss << definitions.str();
+
+		return ss.str();
+	}
+}
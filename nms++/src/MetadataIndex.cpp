@@ -0,0 +1,434 @@
+#include "../header/MetadataIndex.h"
+#include "../header/Logger.h"
+#include "mono/metadata/metadata.h"
+#include "mono/metadata/row-indexes.h"
+#include "mono/metadata/attrdefs.h"
+#include "mono/metadata/blob.h"
+#include <cstring>
+
+namespace CSharpInterpreter
+{
+	//custom attribute blob encodings without a MonoTypeEnum value
+	static constexpr uint8_t attribute_type_type = 0x50;
+	static constexpr uint8_t attribute_type_boxed = 0x51;
+	static constexpr uint8_t attribute_named_field = 0x53;
+	static constexpr uint8_t attribute_named_property = 0x54;
+
+	static const char* CppIntegerType(uint32_t mono_type)
+	{
+		switch (mono_type)
+		{
+		case MONO_TYPE_I1:
+			return "int8_t";
+		case MONO_TYPE_U1:
+			return "uint8_t";
+		case MONO_TYPE_I2:
+			return "int16_t";
+		case MONO_TYPE_U2:
+			return "uint16_t";
+		case MONO_TYPE_I4:
+			return "int32_t";
+		case MONO_TYPE_U4:
+			return "uint32_t";
+		case MONO_TYPE_I8:
+			return "int64_t";
+		case MONO_TYPE_U8:
+			return "uint64_t";
+		default:
+			return nullptr;
+		}
+	}
+
+	//reads the named arguments of a custom attribute blob (ECMA-335 II.23.3), fails on anything it cannot size
+	class AttributeBlobReader
+	{
+	public:
+		struct Argument
+		{
+			int64_t integer = 0;
+			std::string text;
+			bool is_null = false;
+		};
+
+		AttributeBlobReader(const char* data, uint32_t length) : position(reinterpret_cast<const uint8_t*>(data)), end(position + length) {}
+
+		template <typename T>
+		bool Value(T& out)
+		{
+			if (static_cast<size_t>(end - position) < sizeof(T)) return false;
+
+			std::memcpy(&out, position, sizeof(T));
+			position += sizeof(T);
+			return true;
+		}
+
+		bool Type(uint8_t& type, uint8_t& element_type)
+		{
+			element_type = 0;
+			if (!Value(type)) return false;
+			if (type == MONO_TYPE_SZARRAY) return Value(element_type);
+			return type != MONO_TYPE_ENUM;
+		}
+
+		bool String(std::string& out, bool& is_null)
+		{
+			is_null = false;
+			if (position < end && *position == 0xFF)
+			{
+				is_null = true;
+				position++;
+				return true;
+			}
+
+			uint32_t length = 0;
+			if (!CompressedSize(length) || static_cast<size_t>(end - position) < length) return false;
+
+			out.assign(reinterpret_cast<const char*>(position), length);
+			position += length;
+			return true;
+		}
+
+		bool Read(uint8_t type, uint8_t element_type, Argument& out)
+		{
+			switch (type)
+			{
+			case MONO_TYPE_BOOLEAN:
+			case MONO_TYPE_U1:
+				return Integer<uint8_t>(out);
+			case MONO_TYPE_I1:
+				return Integer<int8_t>(out);
+			case MONO_TYPE_CHAR:
+			case MONO_TYPE_U2:
+				return Integer<uint16_t>(out);
+			case MONO_TYPE_I2:
+				return Integer<int16_t>(out);
+			case MONO_TYPE_U4:
+			case MONO_TYPE_R4:
+				return Integer<uint32_t>(out);
+			case MONO_TYPE_I4:
+				return Integer<int32_t>(out);
+			case MONO_TYPE_I8:
+			case MONO_TYPE_U8:
+			case MONO_TYPE_R8:
+				return Integer<int64_t>(out);
+			case MONO_TYPE_STRING:
+			case attribute_type_type:
+				return String(out.text, out.is_null);
+			case attribute_type_boxed:
+			{
+				uint8_t boxed_type = 0;
+				uint8_t boxed_element_type = 0;
+				return Type(boxed_type, boxed_element_type) && Read(boxed_type, boxed_element_type, out);
+			}
+			case MONO_TYPE_SZARRAY:
+			{
+				uint32_t count = 0;
+				if (!Value(count)) return false;
+
+				out.is_null = count == 0xFFFFFFFF;
+				if (out.is_null) return true;
+
+				out.integer = count;
+				Argument element;
+				for (uint32_t i = 0; i < count; i++)
+				{
+					if (element_type == MONO_TYPE_SZARRAY || !Read(element_type, 0, element)) return false;
+				}
+				return true;
+			}
+			default:
+				return false;
+			}
+		}
+
+	private:
+		template <typename T>
+		bool Integer(Argument& out)
+		{
+			T value{};
+			if (!Value(value)) return false;
+
+			out.integer = static_cast<int64_t>(value);
+			return true;
+		}
+
+		bool CompressedSize(uint32_t& out)
+		{
+			if (position >= end) return false;
+
+			size_t size = (*position & 0x80) == 0 ? 1 : (*position & 0xC0) == 0x80 ? 2 : 4;
+			if (static_cast<size_t>(end - position) < size) return false;
+
+			out = mono_metadata_decode_value(reinterpret_cast<const char*>(position), nullptr);
+			position += size;
+			return true;
+		}
+
+		const uint8_t* position;
+		const uint8_t* end;
+	};
+
+	MetadataIndex::MetadataIndex(MonoImage* image) : image(image)
+	{
+		const MonoTableInfo* type_definitions_table = mono_image_get_table_info(image, MONO_TABLE_TYPEDEF);
+		const MonoTableInfo* type_references_table = mono_image_get_table_info(image, MONO_TABLE_TYPEREF);
+		const MonoTableInfo* fields_table = mono_image_get_table_info(image, MONO_TABLE_FIELD);
+		const MonoTableInfo* methods_table = mono_image_get_table_info(image, MONO_TABLE_METHOD);
+		const MonoTableInfo* member_references_table = mono_image_get_table_info(image, MONO_TABLE_MEMBERREF);
+		const MonoTableInfo* constants_table = mono_image_get_table_info(image, MONO_TABLE_CONSTANT);
+		const MonoTableInfo* nested_classes_table = mono_image_get_table_info(image, MONO_TABLE_NESTEDCLASS);
+		const MonoTableInfo* custom_attributes_table = mono_image_get_table_info(image, MONO_TABLE_CUSTOMATTRIBUTE);
+
+		type_count = mono_table_info_get_rows(type_definitions_table);
+		field_count = mono_table_info_get_rows(fields_table);
+		uint32_t method_count = mono_table_info_get_rows(methods_table);
+
+		//System.Enum and System.FlagsAttribute are referenced from corlib
+		uint32_t enum_reference = 0;
+		uint32_t flags_reference = 0;
+		uint32_t type_reference_count = mono_table_info_get_rows(type_references_table);
+		for (uint32_t i = 0; i < type_reference_count; i++)
+		{
+			uint32_t cols[MONO_TYPEREF_SIZE];
+			mono_metadata_decode_row(type_references_table, i, cols, MONO_TYPEREF_SIZE);
+			if (strcmp(mono_metadata_string_heap(image, cols[MONO_TYPEREF_NAMESPACE]), "System") != 0) continue;
+
+			const char* name = mono_metadata_string_heap(image, cols[MONO_TYPEREF_NAME]);
+			if (strcmp(name, "Enum") == 0) enum_reference = i + 1;
+			else if (strcmp(name, "FlagsAttribute") == 0) flags_reference = i + 1;
+		}
+
+		field_lists.assign(type_count + 2, field_count + 1);
+		enclosing_types.assign(type_count + 1, 0);
+		enum_types.assign(type_count + 1, false);
+		flags_types.assign(type_count + 1, false);
+
+		std::vector<uint32_t> method_lists(type_count + 2, method_count + 1);
+		uint32_t nms_attribute_type = 0;
+		for (uint32_t i = 0; i < type_count; i++)
+		{
+			uint32_t cols[MONO_TYPEDEF_SIZE];
+			mono_metadata_decode_row(type_definitions_table, i, cols, MONO_TYPEDEF_SIZE);
+
+			field_lists[i + 1] = cols[MONO_TYPEDEF_FIELD_LIST];
+			method_lists[i + 1] = cols[MONO_TYPEDEF_METHOD_LIST];
+
+			uint32_t extends = cols[MONO_TYPEDEF_EXTENDS];
+			enum_types[i + 1] = enum_reference && (extends & MONO_TYPEDEFORREF_MASK) == MONO_TYPEDEFORREF_TYPEREF && (extends >> MONO_TYPEDEFORREF_BITS) == enum_reference;
+
+			if (strcmp(mono_metadata_string_heap(image, cols[MONO_TYPEDEF_NAME]), "NMSAttribute") == 0 &&
+				strcmp(mono_metadata_string_heap(image, cols[MONO_TYPEDEF_NAMESPACE]), "libMBIN") == 0)
+			{
+				nms_attribute_type = i + 1;
+			}
+		}
+
+		uint32_t nested_class_count = mono_table_info_get_rows(nested_classes_table);
+		for (uint32_t i = 0; i < nested_class_count; i++)
+		{
+			uint32_t cols[MONO_NESTED_CLASS_SIZE];
+			mono_metadata_decode_row(nested_classes_table, i, cols, MONO_NESTED_CLASS_SIZE);
+			if (cols[MONO_NESTED_CLASS_NESTED] <= type_count) enclosing_types[cols[MONO_NESTED_CLASS_NESTED]] = cols[MONO_NESTED_CLASS_ENCLOSING];
+		}
+
+		field_constants.assign(field_count + 1, 0);
+		uint32_t constant_count = mono_table_info_get_rows(constants_table);
+		for (uint32_t i = 0; i < constant_count; i++)
+		{
+			uint32_t parent = mono_metadata_decode_row_col(constants_table, i, MONO_CONSTANT_PARENT);
+			if ((parent & MONO_HASCONSTANT_MASK) != MONO_HASCONSTANT_FIEDDEF) continue;
+
+			uint32_t field_row = parent >> MONO_HASCONSTANT_BITS;
+			if (field_row <= field_count) field_constants[field_row] = i + 1;
+		}
+
+		//NMSAttribute constructors, the blob of one without arguments only holds named arguments
+		std::vector<std::pair<uint32_t, bool>> nms_attribute_constructors;
+		if (nms_attribute_type)
+		{
+			for (uint32_t method_row = method_lists[nms_attribute_type]; method_row < method_lists[nms_attribute_type + 1] && method_row <= method_count; method_row++)
+			{
+				uint32_t cols[MONO_METHOD_SIZE];
+				mono_metadata_decode_row(methods_table, method_row - 1, cols, MONO_METHOD_SIZE);
+				if (strcmp(mono_metadata_string_heap(image, cols[MONO_METHOD_NAME]), ".ctor") != 0) continue;
+
+				uint32_t signature_length = 0;
+				const char* signature = Blob(cols[MONO_METHOD_SIGNATURE], signature_length);
+				bool takes_no_arguments = signature_length >= 2 && mono_metadata_decode_value(signature + 1, nullptr) == 0;
+				nms_attribute_constructors.emplace_back(method_row, takes_no_arguments);
+			}
+		}
+
+		field_nms_attributes.assign(field_count + 1, 0);
+		nms_attribute_decodable.assign(field_count + 1, false);
+		uint32_t custom_attribute_count = mono_table_info_get_rows(custom_attributes_table);
+		for (uint32_t i = 0; i < custom_attribute_count; i++)
+		{
+			uint32_t cols[MONO_CUSTOM_ATTR_SIZE];
+			mono_metadata_decode_row(custom_attributes_table, i, cols, MONO_CUSTOM_ATTR_SIZE);
+
+			uint32_t parent_tag = cols[MONO_CUSTOM_ATTR_PARENT] & MONO_CUSTOM_ATTR_MASK;
+			uint32_t parent_row = cols[MONO_CUSTOM_ATTR_PARENT] >> MONO_CUSTOM_ATTR_BITS;
+			uint32_t constructor_tag = cols[MONO_CUSTOM_ATTR_TYPE] & MONO_CUSTOM_ATTR_TYPE_MASK;
+			uint32_t constructor_row = cols[MONO_CUSTOM_ATTR_TYPE] >> MONO_CUSTOM_ATTR_TYPE_BITS;
+
+			if (parent_tag == MONO_CUSTOM_ATTR_TYPEDEF && constructor_tag == MONO_CUSTOM_ATTR_TYPE_MEMBERREF && flags_reference && parent_row <= type_count)
+			{
+				uint32_t member_class = mono_metadata_decode_row_col(member_references_table, constructor_row - 1, MONO_MEMBERREF_CLASS);
+				if ((member_class & MONO_MEMBERREF_PARENT_MASK) == MONO_MEMBERREF_PARENT_TYPEREF && (member_class >> MONO_MEMBERREF_PARENT_BITS) == flags_reference)
+				{
+					flags_types[parent_row] = true;
+				}
+			}
+			else if (parent_tag == MONO_CUSTOM_ATTR_FIELDDEF && constructor_tag == MONO_CUSTOM_ATTR_TYPE_METHODDEF && parent_row <= field_count)
+			{
+				for (const auto& [method_row, takes_no_arguments] : nms_attribute_constructors)
+				{
+					if (method_row != constructor_row) continue;
+
+					field_nms_attributes[parent_row] = i + 1;
+					nms_attribute_decodable[parent_row] = takes_no_arguments;
+				}
+			}
+		}
+	}
+
+	const char* MetadataIndex::TypeName(uint32_t type_row) const
+	{
+		const MonoTableInfo* type_definitions_table = mono_image_get_table_info(image, MONO_TABLE_TYPEDEF);
+		return mono_metadata_string_heap(image, mono_metadata_decode_row_col(type_definitions_table, type_row - 1, MONO_TYPEDEF_NAME));
+	}
+
+	const char* MetadataIndex::TypeNamespace(uint32_t type_row) const
+	{
+		const MonoTableInfo* type_definitions_table = mono_image_get_table_info(image, MONO_TABLE_TYPEDEF);
+		return mono_metadata_string_heap(image, mono_metadata_decode_row_col(type_definitions_table, type_row - 1, MONO_TYPEDEF_NAMESPACE));
+	}
+
+	const char* MetadataIndex::Blob(uint32_t blob_index, uint32_t& length) const
+	{
+		const char* blob = mono_metadata_blob_heap(image, blob_index);
+		length = mono_metadata_decode_blob_size(blob, &blob);
+		return blob;
+	}
+
+	std::string MetadataIndex::EnumUnderlyingType(uint32_t type_row) const
+	{
+		const MonoTableInfo* fields_table = mono_image_get_table_info(image, MONO_TABLE_FIELD);
+
+		//value__ is the only instance field of an enum, its signature is FIELD followed by the type
+		for (uint32_t field_row = field_lists[type_row]; field_row < field_lists[type_row + 1] && field_row <= field_count; field_row++)
+		{
+			uint32_t cols[MONO_FIELD_SIZE];
+			mono_metadata_decode_row(fields_table, field_row - 1, cols, MONO_FIELD_SIZE);
+			if (cols[MONO_FIELD_FLAGS] & MONO_FIELD_ATTR_STATIC) continue;
+
+			uint32_t signature_length = 0;
+			const char* signature = Blob(cols[MONO_FIELD_SIGNATURE], signature_length);
+			const char* cpp_type = signature_length >= 2 ? CppIntegerType(static_cast<uint8_t>(signature[1])) : nullptr;
+			if (cpp_type) return cpp_type;
+		}
+
+		Logger::Warning("[CSharpInterpreter] Enum {0} has no integer value__, assuming int32_t", TypeName(type_row));
+		return "int32_t";
+	}
+
+	std::vector<std::pair<std::string, int64_t>> MetadataIndex::EnumEntries(uint32_t type_row) const
+	{
+		const MonoTableInfo* fields_table = mono_image_get_table_info(image, MONO_TABLE_FIELD);
+		const MonoTableInfo* constants_table = mono_image_get_table_info(image, MONO_TABLE_CONSTANT);
+
+		std::vector<std::pair<std::string, int64_t>> entries;
+		for (uint32_t field_row = field_lists[type_row]; field_row < field_lists[type_row + 1] && field_row <= field_count; field_row++)
+		{
+			uint32_t field_cols[MONO_FIELD_SIZE];
+			mono_metadata_decode_row(fields_table, field_row - 1, field_cols, MONO_FIELD_SIZE);
+			if (!(field_cols[MONO_FIELD_FLAGS] & MONO_FIELD_ATTR_LITERAL) || !field_constants[field_row]) continue;
+
+			uint32_t cols[MONO_CONSTANT_SIZE];
+			mono_metadata_decode_row(constants_table, field_constants[field_row] - 1, cols, MONO_CONSTANT_SIZE);
+
+			uint32_t length = 0;
+			const char* blob = Blob(cols[MONO_CONSTANT_VALUE], length);
+
+			int64_t value = 0;
+			switch (cols[MONO_CONSTANT_TYPE])
+			{
+			case MONO_TYPE_I1:
+				value = *reinterpret_cast<const int8_t*>(blob);
+				break;
+			case MONO_TYPE_U1:
+				value = *reinterpret_cast<const uint8_t*>(blob);
+				break;
+			case MONO_TYPE_I2:
+				value = *reinterpret_cast<const int16_t*>(blob);
+				break;
+			case MONO_TYPE_U2:
+				value = *reinterpret_cast<const uint16_t*>(blob);
+				break;
+			case MONO_TYPE_I4:
+				value = *reinterpret_cast<const int32_t*>(blob);
+				break;
+			case MONO_TYPE_U4:
+				value = *reinterpret_cast<const uint32_t*>(blob);
+				break;
+			case MONO_TYPE_I8:
+				value = *reinterpret_cast<const int64_t*>(blob);
+				break;
+			case MONO_TYPE_U8:
+				value = static_cast<int64_t>(*reinterpret_cast<const uint64_t*>(blob));
+				break;
+			default:
+				Logger::Error("[CSharpInterpreter] Unhandled enum underlying type: {0}", cols[MONO_CONSTANT_TYPE]);
+				continue;
+			}
+
+			entries.emplace_back(mono_metadata_string_heap(image, field_cols[MONO_FIELD_NAME]), value);
+		}
+
+		return entries;
+	}
+
+	MetadataIndex::AttributeState MetadataIndex::ReadNMSAttribute(uint32_t field_row, NMSAttributeValues& out) const
+	{
+		if (field_row > field_count || !field_nms_attributes[field_row]) return AttributeState::None;
+		if (!nms_attribute_decodable[field_row]) return AttributeState::Undecodable;
+
+		const MonoTableInfo* custom_attributes_table = mono_image_get_table_info(image, MONO_TABLE_CUSTOMATTRIBUTE);
+		uint32_t length = 0;
+		const char* blob = Blob(mono_metadata_decode_row_col(custom_attributes_table, field_nms_attributes[field_row] - 1, MONO_CUSTOM_ATTR_VALUE), length);
+
+		AttributeBlobReader reader(blob, length);
+		uint16_t prolog = 0;
+		uint16_t named_count = 0;
+		if (!reader.Value(prolog) || prolog != 1 || !reader.Value(named_count)) return AttributeState::Undecodable;
+
+		//decoded into a copy, out is only touched once the whole blob is understood
+		NMSAttributeValues values = out;
+		for (uint16_t i = 0; i < named_count; i++)
+		{
+			uint8_t kind = 0;
+			uint8_t type = 0;
+			uint8_t element_type = 0;
+			std::string name;
+			bool name_is_null = false;
+			AttributeBlobReader::Argument argument;
+			if (!reader.Value(kind) || (kind != attribute_named_field && kind != attribute_named_property) ||
+				!reader.Type(type, element_type) || !reader.String(name, name_is_null) || !reader.Read(type, element_type, argument))
+			{
+				return AttributeState::Undecodable;
+			}
+
+			if (name == "Size") values.size = static_cast<uint32_t>(argument.integer);
+			else if (name == "Alignment") values.alignment = static_cast<uint32_t>(argument.integer);
+			else if (name == "Ignore") values.ignore = argument.integer != 0;
+			else if (name == "MxmlName") values.mxml_name = argument.is_null ? std::string() : argument.text;
+			else if (name == "Index") values.index = static_cast<int32_t>(argument.integer);
+			else if (name == "KeyField") values.key_field = argument.is_null ? std::string() : argument.text;
+			else if (name == "EnumType" || name == "EnumValue") values.has_enum = values.has_enum || !argument.is_null;
+		}
+
+		out = std::move(values);
+		return AttributeState::Decoded;
+	}
+}
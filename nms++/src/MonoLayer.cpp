@@ -1,7 +1,13 @@
 #include "../header/MonoLayer.h"
 #include "../header/engine_io.h"
+#include "../header/AotCache.h"
+#include "../header/Profiler.h"
+#include "mono/metadata/attrdefs.h"
+#include <chrono>
+#include <filesystem>
 
-MonoLayer mono_layer = MonoLayer("libMBIN.dll");
+//constructed empty, mono starts on first use
+MonoLayer mono_layer;
 
 static void PrintCallback(const char* msg, mono_bool is_stdout)
 {
@@ -15,35 +21,182 @@ static void LogCallback(const char* log_domain, const char* log_level, const cha
     if(fatal) Logger::Critical("Critical error!");
 }
 
-MonoLayer::MonoLayer(const char* dll)
+#ifdef _WIN32
+static constexpr const char* search_path_separator = ";";
+#else
+static constexpr const char* search_path_separator = ":";
+#endif
+
+static double MillisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool MonoLayer::Configure(const nmspp::RuntimeOptions& new_options)
+{
+    std::lock_guard<std::mutex> lock(init_mutex);
+    if (startup_attempted)
+    {
+        Logger::Warning("[MonoLayer] Runtime already started, options ignored");
+        return false;
+    }
+
+    options = new_options;
+    return true;
+}
+
+nmspp::StartupTimings MonoLayer::GetStartupTimings() const
+{
+    std::lock_guard<std::mutex> lock(init_mutex);
+    return startup_timings;
+}
+
+bool MonoLayer::InitializeSlow()
+{
+    std::lock_guard<std::mutex> lock(init_mutex);
+    if (initialized.load(std::memory_order_relaxed)) return true;
+    if (startup_attempted) return false;
+
+    startup_attempted = true;
+    bool success = Startup();
+    initialized.store(success, std::memory_order_release);
+
+    return success;
+}
+
+bool MonoLayer::Startup()
 {
 	Logger::Info("Initializing mono...");
 
-    mono_trace_set_level_string("debug");
-    mono_trace_set_mask_string("asm");
+    auto startup_begin = std::chrono::steady_clock::now();
+    auto phase_begin = startup_begin;
+
     mono_trace_set_log_handler(&LogCallback, nullptr);
+    mono_trace_set_level_string(options.trace_level.c_str());
+    if (!options.trace_mask.empty()) mono_trace_set_mask_string(options.trace_mask.c_str());
+
+    //a stale cache is not an error, the assemblies are then loaded and jitted as usual
+    aot_active = options.use_aot && AotCache::IsCurrent(options);
+    if (options.use_aot && !aot_active)
+    {
+        Logger::Warning("[MonoLayer] AOT cache in {0} is missing or stale, falling back to the JIT", options.aot_cache_dir);
+    }
+
+    if (aot_active)
+    {
+        //the cache comes first so mscorlib and friends are picked up next to their images
+        mono_jit_set_aot_mode(MONO_AOT_MODE_NORMAL);
+        std::string search_path = options.aot_cache_dir + search_path_separator + options.assemblies_path;
+        mono_set_assemblies_path(search_path.c_str());
+    }
+    else
+    {
+        mono_set_assemblies_path(options.assemblies_path.c_str());
+    }
+    startup_timings.tracing_ms = MillisecondsSince(phase_begin);
+    startup_timings.aot = aot_active;
 
-	mono_set_assemblies_path("lib/mono/");
+    //callbacks and allocation tracking must be in place before anything gets compiled
+    nmspp::Profiler::Install(options.profiler);
 
+    phase_begin = std::chrono::steady_clock::now();
 	MonoDomain* _root_domain = mono_jit_init("Runtime");
 	if (!_root_domain)
 	{
 		Logger::Critical("Failed to initialize jit compiler!");
-		return;
+		return false;
 	}
 	root_domain = _root_domain;
+    startup_timings.jit_init_ms = MillisecondsSince(phase_begin);
 
+    phase_begin = std::chrono::steady_clock::now();
 	app_domain = mono_domain_create_appdomain(const_cast<char*>("AppDomain"), nullptr);
 	mono_domain_set(app_domain, true);
-    mono_domain_set_config(app_domain, "lib/mono/", "machine.config");
-        
+    mono_domain_set_config(app_domain, options.config_dir.c_str(), options.config_file.c_str());
+    startup_timings.domain_ms = MillisecondsSince(phase_begin);
+
+    phase_begin = std::chrono::steady_clock::now();
+    if (aot_active)
+    {
+        //opened by file name, mono finds the AOT image through the image name
+        std::string cached_path = AotCache::CachedAssemblyPath(options);
+        assembly = mono_domain_assembly_open(app_domain, cached_path.c_str());
+    }
+    else
+    {
+        assembly = LoadCSharpAssembly(options.dll_path);
+    }
 
-    assembly = LoadCSharpAssembly("libMBIN.dll");
+    //optional, IO marshals field by field without it
+    if (assembly && !options.helper_path.empty() && std::filesystem::exists(options.helper_path))
+    {
+        std::string helper_path = std::filesystem::absolute(options.helper_path).string();
+        helper_assembly = mono_domain_assembly_open(app_domain, helper_path.c_str());
+        if (!helper_assembly) Logger::Warning("[MonoLayer] Failed to load helper assembly {0}", options.helper_path);
+    }
+    startup_timings.assembly_load_ms = MillisecondsSince(phase_begin);
     //PrintAssemblyTypes();
+
+    startup_timings.total_ms = MillisecondsSince(startup_begin);
+
+    if (!assembly)
+    {
+        Logger::Critical("Failed to load {0}!", options.dll_path);
+        return false;
+    }
+
+    return true;
+}
+
+static void CollectAssembly(void* assembly, void* user_data)
+{
+    static_cast<std::vector<MonoAssembly*>*>(user_data)->push_back(static_cast<MonoAssembly*>(assembly));
+}
+
+bool MonoLayer::BuildAotCache()
+{
+    if (!EnsureInitialized()) return false;
+
+    if (aot_active)
+    {
+        Logger::Error("[MonoLayer] The AOT cache is in use by this process and cannot be rebuilt");
+        return false;
+    }
+
+    //load the whole reference closure of libMBIN, repeated until no new assembly shows up
+    std::vector<MonoAssembly*> loaded;
+    size_t previous_count = 0;
+    do
+    {
+        previous_count = loaded.size();
+        loaded.clear();
+        mono_assembly_foreach(&CollectAssembly, &loaded);
+
+        for (MonoAssembly* loaded_assembly : loaded)
+        {
+            MonoImageOpenStatus status;
+            mono_assembly_load_references(mono_assembly_get_image(loaded_assembly), &status);
+        }
+    } while (loaded.size() != previous_count);
+
+    //libMBIN first, its image is backed by a mapping rather than opened from disk
+    std::vector<std::string> assembly_paths = { options.dll_path };
+    for (MonoAssembly* loaded_assembly : loaded)
+    {
+        if (loaded_assembly == assembly) continue;
+
+        const char* file_name = mono_image_get_filename(mono_assembly_get_image(loaded_assembly));
+        if (file_name && std::filesystem::exists(file_name)) assembly_paths.emplace_back(file_name);
+    }
+
+    return AotCache::Build(options, assembly_paths);
 }
 
 MonoLayer::~MonoLayer()
 {
+    //before any teardown, the report still needs the managed method names
+    if (root_domain) nmspp::Profiler::WriteShutdownReport();
+
     if (app_domain)
     {
         mono_domain_unload(app_domain);
@@ -61,23 +214,160 @@ MonoLayer::~MonoLayer()
     }
 }
 
-void MonoLayer::LogMonoObjectFields(MonoObject* obj)
+MonoMethod* MonoLayer::GetMethod(MonoClass* _class, const char* method_name, int param_count)
+{
+    CachedMethod* cached = FindMethod(_class, method_name, param_count);
+    return cached ? cached->method : nullptr;
+}
+
+MonoLayer::CachedMethod* MonoLayer::FindMethod(MonoClass* _class, const char* method_name, int param_count)
+{
+    invoke_stats.method_lookups.fetch_add(1, std::memory_order_relaxed);
+
+    MethodKey key{ _class, method_name, param_count };
+    {
+        std::shared_lock<std::shared_mutex> lock(method_cache_mutex);
+
+        auto found = method_cache.find(key);
+        if (found != method_cache.end())
+        {
+            invoke_stats.method_cache_hits.fetch_add(1, std::memory_order_relaxed);
+            return found->second.method ? &found->second : nullptr;
+        }
+    }
+
+    //misses are cached as well, a failing lookup walks the class only once
+    MonoMethod* method = mono_class_get_method_from_name(_class, method_name, param_count);
+
+    std::unique_lock<std::shared_mutex> lock(method_cache_mutex);
+    auto [inserted, is_new] = method_cache.try_emplace(std::move(key));
+    if (is_new) inserted->second.method = method;
+
+    return inserted->second.method ? &inserted->second : nullptr;
+}
+
+InvokeStats MonoLayer::GetInvokeStats() const
+{
+    InvokeStats stats;
+    stats.runtime_invokes = invoke_stats.runtime_invokes.load(std::memory_order_relaxed);
+    stats.thunk_invokes = invoke_stats.thunk_invokes.load(std::memory_order_relaxed);
+    stats.method_lookups = invoke_stats.method_lookups.load(std::memory_order_relaxed);
+    stats.method_cache_hits = invoke_stats.method_cache_hits.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void MonoLayer::LogInvokeStats() const
 {
-    std::vector<MonoClassField*> mono_fields;
+    InvokeStats stats = GetInvokeStats();
+    Logger::Info("[MonoLayer] {0} runtime invokes, {1} thunk invokes, {2} method lookups, {3:.1f}% cache hits",
+        stats.runtime_invokes, stats.thunk_invokes, stats.method_lookups, stats.HitRate() * 100.0);
+
+    std::shared_lock<std::shared_mutex> lock(method_cache_mutex);
+    for (const auto& [key, cached] : method_cache)
+    {
+        if (!cached.method) continue;
+
+        Logger::Info("[MonoLayer] {0}::{1}({2}): {3} calls", mono_class_get_name(key._class), key.name, key.param_count, cached.calls.load(std::memory_order_relaxed));
+    }
+}
+
+const MonoClassLayout& MonoLayer::GetClassLayout(MonoClass* mono_class)
+{
+    {
+        std::shared_lock<std::shared_mutex> lock(layouts_mutex);
+
+        auto found = class_layouts.find(mono_class);
+        if (found != class_layouts.end()) return found->second;
+    }
+
+    MonoClassLayout layout;
+    layout.mono_class = mono_class;
+
     void* iter = nullptr;
     MonoClassField* field;
+    while ((field = mono_class_get_fields(mono_class, &iter)))
+    {
+        MonoFieldLayout field_layout;
+        field_layout.field = field;
+        field_layout.type = mono_field_get_type(field);
+        field_layout.name = mono_field_get_name(field);
+        field_layout.offset = mono_field_get_offset(field);
+        field_layout.type_kind = mono_type_get_type(field_layout.type);
+        field_layout.is_static = (mono_field_get_flags(field) & MONO_FIELD_ATTR_STATIC) != 0;
+
+        if (field_layout.type_kind == MONO_TYPE_SZARRAY || field_layout.type_kind == MONO_TYPE_ARRAY)
+        {
+            MonoClass* array_class = mono_class_from_mono_type(field_layout.type);
+            field_layout.element_class = mono_class_get_element_class(array_class);
+            field_layout.element_size = static_cast<uint32_t>(mono_class_array_element_size(field_layout.element_class));
+        }
 
-    MonoClass* object_class = mono_object_get_class(obj);
-    const char* class_name = mono_class_get_name(object_class);
+        layout.fields.push_back(field_layout);
+    }
+
+    //another thread may have built the same layout in the meantime, the first one wins
+    std::unique_lock<std::shared_mutex> lock(layouts_mutex);
+    return class_layouts.emplace(mono_class, std::move(layout)).first->second;
+}
 
-    while ((field = mono_class_get_fields(object_class, &iter)))
+const MonoListLayout* MonoLayer::GetListLayout(MonoClass* list_class)
+{
     {
-        mono_fields.push_back(field);
+        std::shared_lock<std::shared_mutex> lock(layouts_mutex);
+
+        auto found = list_layouts.find(list_class);
+        if (found != list_layouts.end())
+        {
+            return found->second.list_class ? &found->second : nullptr;
+        }
     }
 
-    for (MonoClassField* field : mono_fields)
+    MonoListLayout list_layout;
+    const MonoFieldLayout* items_field = nullptr;
+    const MonoFieldLayout* size_field = nullptr;
+    const MonoFieldLayout* version_field = nullptr;
+
+    //subclasses like HashMap<T> keep the storage in their List<T> base
+    for (MonoClass* _class = list_class; _class && !items_field; _class = mono_class_get_parent(_class))
     {
-        const char* field_name = mono_field_get_name(field);
+        for (const MonoFieldLayout& field_layout : GetClassLayout(_class).fields)
+        {
+            if (strcmp(field_layout.name, "_items") == 0) items_field = &field_layout;
+            else if (strcmp(field_layout.name, "_size") == 0) size_field = &field_layout;
+            else if (strcmp(field_layout.name, "_version") == 0) version_field = &field_layout;
+        }
+    }
+
+    if (!items_field || !size_field || !items_field->element_class)
+    {
+        Logger::Warning("[MonoLayer] {0} has no List<T> storage, falling back to reflection", mono_class_get_name(list_class));
+
+        std::unique_lock<std::shared_mutex> lock(layouts_mutex);
+        list_layouts.emplace(list_class, list_layout);
+        return nullptr;
+    }
+
+    list_layout.list_class = list_class;
+    list_layout.items_offset = items_field->offset;
+    list_layout.size_offset = size_field->offset;
+    list_layout.version_offset = version_field ? version_field->offset : 0;
+    list_layout.element_class = items_field->element_class;
+    list_layout.element_size = items_field->element_size;
+    list_layout.element_is_valuetype = mono_class_is_valuetype(items_field->element_class);
+
+    std::unique_lock<std::shared_mutex> lock(layouts_mutex);
+    return &list_layouts.emplace(list_class, list_layout).first->second;
+}
+
+void MonoLayer::LogMonoObjectFields(MonoObject* obj)
+{
+    MonoClass* object_class = mono_object_get_class(obj);
+    const char* class_name = mono_class_get_name(object_class);
+
+    for (const MonoFieldLayout& field_layout : GetClassLayout(object_class).fields)
+    {
+        MonoClassField* field = field_layout.field;
+        const char* field_name = field_layout.name;
 
         // Get the field value as a MonoObject*
         MonoObject* field_value_obj = mono_field_get_value_object(app_domain, field, obj);
@@ -105,11 +395,17 @@ void MonoLayer::LogMonoObjectFields(MonoObject* obj)
 
 MonoAssembly* MonoLayer::LoadCSharpAssembly(const std::string& assembly_path)
 {
-    uint32_t file_size = 0;
-    char* file_data = IO::ReadBytes(assembly_path, file_size);
+    //mono reads the image straight from the mapping, which stays open until the runtime is cleaned up
+    if (!assembly_file.Open(assembly_path))
+    {
+        return nullptr;
+    }
+
+    //named after the file so the image resolves like one opened from disk, AOT lookup included
+    std::string image_name = std::filesystem::absolute(assembly_path).string();
 
     MonoImageOpenStatus status;
-    MonoImage* image = mono_image_open_from_data_full(file_data, file_size, 1, &status, 0);
+    MonoImage* image = mono_image_open_from_data_with_name(const_cast<char*>(assembly_file.Data()), static_cast<uint32_t>(assembly_file.Size()), 0, &status, 0, image_name.c_str());
 
     if (status != MONO_IMAGE_OK)
     {
@@ -117,6 +413,7 @@ MonoAssembly* MonoLayer::LoadCSharpAssembly(const std::string& assembly_path)
 
 		Logger::Error("Mono image open from data failed! {0}", error_message);
 
+        assembly_file.Close();
         return nullptr;
     }
     MonoAssembly* assembly = mono_assembly_load_from_full(image, assembly_path.c_str(), &status, 0);
@@ -126,16 +423,16 @@ MonoAssembly* MonoLayer::LoadCSharpAssembly(const std::string& assembly_path)
         Logger::Error("Failed to load assembly!");
     }
 
+    //the assembly holds its own reference to the image
     mono_image_close(image);
 
-    //free the file data
-    delete[] file_data;
-
     return assembly;
 }
 
 MonoClass* MonoLayer::GetClass(const char* const& namespace_name, const char* const& class_name)
 {
+    if (!EnsureInitialized()) return nullptr;
+
     MonoImage* image = mono_assembly_get_image(assembly);
     MonoClass* _class = mono_class_from_name_case(image, namespace_name, class_name);
 
@@ -226,23 +523,3 @@ void MonoLayer::PrintAssemblyTypes()
         }
     }
 }
-
-void MonoLayer::PrepareArgsVec(std::vector<void*>&) {} // base case for recursion
-
-void* MonoLayer::ObjectConverter::ConvertToMonoObject(int value)
-{
-    // only for int32 rn FIXME
-    MonoClass* int_class = mono_get_int32_class();
-    return mono_value_box(mono_layer.app_domain, int_class, &value);
-}
-
-void* MonoLayer::ObjectConverter::ConvertToMonoObject(float value)
-{
-    MonoClass* float_class = mono_get_single_class();
-    return mono_value_box(mono_layer.app_domain,float_class, &value);
-}
-
-void* MonoLayer::ObjectConverter::ConvertToMonoObject(const std::string& value)
-{
-    return mono_string_new(mono_layer.app_domain, value.c_str());
-}
@@ -0,0 +1,557 @@
+#include "../header/CSharpInterpreter.h"
+#include "../header/Logger.h"
+#include "../header/mxml_codec.hpp"
+#include <sstream>
+#include <algorithm>
+#include <cctype>
+
+namespace CSharpInterpreter
+{
+	using NameEntry = std::pair<std::string, int64_t>;
+
+	//seeds per bucket and the entry in every slot, see mxml_codec::Find
+	struct PerfectHash
+	{
+		std::vector<uint32_t> buckets;
+		std::vector<const NameEntry*> slots;
+	};
+
+	static size_t PowerOfTwo(size_t count)
+	{
+		size_t power = 1;
+		while (power < count) power <<= 1;
+		return power;
+	}
+
+	//biggest buckets are placed first while most slots are still free, a full table only doubles when a bucket finds no seed at all
+	static bool BuildPerfectHash(const std::vector<NameEntry>& entries, PerfectHash& out)
+	{
+		size_t bucket_count = PowerOfTwo(std::max<size_t>(entries.size() / 2, 1));
+		std::vector<std::vector<const NameEntry*>> buckets(bucket_count);
+		for (const NameEntry& entry : entries)
+		{
+			buckets[mxml_codec::BucketIndex(mxml_codec::Hash(entry.first), bucket_count)].push_back(&entry);
+		}
+
+		std::vector<size_t> bucket_order(bucket_count);
+		for (size_t i = 0; i < bucket_count; i++) bucket_order[i] = i;
+		std::stable_sort(bucket_order.begin(), bucket_order.end(), [&buckets](size_t a, size_t b) { return buckets[a].size() > buckets[b].size(); });
+
+		for (size_t slot_count = PowerOfTwo(std::max<size_t>(entries.size(), 1)); slot_count <= entries.size() * 8 + 8; slot_count <<= 1)
+		{
+			out.buckets.assign(bucket_count, 0);
+			out.slots.assign(slot_count, nullptr);
+
+			bool placed_all = true;
+			for (size_t bucket_index : bucket_order)
+			{
+				const std::vector<const NameEntry*>& bucket = buckets[bucket_index];
+				if (bucket.empty()) break;
+
+				bool placed = false;
+				std::vector<size_t> bucket_slots;
+				for (uint32_t seed = 0; seed < (1u << 20) && !placed; seed++)
+				{
+					bucket_slots.clear();
+					placed = true;
+					for (const NameEntry* entry : bucket)
+					{
+						size_t slot = mxml_codec::SlotIndex(mxml_codec::Hash(entry->first), seed, slot_count);
+						if (out.slots[slot] || std::find(bucket_slots.begin(), bucket_slots.end(), slot) != bucket_slots.end())
+						{
+							placed = false;
+							break;
+						}
+
+						bucket_slots.push_back(slot);
+					}
+
+					if (placed)
+					{
+						out.buckets[bucket_index] = seed;
+						for (size_t i = 0; i < bucket.size(); i++) out.slots[bucket_slots[i]] = bucket[i];
+					}
+				}
+
+				if (!placed)
+				{
+					placed_all = false;
+					break;
+				}
+			}
+
+			if (placed_all) return true;
+		}
+
+		return false;
+	}
+
+	static std::string Quote(const std::string& text)
+	{
+		std::string quoted = "\"";
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\') quoted += '\\';
+			quoted += c;
+		}
+		return quoted + "\"";
+	}
+
+	//names go into the written files as they are
+	static std::string EscapeXml(const std::string& text)
+	{
+		std::string escaped;
+		for (char c : text)
+		{
+			switch (c)
+			{
+			case '&': escaped += "&amp;"; break;
+			case '<': escaped += "&lt;"; break;
+			case '>': escaped += "&gt;"; break;
+			case '"': escaped += "&quot;"; break;
+			default: escaped += c; break;
+			}
+		}
+		return escaped;
+	}
+
+	static std::string NameLiteral(const std::string& name)
+	{
+		return Quote(EscapeXml(name)) + "sv";
+	}
+
+	//the name table of a type or enum, false if two names hash to the same value.
+	//enums also get their entries sorted by value for the writer.
+	static bool WriteNames(std::stringstream& ss, const std::string& cpp_type, const std::vector<NameEntry>& entries, const std::string* template_name, const EnumInfo* enum_info)
+	{
+		PerfectHash perfect_hash;
+		if (!BuildPerfectHash(entries, perfect_hash)) return false;
+
+		ss << "template <>\nstruct Names<" << cpp_type << ">\n{\n";
+		if (template_name) ss << "\tstatic constexpr std::string_view name = " << Quote(*template_name) << ";\n";
+
+		if (enum_info)
+		{
+			//.NET orders entries as unsigned, the first entry of a value names it
+			std::vector<NameEntry> by_value = entries;
+			std::stable_sort(by_value.begin(), by_value.end(), [](const NameEntry& a, const NameEntry& b) { return static_cast<uint64_t>(a.second) < static_cast<uint64_t>(b.second); });
+			by_value.erase(std::unique(by_value.begin(), by_value.end(), [](const NameEntry& a, const NameEntry& b) { return a.second == b.second; }), by_value.end());
+
+			ss << "\tstatic constexpr bool flags = " << (enum_info->is_flags ? "true" : "false") << ";\n";
+			ss << "\tstatic constexpr NameSlot values[" << by_value.size() << "] =\n\t{\n";
+			for (const NameEntry& entry : by_value)
+			{
+				ss << "\t\t{ " << Quote(entry.first) << ", " << entry.second << " },\n";
+			}
+			ss << "\t};\n";
+		}
+
+		ss << "\tstatic constexpr uint32_t buckets[" << perfect_hash.buckets.size() << "] = { ";
+		for (size_t i = 0; i < perfect_hash.buckets.size(); i++)
+		{
+			ss << (i ? ", " : "") << perfect_hash.buckets[i];
+		}
+		ss << " };\n";
+
+		ss << "\tstatic constexpr NameSlot slots[" << perfect_hash.slots.size() << "] =\n\t{\n";
+		for (const NameEntry* entry : perfect_hash.slots)
+		{
+			if (entry) ss << "\t\t{ " << Quote(entry->first) << ", " << entry->second << " },\n";
+			else ss << "\t\t{},\n";
+		}
+		ss << "\t};\n";
+		ss << "};\n\n";
+
+		return true;
+	}
+
+	//"namespace.Nesting/Enum", the way mono names the field types
+	static std::string EnumKey(const EnumInfo& enum_info)
+	{
+		return enum_info.namespace_name + "." + enum_info.nesting_class_name + "/" + enum_info.name;
+	}
+
+	//the generated enum classes are nested the same way as in libMBIN except for a few corner cases,
+	//the table is keyed on the member type instead of spelling out the enum name
+	static std::string EnumMemberType(const TypeInfo& type_info, const FieldInfo& field_info, FieldKind kind)
+	{
+		std::string member_type = "decltype(" + CppTypeName(type_info) + "::" + field_info.name + ")";
+		if (kind == FieldKind::EnumList) return member_type + "::value_type";
+		if (kind == FieldKind::EnumArray) return "std::remove_extent_t<" + member_type + ">";
+		return member_type;
+	}
+
+	//libMBIN gives a few types their own MXML form
+	enum class MxmlForm
+	{
+		Fields,
+		//NMSString*, VariableSizeString and HashedString, the string is the value of the property
+		String,
+		//the seed is the value of the property
+		Seed,
+		//channels are written as floats
+		Colour32,
+		//only the link is kept, the template is not represented by the generated types
+		Linkable
+	};
+
+	//libMBIN writes these without their class name
+	static bool IsFakeType(const std::string& type_name)
+	{
+		return type_name == "Colour" || type_name == "Colour32" || type_name == "Vector2f" || type_name == "Vector3f" || type_name == "Vector4f" || type_name == "Vector4i";
+	}
+
+	//System.Byte[] is written as base64, other arrays element by element
+	static bool IsByteArray(const FieldInfo& field_info)
+	{
+		return field_info.type_name == "System.Byte[]";
+	}
+
+	static MxmlForm GetMxmlForm(const TypeInfo& type_info)
+	{
+		if (type_info.name == "GcSeed") return MxmlForm::Seed;
+		if (type_info.name == "Colour32") return MxmlForm::Colour32;
+		if (type_info.name == "LinkableNMSTemplate") return MxmlForm::Linkable;
+
+		auto first_field = std::find_if(type_info.field_infos.begin(), type_info.field_infos.end(), [](const FieldInfo& field_info) { return field_info.is_serialized; });
+		if (first_field != type_info.field_infos.end() && first_field->name == "Value")
+		{
+			FieldKind kind = ClassifyField(*first_field);
+			if (kind == FieldKind::String || kind == FieldKind::DynamicString) return MxmlForm::String;
+		}
+
+		return MxmlForm::Fields;
+	}
+
+	static void WriteReadProperty(std::stringstream& ss, const TypeInfo& type_info, const std::vector<const FieldInfo*>& fields)
+	{
+		std::string cpp_type = CppTypeName(type_info);
+
+		switch (GetMxmlForm(type_info))
+		{
+		case MxmlForm::String:
+			ss << "inline void ReadProperty(Reader& reader, const Property& property, " << cpp_type << "& out)\n{\n";
+			ss << "\treader.Read(property, out.Value);\n";
+			ss << "}\n\n";
+			return;
+		case MxmlForm::Seed:
+			ss << "inline void ReadProperty(Reader& reader, const Property& property, " << cpp_type << "& out)\n{\n";
+			ss << "\treader.Read(property, out.Seed);\n";
+			ss << "\tout.UseSeedValue = true;\n";
+			ss << "}\n\n";
+			return;
+		case MxmlForm::Linkable:
+			ss << "inline void ReadProperty(Reader& reader, const Property& property, " << cpp_type << "& out)\n{\n";
+			ss << "\treader.ReadText(property.linked, out.Linked.Value);\n";
+			ss << "\treader.Skip(property);\n";
+			ss << "}\n\n";
+			return;
+		default:
+			break;
+		}
+
+		if (fields.empty())
+		{
+			ss << "inline void ReadProperty(Reader& reader, const Property& property, " << cpp_type << "&)\n{\n";
+			ss << "\treader.Skip(property);\n";
+			ss << "}\n\n";
+			return;
+		}
+
+		bool is_colour32 = GetMxmlForm(type_info) == MxmlForm::Colour32;
+
+		ss << "inline void ReadProperty(Reader& reader, const Property& property, " << cpp_type << "& out)\n{\n";
+		ss << "\tProperty child;\n";
+		ss << "\twhile (reader.Next(property, child))\n\t{\n";
+		ss << "\t\tswitch (Lookup<" << cpp_type << ">(child.name))\n\t\t{\n";
+		for (size_t i = 0; i < fields.size(); i++)
+		{
+			const char* read = is_colour32 && fields[i]->type_name == "System.Byte" ? "ReadUnorm8" : IsByteArray(*fields[i]) ? "ReadBase64" : "Read";
+			ss << "\t\tcase " << i << ": reader." << read << "(child, out." << fields[i]->name << "); break;\n";
+		}
+		ss << "\t\tdefault: reader.Skip(child); break;\n";
+		ss << "\t\t}\n";
+		ss << "\t}\n";
+		ss << "}\n\n";
+	}
+
+	//the _id of an element, the value the key property of the element is written with. empty if it has no such value.
+	static std::string KeyExpression(const FieldInfo& key_field, const std::unordered_map<std::string, const TypeInfo*>& struct_types)
+	{
+		std::string member = "element." + key_field.name;
+
+		switch (ClassifyField(key_field))
+		{
+		case FieldKind::Value:
+		case FieldKind::Enum:
+			return member;
+		case FieldKind::String:
+		case FieldKind::DynamicString:
+			return "std::string_view(" + member + ")";
+		case FieldKind::Struct:
+		{
+			auto type_iter = struct_types.find(ShortTypeName(key_field.type_name));
+			if (type_iter == struct_types.end()) return {};
+
+			switch (GetMxmlForm(*type_iter->second))
+			{
+			case MxmlForm::String:
+				return "std::string_view(" + member + ".Value)";
+			case MxmlForm::Seed:
+				return member + ".Seed";
+			case MxmlForm::Fields:
+				return IsFakeType(type_iter->second->name) ? std::string() : NameLiteral(type_iter->second->name);
+			default:
+				return {};
+			}
+		}
+		default:
+			return {};
+		}
+	}
+
+	//HashMaps key their values on NMSAttribute KeyField, lists of templates with a single ID field key them on it and number repeats
+	static std::string WriteKeyedList(const FieldInfo& field_info, const std::unordered_map<std::string, const TypeInfo*>& struct_types, const std::string& name_literal)
+	{
+		auto element_iter = struct_types.find(ShortTypeName(ElementTypeName(field_info.type_name)));
+		if (element_iter == struct_types.end()) return {};
+		const TypeInfo& element_type = *element_iter->second;
+
+		bool is_hash_map = field_info.type_name.find("libMBIN.NMS.HashMap") != std::string::npos;
+
+		const FieldInfo* key_field = nullptr;
+		if (is_hash_map)
+		{
+			for (const FieldInfo& element_field : element_type.field_infos)
+			{
+				if (element_field.name == field_info.key_field) key_field = &element_field;
+			}
+		}
+		else
+		{
+			//libMBIN's TypeHasID, exactly one field named ID in any case
+			size_t id_count = 0;
+			for (const FieldInfo& element_field : element_type.field_infos)
+			{
+				std::string upper_name = element_field.name;
+				std::transform(upper_name.begin(), upper_name.end(), upper_name.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+				if (upper_name != "ID") continue;
+
+				key_field = &element_field;
+				id_count++;
+			}
+
+			if (id_count != 1) key_field = nullptr;
+		}
+
+		if (!key_field || !key_field->is_serialized) return {};
+
+		std::string key = KeyExpression(*key_field, struct_types);
+		if (key.empty()) return {};
+
+		return "writer.WriteKeyed(" + name_literal + ", value." + field_info.name + ", [](const " + CppTypeName(element_type) + "& element) { return " + key + "; }, " + (is_hash_map ? "false" : "true") + ");";
+	}
+
+	static void WriteWriteProperty(std::stringstream& ss, const TypeInfo& type_info, const std::vector<const FieldInfo*>& fields, const std::unordered_map<std::string, const TypeInfo*>& struct_types)
+	{
+		std::string cpp_type = CppTypeName(type_info);
+		MxmlForm form = GetMxmlForm(type_info);
+
+		ss << "inline void WriteProperty(Writer& writer, std::string_view name, const " << cpp_type << "& value)\n{\n";
+		switch (form)
+		{
+		case MxmlForm::String:
+			ss << "\twriter.Write(name, value.Value);\n";
+			break;
+		case MxmlForm::Seed:
+			ss << "\twriter.Write(name, value.Seed);\n";
+			break;
+		case MxmlForm::Linkable:
+			ss << "\twriter.Begin(name);\n";
+			ss << "\twriter.Linked(value.Linked.Value);\n";
+			ss << "\twriter.End();\n";
+			break;
+		case MxmlForm::Colour32:
+			ss << "\twriter.Begin(name);\n";
+			for (const FieldInfo* field_info : fields)
+			{
+				ss << "\twriter.WriteUnorm8(" << NameLiteral(field_info->mxml_name) << ", value." << field_info->name << ");\n";
+			}
+			ss << "\twriter.End();\n";
+			break;
+		case MxmlForm::Fields:
+			ss << "\twriter.Begin(name);\n";
+			if (!IsFakeType(type_info.name)) ss << "\twriter.ClassName(" << NameLiteral(type_info.name) << ");\n";
+			ss << "\tWriteFields(writer, value);\n";
+			ss << "\twriter.End();\n";
+			break;
+		}
+		ss << "}\n\n";
+
+		if (form != MxmlForm::Fields) return;
+
+		if (fields.empty())
+		{
+			ss << "inline void WriteFields(Writer&, const " << cpp_type << "&)\n{\n}\n\n";
+			return;
+		}
+
+		ss << "inline void WriteFields(Writer& writer, const " << cpp_type << "& value)\n{\n";
+		for (const FieldInfo* field_info : fields)
+		{
+			std::string name_literal = NameLiteral(field_info->mxml_name);
+			FieldKind kind = ClassifyField(*field_info);
+
+			if (IsByteArray(*field_info))
+			{
+				ss << "\twriter.WriteBase64(" << name_literal << ", value." << field_info->name << ");\n";
+				continue;
+			}
+
+			if ((kind == FieldKind::Array || kind == FieldKind::EnumArray) && !field_info->enum_names.empty())
+			{
+				//one name per element, the names libMBIN has beyond the array are not used
+				std::string names_variable = field_info->name + "_names";
+				ss << "\tstatic constexpr std::string_view " << names_variable << "[" << field_info->size << "] = { ";
+				for (uint32_t i = 0; i < field_info->size; i++)
+				{
+					ss << (i ? ", " : "") << Quote(i < field_info->enum_names.size() ? EscapeXml(field_info->enum_names[i]) : std::string());
+				}
+				ss << " };\n";
+				ss << "\twriter.Write(" << name_literal << ", value." << field_info->name << ", " << names_variable << ");\n";
+				continue;
+			}
+
+			if (kind == FieldKind::List)
+			{
+				std::string keyed_list = WriteKeyedList(*field_info, struct_types, name_literal);
+				if (!keyed_list.empty())
+				{
+					ss << "\t" << keyed_list << "\n";
+					continue;
+				}
+			}
+
+			ss << "\twriter.Write(" << name_literal << ", value." << field_info->name << ");\n";
+		}
+		ss << "}\n\n";
+	}
+
+	std::string GenerateMxmlCodec(const std::vector<std::string>& sorted_struct_names, const std::unordered_map<std::string, const TypeInfo*>& struct_types, const std::vector<EnumInfo>& enum_infos, const MbinHeaderInfo& header_info)
+	{
+		std::vector<const TypeInfo*> types;
+		for (const std::string& struct_name : sorted_struct_names)
+		{
+			auto type_iter = struct_types.find(struct_name);
+
+			//types without namespace are not written to GeneratedCppTypes.h either
+			if (type_iter != struct_types.end() && !type_iter->second->namespace_name.empty()) types.push_back(type_iter->second);
+		}
+
+		std::unordered_map<std::string, const EnumInfo*> enums_by_key;
+		for (const EnumInfo& enum_info : enum_infos)
+		{
+			if (!enum_info.nesting_class_name.empty()) enums_by_key.emplace(EnumKey(enum_info), &enum_info);
+		}
+
+		Logger::Info("[CSharpInterpreter] Generating native MXML reader and writer for {0} types", types.size());
+
+		std::stringstream names;
+		std::stringstream declarations;
+		std::stringstream definitions;
+
+		//enum tables go by the first member that uses the enum
+		std::unordered_set<std::string> written_enums;
+
+		for (const TypeInfo* type_info : types)
+		{
+			std::string cpp_type = CppTypeName(*type_info);
+
+			//index in the dispatch switch, unsized arrays only exist for templates with custom serialization
+			std::vector<const FieldInfo*> fields;
+			std::vector<NameEntry> field_entries;
+			for (const FieldInfo& field_info : type_info->field_infos)
+			{
+				if (!field_info.is_serialized) continue;
+
+				FieldKind kind = ClassifyField(field_info);
+				if (kind == FieldKind::Unsupported) continue;
+
+				if (kind == FieldKind::Enum || kind == FieldKind::EnumList || kind == FieldKind::EnumArray)
+				{
+					std::string enum_key = ElementTypeName(field_info.type_name);
+					auto enum_iter = enums_by_key.find(enum_key);
+					if (enum_iter == enums_by_key.end() || enum_iter->second->entries.empty())
+					{
+						Logger::Warning("[CSharpInterpreter] No entries for enum {0} of {1}::{2}, the field is skipped in MXML", enum_key, type_info->name, field_info.name);
+						continue;
+					}
+
+					if (written_enums.insert(enum_key).second)
+					{
+						std::vector<NameEntry> enum_entries(enum_iter->second->entries.begin(), enum_iter->second->entries.end());
+						if (!WriteNames(names, EnumMemberType(*type_info, field_info, kind), enum_entries, nullptr, enum_iter->second))
+						{
+							Logger::Error("[CSharpInterpreter] No perfect hash for the entries of {0}", enum_key);
+						}
+					}
+				}
+
+				field_entries.emplace_back(field_info.mxml_name.empty() ? field_info.name : field_info.mxml_name, static_cast<int64_t>(fields.size()));
+				fields.push_back(&field_info);
+			}
+
+			if (!WriteNames(names, cpp_type, field_entries, &type_info->name, nullptr))
+			{
+				Logger::Error("[CSharpInterpreter] No perfect hash for the properties of {0}, no native MXML reader or writer", type_info->name);
+				continue;
+			}
+
+			declarations << "inline void ReadProperty(Reader& reader, const Property& property, " << cpp_type << "& out);\n";
+			declarations << "inline void WriteProperty(Writer& writer, std::string_view name, const " << cpp_type << "& value);\n";
+			if (GetMxmlForm(*type_info) == MxmlForm::Fields) declarations << "inline void WriteFields(Writer& writer, const " << cpp_type << "& value);\n";
+
+			WriteReadProperty(definitions, *type_info, fields);
+
+			//libMBIN writes the fields ordered by NMSAttribute Index, fields without one keep their declaration order
+			std::vector<const FieldInfo*> write_order = fields;
+			std::stable_sort(write_order.begin(), write_order.end(), [](const FieldInfo* a, const FieldInfo* b) { return a->index < b->index; });
+			WriteWriteProperty(definitions, *type_info, write_order, struct_types);
+		}
+
+		std::stringstream ss;
+		ss << "//Generated by NMSgen CSharpInterpreter\n\n";
+
+		ss << "#pragma once\n\n";
+
+		ss << "#include \"GeneratedCppTypes.h\"\n";
+		ss << "#include \"nms++/details/mxml_codec.hpp\"\n\n";
+
+		ss << "namespace mxml_codec\n{\n\n";
+
+		ss << "using namespace std::string_view_literals;\n\n";
+
+		ss << "template <typename T>\nstruct CompilerVersion\n{\n";
+		ss << "\tstatic constexpr std::string_view value = " << Quote(header_info.compiler_version) << ";\n";
+		ss << "};\n\n";
+
+		//a polymorphic template is written as its class name with the template below, neither is represented by the generated types
+		ss << "inline void ReadProperty(Reader& reader, const Property& property, NMSTemplate&)\n{\n";
+		ss << "\treader.Skip(property);\n";
+		ss << "}\n\n";
+
+		//libMBIN leaves out templates that are not set, which is all the generated types can say about them
+		ss << "inline void WriteProperty(Writer&, std::string_view, const NMSTemplate&)\n{\n";
+		ss << "}\n\n";
+
+		ss << names.str();
+
+		//declared up front so the definitions do not depend on the struct order
+		ss << declarations.str() << "\n";
+		ss << definitions.str();
+
+		ss << "} //namespace mxml_codec\n";
+
+		return ss.str();
+	}
+}
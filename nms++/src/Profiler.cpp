@@ -0,0 +1,471 @@
+#include "../header/Profiler.h"
+#include "../header/Logger.h"
+#include "mono/metadata/profiler.h"
+#include "mono/metadata/debug-helpers.h"
+#include "mono/metadata/object.h"
+#include "mono/metadata/class.h"
+#include "mono/metadata/image.h"
+#include "mono/utils/mono-publib.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+//mono hands this back to every callback, all state lives in the statics below
+struct _MonoProfiler
+{
+	int unused;
+};
+
+namespace
+{
+	int64_t NowNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	double NsToMs(int64_t ns)
+	{
+		return static_cast<double>(ns) / 1000000.0;
+	}
+
+	struct MethodStats
+	{
+		std::string name;
+		uint64_t calls = 0;
+		int64_t total_ns = 0;
+		int64_t self_ns = 0;
+		uint64_t allocations = 0;
+		uint64_t allocated_bytes = 0;
+		uint64_t jit_compilations = 0;
+		int64_t jit_ns = 0;
+	};
+
+	struct Frame
+	{
+		MonoMethod* method;
+		int64_t start_ns;
+		int64_t child_ns;
+	};
+
+	//owned by the profiler so the data survives the thread. the mutex is only contended while a report is taken.
+	struct ThreadData
+	{
+		std::mutex mutex;
+		std::unordered_map<MonoMethod*, MethodStats> methods;
+		std::vector<Frame> stack;
+		std::unordered_map<MonoMethod*, int64_t> jit_starts;
+		uint64_t allocations = 0;
+		uint64_t allocated_bytes = 0;
+
+		MethodStats& Stats(MonoMethod* method)
+		{
+			auto [found, is_new] = methods.try_emplace(method);
+			if (is_new)
+			{
+				char* full_name = mono_method_full_name(method, true);
+				found->second.name = full_name ? full_name : "<unknown>";
+				mono_free(full_name);
+			}
+			return found->second;
+		}
+	};
+
+	struct GcCycle
+	{
+		uint32_t generation;
+		int64_t start_ns;
+		int64_t end_ns;
+		int64_t pause_ns;
+	};
+
+	constexpr size_t max_gc_cycles = 4096;
+
+	MonoProfiler profiler_instance;
+	MonoProfilerHandle profiler_handle = nullptr;
+	std::atomic<bool> installed = false;
+
+	//everything with a destructor. leaked on purpose: the shutdown report is written from ~MonoLayer during static
+	//destruction, when statics of this translation unit may already be gone.
+	struct ProfilerState
+	{
+		nmspp::ProfilerOptions options;
+
+		std::mutex threads_mutex;
+		std::vector<std::unique_ptr<ThreadData>> threads;
+
+		//gc events arrive serialized under the GC lock with mutators stopped, so they never take a lock.
+		//cycles are appended to preallocated storage and published through gc_cycle_count.
+		std::unique_ptr<GcCycle[]> gc_cycles;
+	};
+
+	ProfilerState& State()
+	{
+		static ProfilerState* state = new ProfilerState();
+		return *state;
+	}
+
+	thread_local ThreadData* current_thread = nullptr;
+
+	std::atomic<size_t> gc_cycle_count = 0;
+	std::atomic<uint64_t> dropped_gc_cycles = 0;
+	GcCycle current_gc{};
+	int64_t stop_world_ns = 0;
+
+	ThreadData& CurrentThread()
+	{
+		if (!current_thread)
+		{
+			auto data = std::make_unique<ThreadData>();
+			current_thread = data.get();
+
+			std::lock_guard<std::mutex> lock(State().threads_mutex);
+			State().threads.push_back(std::move(data));
+		}
+		return *current_thread;
+	}
+
+	MonoProfilerCallInstrumentationFlags InstrumentationFilter(MonoProfiler*, MonoMethod* method)
+	{
+		const nmspp::ProfilerOptions& profiler_options = State().options;
+		if (!profiler_options.assembly_filter.empty())
+		{
+			const char* image_name = mono_image_get_name(mono_class_get_image(mono_method_get_class(method)));
+			if (!image_name || !std::strstr(image_name, profiler_options.assembly_filter.c_str()))
+			{
+				return MONO_PROFILER_CALL_INSTRUMENTATION_NONE;
+			}
+		}
+
+		return static_cast<MonoProfilerCallInstrumentationFlags>(MONO_PROFILER_CALL_INSTRUMENTATION_ENTER | MONO_PROFILER_CALL_INSTRUMENTATION_LEAVE
+			| MONO_PROFILER_CALL_INSTRUMENTATION_TAIL_CALL | MONO_PROFILER_CALL_INSTRUMENTATION_EXCEPTION_LEAVE);
+	}
+
+	void MethodEnter(MonoProfiler*, MonoMethod* method, MonoProfilerCallContext*)
+	{
+		ThreadData& thread = CurrentThread();
+		thread.stack.push_back(Frame{ method, NowNs(), 0 });
+	}
+
+	void PopFrame(MonoMethod* method)
+	{
+		int64_t now = NowNs();
+		ThreadData& thread = CurrentThread();
+
+		//frames entered before instrumentation was active have no matching enter
+		if (thread.stack.empty() || thread.stack.back().method != method) return;
+
+		Frame frame = thread.stack.back();
+		thread.stack.pop_back();
+
+		int64_t total = now - frame.start_ns;
+		if (!thread.stack.empty()) thread.stack.back().child_ns += total;
+
+		std::lock_guard<std::mutex> lock(thread.mutex);
+		MethodStats& stats = thread.Stats(method);
+		stats.calls++;
+		stats.total_ns += total;
+		stats.self_ns += total - frame.child_ns;
+	}
+
+	void MethodLeave(MonoProfiler*, MonoMethod* method, MonoProfilerCallContext*)
+	{
+		PopFrame(method);
+	}
+
+	void MethodTailCall(MonoProfiler*, MonoMethod* method, MonoMethod*)
+	{
+		PopFrame(method);
+	}
+
+	void MethodExceptionLeave(MonoProfiler*, MonoMethod* method, MonoObject*)
+	{
+		PopFrame(method);
+	}
+
+	void JitBegin(MonoProfiler*, MonoMethod* method)
+	{
+		CurrentThread().jit_starts[method] = NowNs();
+	}
+
+	void JitFailed(MonoProfiler*, MonoMethod* method)
+	{
+		CurrentThread().jit_starts.erase(method);
+	}
+
+	void JitDone(MonoProfiler*, MonoMethod* method, MonoJitInfo*)
+	{
+		ThreadData& thread = CurrentThread();
+
+		auto found = thread.jit_starts.find(method);
+		if (found == thread.jit_starts.end()) return;
+
+		int64_t duration = NowNs() - found->second;
+		thread.jit_starts.erase(found);
+
+		std::lock_guard<std::mutex> lock(thread.mutex);
+		MethodStats& stats = thread.Stats(method);
+		stats.jit_compilations++;
+		stats.jit_ns += duration;
+	}
+
+	void GcAllocation(MonoProfiler*, MonoObject* object)
+	{
+		ThreadData& thread = CurrentThread();
+		uint64_t size = mono_object_get_size(object);
+
+		std::lock_guard<std::mutex> lock(thread.mutex);
+		thread.allocations++;
+		thread.allocated_bytes += size;
+
+		if (!thread.stack.empty())
+		{
+			MethodStats& stats = thread.Stats(thread.stack.back().method);
+			stats.allocations++;
+			stats.allocated_bytes += size;
+		}
+	}
+
+	void GcEvent(MonoProfiler*, MonoProfilerGCEvent gc_event, uint32_t generation, mono_bool)
+	{
+		switch (gc_event)
+		{
+		case MONO_GC_EVENT_PRE_STOP_WORLD:
+			stop_world_ns = NowNs();
+			break;
+		case MONO_GC_EVENT_START:
+			current_gc = GcCycle{ generation, NowNs(), 0, 0 };
+			break;
+		case MONO_GC_EVENT_END:
+			current_gc.end_ns = NowNs();
+			break;
+		case MONO_GC_EVENT_POST_START_WORLD:
+		{
+			if (current_gc.start_ns == 0) break;
+
+			current_gc.pause_ns = stop_world_ns ? NowNs() - stop_world_ns : 0;
+
+			size_t index = gc_cycle_count.load(std::memory_order_relaxed);
+			if (index < max_gc_cycles)
+			{
+				State().gc_cycles[index] = current_gc;
+				gc_cycle_count.store(index + 1, std::memory_order_release);
+			}
+			else
+			{
+				dropped_gc_cycles.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			current_gc = GcCycle{};
+			stop_world_ns = 0;
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	void AppendJsonString(std::string& out, const std::string& value)
+	{
+		out += '"';
+		for (char c : value)
+		{
+			if (c == '"' || c == '\\')
+			{
+				out += '\\';
+				out += c;
+			}
+			else if (static_cast<unsigned char>(c) < 0x20)
+			{
+				//control characters are not allowed raw in JSON strings
+				static constexpr char hex_digits[] = "0123456789abcdef";
+				out += "\\u00";
+				out += hex_digits[(c >> 4) & 0xF];
+				out += hex_digits[c & 0xF];
+			}
+			else
+			{
+				out += c;
+			}
+		}
+		out += '"';
+	}
+}
+
+namespace nmspp
+{
+	void Profiler::Install(const ProfilerOptions& options)
+	{
+		if (!options.enabled || installed.exchange(true)) return;
+
+		State().options = options;
+		State().gc_cycles = std::make_unique<GcCycle[]>(max_gc_cycles);
+
+		//allocation events have to be requested before the runtime starts
+		if (options.allocations && !mono_profiler_enable_allocations())
+		{
+			Logger::Warning("[Profiler] Allocation profiling is not available");
+		}
+
+		profiler_handle = mono_profiler_create(&profiler_instance);
+
+		if (options.calls)
+		{
+			mono_profiler_set_call_instrumentation_filter_callback(profiler_handle, &InstrumentationFilter);
+			mono_profiler_set_method_enter_callback(profiler_handle, &MethodEnter);
+			mono_profiler_set_method_leave_callback(profiler_handle, &MethodLeave);
+			mono_profiler_set_method_tail_call_callback(profiler_handle, &MethodTailCall);
+			mono_profiler_set_method_exception_leave_callback(profiler_handle, &MethodExceptionLeave);
+		}
+
+		mono_profiler_set_jit_begin_callback(profiler_handle, &JitBegin);
+		mono_profiler_set_jit_failed_callback(profiler_handle, &JitFailed);
+		mono_profiler_set_jit_done_callback(profiler_handle, &JitDone);
+		mono_profiler_set_gc_event_callback(profiler_handle, &GcEvent);
+		if (options.allocations) mono_profiler_set_gc_allocation_callback(profiler_handle, &GcAllocation);
+
+		Logger::Info("[Profiler] Installed");
+	}
+
+	bool Profiler::IsEnabled()
+	{
+		return installed.load();
+	}
+
+	ProfileReport Profiler::GetReport()
+	{
+		ProfileReport report;
+		if (!IsEnabled()) return report;
+
+		std::unordered_map<MonoMethod*, MethodStats> merged;
+		{
+			std::lock_guard<std::mutex> threads_lock(State().threads_mutex);
+			for (const auto& thread : State().threads)
+			{
+				std::lock_guard<std::mutex> lock(thread->mutex);
+
+				report.allocations += thread->allocations;
+				report.allocated_bytes += thread->allocated_bytes;
+
+				for (const auto& [method, stats] : thread->methods)
+				{
+					MethodStats& total = merged[method];
+					if (total.name.empty()) total.name = stats.name;
+					total.calls += stats.calls;
+					total.total_ns += stats.total_ns;
+					total.self_ns += stats.self_ns;
+					total.allocations += stats.allocations;
+					total.allocated_bytes += stats.allocated_bytes;
+					total.jit_compilations += stats.jit_compilations;
+					total.jit_ns += stats.jit_ns;
+				}
+			}
+		}
+
+		report.methods.reserve(merged.size());
+		for (const auto& [method, stats] : merged)
+		{
+			MethodProfile profile;
+			profile.name = stats.name;
+			profile.calls = stats.calls;
+			profile.total_ms = NsToMs(stats.total_ns);
+			profile.self_ms = NsToMs(stats.self_ns);
+			profile.allocations = stats.allocations;
+			profile.allocated_bytes = stats.allocated_bytes;
+			profile.jit_compilations = stats.jit_compilations;
+			profile.jit_ms = NsToMs(stats.jit_ns);
+
+			report.jit_ms += profile.jit_ms;
+			report.methods.push_back(std::move(profile));
+		}
+
+		std::sort(report.methods.begin(), report.methods.end(), [](const MethodProfile& a, const MethodProfile& b) { return a.self_ms > b.self_ms; });
+
+		size_t cycle_count = gc_cycle_count.load(std::memory_order_acquire);
+		report.gc_cycles.reserve(cycle_count);
+		for (size_t i = 0; i < cycle_count; i++)
+		{
+			const GcCycle& cycle = State().gc_cycles[i];
+
+			GcCycleProfile profile;
+			profile.generation = cycle.generation;
+			profile.duration_ms = cycle.end_ns ? NsToMs(cycle.end_ns - cycle.start_ns) : 0.0;
+			profile.pause_ms = NsToMs(cycle.pause_ns);
+
+			report.gc_pause_ms += profile.pause_ms;
+			report.gc_cycles.push_back(profile);
+		}
+		report.dropped_gc_cycles = dropped_gc_cycles.load(std::memory_order_relaxed);
+
+		return report;
+	}
+
+	void Profiler::WriteShutdownReport()
+	{
+		if (IsEnabled() && !State().options.json_path.empty())
+		{
+			WriteJson(State().options.json_path);
+		}
+	}
+
+	bool Profiler::WriteJson(const std::string& path)
+	{
+		ProfileReport report = GetReport();
+
+		//fmt ignores the C locale, std::to_string would write decimal commas under some
+		std::string json;
+		json += "{\n";
+		json += "  \"allocations\": " + fmt::format("{}", report.allocations) + ",\n";
+		json += "  \"allocated_bytes\": " + fmt::format("{}", report.allocated_bytes) + ",\n";
+		json += "  \"jit_ms\": " + fmt::format("{}", report.jit_ms) + ",\n";
+		json += "  \"gc_pause_ms\": " + fmt::format("{}", report.gc_pause_ms) + ",\n";
+		json += "  \"dropped_gc_cycles\": " + fmt::format("{}", report.dropped_gc_cycles) + ",\n";
+
+		json += "  \"methods\": [";
+		for (size_t i = 0; i < report.methods.size(); i++)
+		{
+			const MethodProfile& method = report.methods[i];
+
+			json += i ? ",\n    {" : "\n    {";
+			json += "\"name\": ";
+			AppendJsonString(json, method.name);
+			json += ", \"calls\": " + fmt::format("{}", method.calls);
+			json += ", \"total_ms\": " + fmt::format("{}", method.total_ms);
+			json += ", \"self_ms\": " + fmt::format("{}", method.self_ms);
+			json += ", \"allocations\": " + fmt::format("{}", method.allocations);
+			json += ", \"allocated_bytes\": " + fmt::format("{}", method.allocated_bytes);
+			json += ", \"jit_compilations\": " + fmt::format("{}", method.jit_compilations);
+			json += ", \"jit_ms\": " + fmt::format("{}", method.jit_ms);
+			json += "}";
+		}
+		json += "\n  ],\n";
+
+		json += "  \"gc_cycles\": [";
+		for (size_t i = 0; i < report.gc_cycles.size(); i++)
+		{
+			const GcCycleProfile& cycle = report.gc_cycles[i];
+
+			json += i ? ",\n    {" : "\n    {";
+			json += "\"generation\": " + fmt::format("{}", cycle.generation);
+			json += ", \"duration_ms\": " + fmt::format("{}", cycle.duration_ms);
+			json += ", \"pause_ms\": " + fmt::format("{}", cycle.pause_ms);
+			json += "}";
+		}
+		json += "\n  ]\n}\n";
+
+		std::ofstream out(path, std::ios::trunc);
+		if (!out)
+		{
+			Logger::Error("[Profiler] Failed to write {0}", path);
+			return false;
+		}
+		out << json;
+
+		Logger::Info("[Profiler] Wrote {0} methods and {1} GC cycles to {2}", report.methods.size(), report.gc_cycles.size(), path);
+		return true;
+	}
+}
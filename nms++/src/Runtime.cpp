@@ -0,0 +1,43 @@
+#include "../header/Runtime.h"
+#include "../header/MonoLayer.h"
+
+namespace nmspp
+{
+	void Runtime::Configure(const RuntimeOptions& options)
+	{
+		mono_layer.Configure(options);
+	}
+
+	bool Runtime::Initialize()
+	{
+		return mono_layer.EnsureInitialized();
+	}
+
+	bool Runtime::Initialize(const RuntimeOptions& options)
+	{
+		mono_layer.Configure(options);
+		return mono_layer.EnsureInitialized();
+	}
+
+	bool Runtime::IsInitialized()
+	{
+		return mono_layer.IsInitialized();
+	}
+
+	bool Runtime::BuildAotCache()
+	{
+		return mono_layer.BuildAotCache();
+	}
+
+	StartupTimings Runtime::GetStartupTimings()
+	{
+		return mono_layer.GetStartupTimings();
+	}
+
+	void Runtime::LogStartupTimings()
+	{
+		StartupTimings timings = GetStartupTimings();
+		Logger::Info("[Runtime] {0} startup {1:.2f}ms: tracing {2:.2f}ms, jit {3:.2f}ms, domain {4:.2f}ms, libMBIN {5:.2f}ms",
+			timings.aot ? "aot" : "jit", timings.total_ms, timings.tracing_ms, timings.jit_init_ms, timings.domain_ms, timings.assembly_load_ms);
+	}
+}
@@ -0,0 +1,352 @@
+#include "../header/CSharpInterpreter.h"
+#include "../header/MappedFile.h"
+#include "../header/Logger.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+//schema file layout, all integers little endian as written by the host:
+//	header		magic "NMSS", format version, dll hash, string count, type count, enum count
+//	mbin header	mbin version, header version, timestamp, compiler version
+//	strings		length + bytes each, referenced by index everywhere else. type names repeat a lot, so each is stored once.
+//	types		TypeInfo with its FieldInfos
+//	enums		EnumInfo with its entries
+namespace CSharpInterpreter
+{
+	static constexpr char schema_magic[4] = { 'N', 'M', 'S', 'S' };
+	//bump whenever TypeInfo, FieldInfo, EnumInfo or MbinHeaderInfo change, or the extractor fills them differently
+	static constexpr uint32_t schema_version = 2;
+	//smallest a FieldInfo can be stored in: 4 string indices, 2 flags, 5 values and the enum name count
+	static constexpr size_t min_field_size = 4 * sizeof(uint32_t) + 2 + 5 * sizeof(uint32_t) + sizeof(uint32_t);
+
+	class SchemaWriter
+	{
+	public:
+		template <typename T>
+		void Value(T value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			data.append(reinterpret_cast<const char*>(&value), sizeof(T));
+		}
+
+		void String(const std::string& value)
+		{
+			auto found = string_indices.find(value);
+			if (found == string_indices.end())
+			{
+				found = string_indices.emplace(value, static_cast<uint32_t>(strings.size())).first;
+				strings.push_back(&found->first);
+			}
+
+			Value(found->second);
+		}
+
+		//strings are only known once everything else is written, they go in front of it
+		std::string Finish(uint64_t dll_hash, uint32_t type_count, uint32_t enum_count) const
+		{
+			std::string file;
+			file.append(schema_magic, sizeof(schema_magic));
+			Append(file, schema_version);
+			Append(file, dll_hash);
+			Append(file, static_cast<uint32_t>(strings.size()));
+			Append(file, type_count);
+			Append(file, enum_count);
+
+			for (const std::string* string : strings)
+			{
+				Append(file, static_cast<uint32_t>(string->size()));
+				file.append(*string);
+			}
+
+			file.append(data);
+			return file;
+		}
+
+	private:
+		template <typename T>
+		static void Append(std::string& out, T value)
+		{
+			out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+		}
+
+		std::string data;
+		std::unordered_map<std::string, uint32_t> string_indices;
+		std::vector<const std::string*> strings;
+	};
+
+	//bounds checked, a damaged file fails instead of reading past the mapping
+	class SchemaReader
+	{
+	public:
+		SchemaReader(const char* data, size_t size) : data(data), size(size) {}
+
+		template <typename T>
+		T Value()
+		{
+			T value{};
+			if (failed || size - position < sizeof(T))
+			{
+				failed = true;
+				return value;
+			}
+
+			std::memcpy(&value, data + position, sizeof(T));
+			position += sizeof(T);
+			return value;
+		}
+
+		bool Strings(uint32_t count)
+		{
+			strings.reserve(count);
+			for (uint32_t i = 0; i < count; i++)
+			{
+				uint32_t length = Value<uint32_t>();
+				if (failed || size - position < length)
+				{
+					failed = true;
+					return false;
+				}
+
+				strings.emplace_back(data + position, length);
+				position += length;
+			}
+
+			return !failed;
+		}
+
+		const std::string& String()
+		{
+			uint32_t index = Value<uint32_t>();
+			if (index >= strings.size())
+			{
+				failed = true;
+				return empty;
+			}
+
+			return strings[index];
+		}
+
+		//element counts are checked against the bytes left, so a damaged count cannot reserve gigabytes
+		uint32_t Count(size_t min_element_size)
+		{
+			uint32_t count = Value<uint32_t>();
+			if ((size - position) / min_element_size < count) failed = true;
+			return failed ? 0 : count;
+		}
+
+		bool Failed() const { return failed; }
+		bool AtEnd() const { return position == size; }
+
+	private:
+		const char* data;
+		size_t size;
+		size_t position = 0;
+		bool failed = false;
+
+		std::vector<std::string> strings;
+		const std::string empty;
+	};
+
+	uint64_t HashFile(const std::string& path)
+	{
+		MappedFile file;
+		if (!file.Open(path)) return 0;
+
+		//FNV-1a, only has to tell libMBIN builds apart
+		uint64_t hash = 0xCBF29CE484222325;
+		const unsigned char* bytes = reinterpret_cast<const unsigned char*>(file.Data());
+		for (size_t i = 0; i < file.Size(); i++)
+		{
+			hash ^= bytes[i];
+			hash *= 0x100000001B3;
+		}
+
+		return hash;
+	}
+
+	bool SaveSchema(const std::string& path, uint64_t dll_hash, const Schema& schema)
+	{
+		SchemaWriter writer;
+
+		writer.Value(schema.header_info.mbin_version);
+		writer.Value(schema.header_info.header_version);
+		writer.Value(schema.header_info.timestamp);
+		writer.String(schema.header_info.compiler_version);
+
+		for (const TypeInfo& type_info : schema.infos.type_infos)
+		{
+			writer.String(type_info.name);
+			writer.String(type_info.namespace_name);
+			writer.String(type_info.base_class_name);
+			writer.String(type_info.base_class_namespace);
+			writer.Value<uint8_t>(type_info.has_layout);
+			writer.Value(type_info.binary_size);
+			writer.Value(type_info.alignment);
+			writer.Value(type_info.name_hash);
+			writer.Value(type_info.guid);
+
+			writer.Value(static_cast<uint32_t>(type_info.field_infos.size()));
+			for (const FieldInfo& field_info : type_info.field_infos)
+			{
+				writer.String(field_info.name);
+				writer.String(field_info.type_name);
+				writer.String(field_info.mxml_name);
+				writer.String(field_info.key_field);
+				writer.Value<uint8_t>(field_info.is_actual_enum);
+				writer.Value<uint8_t>(field_info.is_serialized);
+				writer.Value(field_info.size);
+				writer.Value(field_info.offset);
+				writer.Value(field_info.alignment);
+				writer.Value(field_info.enum_size);
+				writer.Value(field_info.index);
+
+				writer.Value(static_cast<uint32_t>(field_info.enum_names.size()));
+				for (const std::string& enum_name : field_info.enum_names) writer.String(enum_name);
+			}
+		}
+
+		for (const EnumInfo& enum_info : schema.infos.enum_infos)
+		{
+			writer.String(enum_info.name);
+			writer.String(enum_info.nesting_class_name);
+			writer.String(enum_info.namespace_name);
+			writer.String(enum_info.underlying_type);
+			writer.Value<uint8_t>(enum_info.is_flags);
+
+			writer.Value(static_cast<uint32_t>(enum_info.entries.size()));
+			for (const auto& [entry_name, entry_value] : enum_info.entries)
+			{
+				writer.String(entry_name);
+				writer.Value(entry_value);
+			}
+		}
+
+		std::string file = writer.Finish(dll_hash, static_cast<uint32_t>(schema.infos.type_infos.size()), static_cast<uint32_t>(schema.infos.enum_infos.size()));
+
+		std::error_code error;
+		std::filesystem::path schema_path(path);
+		if (schema_path.has_parent_path()) std::filesystem::create_directories(schema_path.parent_path(), error);
+
+		//written next to the old schema and swapped in, an interrupted write leaves no damaged file behind
+		std::string temp_path = path + ".tmp";
+		{
+			std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+			if (!out || !out.write(file.data(), file.size()))
+			{
+				Logger::Error("[CSharpInterpreter] Failed to write schema {0}", temp_path);
+				return false;
+			}
+		}
+
+		std::filesystem::rename(temp_path, path, error);
+		if (error)
+		{
+			Logger::Error("[CSharpInterpreter] Failed to replace schema {0}", path);
+			return false;
+		}
+
+		Logger::Info("[CSharpInterpreter] Saved schema of {0} types and {1} enums to {2}, {3} bytes", schema.infos.type_infos.size(), schema.infos.enum_infos.size(), path, file.size());
+		return true;
+	}
+
+	bool LoadSchema(const std::string& path, uint64_t dll_hash, Schema& out)
+	{
+		if (!std::filesystem::exists(path)) return false;
+
+		MappedFile file;
+		if (!file.Open(path)) return false;
+
+		SchemaReader reader(file.Data(), file.Size());
+
+		char magic[4];
+		for (char& c : magic) c = reader.Value<char>();
+		uint32_t version = reader.Value<uint32_t>();
+		uint64_t file_hash = reader.Value<uint64_t>();
+		if (reader.Failed() || std::memcmp(magic, schema_magic, sizeof(magic)) != 0 || version != schema_version)
+		{
+			Logger::Info("[CSharpInterpreter] {0} is not a schema of this version", path);
+			return false;
+		}
+
+		if (file_hash != dll_hash)
+		{
+			Logger::Info("[CSharpInterpreter] libMBIN changed since {0} was written", path);
+			return false;
+		}
+
+		uint32_t string_count = reader.Value<uint32_t>();
+		uint32_t type_count = reader.Value<uint32_t>();
+		uint32_t enum_count = reader.Value<uint32_t>();
+		reader.Strings(string_count);
+
+		Schema schema;
+		schema.header_info.mbin_version = reader.Value<uint16_t>();
+		schema.header_info.header_version = reader.Value<uint16_t>();
+		schema.header_info.timestamp = reader.Value<uint64_t>();
+		schema.header_info.compiler_version = reader.String();
+
+		schema.infos.type_infos.resize(reader.Failed() ? 0 : type_count);
+		for (TypeInfo& type_info : schema.infos.type_infos)
+		{
+			type_info.name = reader.String();
+			type_info.namespace_name = reader.String();
+			type_info.base_class_name = reader.String();
+			type_info.base_class_namespace = reader.String();
+			type_info.has_layout = reader.Value<uint8_t>() != 0;
+			type_info.binary_size = reader.Value<uint32_t>();
+			type_info.alignment = reader.Value<uint32_t>();
+			type_info.name_hash = reader.Value<uint32_t>();
+			type_info.guid = reader.Value<uint64_t>();
+
+			type_info.field_infos.resize(reader.Count(min_field_size));
+			for (FieldInfo& field_info : type_info.field_infos)
+			{
+				field_info.name = reader.String();
+				field_info.type_name = reader.String();
+				field_info.mxml_name = reader.String();
+				field_info.key_field = reader.String();
+				field_info.is_actual_enum = reader.Value<uint8_t>() != 0;
+				field_info.is_serialized = reader.Value<uint8_t>() != 0;
+				field_info.size = reader.Value<uint32_t>();
+				field_info.offset = reader.Value<uint32_t>();
+				field_info.alignment = reader.Value<uint32_t>();
+				field_info.enum_size = reader.Value<uint32_t>();
+				field_info.index = reader.Value<int32_t>();
+
+				field_info.enum_names.resize(reader.Count(sizeof(uint32_t)));
+				for (std::string& enum_name : field_info.enum_names) enum_name = reader.String();
+			}
+
+			if (reader.Failed()) break;
+		}
+
+		schema.infos.enum_infos.resize(reader.Failed() ? 0 : enum_count);
+		for (EnumInfo& enum_info : schema.infos.enum_infos)
+		{
+			enum_info.name = reader.String();
+			enum_info.nesting_class_name = reader.String();
+			enum_info.namespace_name = reader.String();
+			enum_info.underlying_type = reader.String();
+			enum_info.is_flags = reader.Value<uint8_t>() != 0;
+
+			enum_info.entries.resize(reader.Count(sizeof(uint32_t) + sizeof(int64_t)));
+			for (auto& [entry_name, entry_value] : enum_info.entries)
+			{
+				entry_name = reader.String();
+				entry_value = reader.Value<int64_t>();
+			}
+
+			if (reader.Failed()) break;
+		}
+
+		if (reader.Failed() || !reader.AtEnd())
+		{
+			Logger::Warning("[CSharpInterpreter] Schema {0} is damaged, extracting again", path);
+			return false;
+		}
+
+		out = std::move(schema);
+		Logger::Info("[CSharpInterpreter] Loaded schema of {0} types and {1} enums from {2}", out.infos.type_infos.size(), out.infos.enum_infos.size(), path);
+		return true;
+	}
+}
@@ -0,0 +1,74 @@
+#include "../header/WorkerPool.h"
+#include "../header/MonoLayer.h"
+#include "mono/metadata/threads.h"
+#include <algorithm>
+
+MonoWorkerPool::MonoWorkerPool(unsigned int thread_count)
+{
+	if (thread_count == 0)
+	{
+		thread_count = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	//start the runtime on the constructing thread, not on whichever worker gets there first
+	mono_layer.EnsureInitialized();
+
+	workers.reserve(thread_count);
+	for (unsigned int i = 0; i < thread_count; i++)
+	{
+		workers.emplace_back(&MonoWorkerPool::WorkerLoop, this);
+	}
+
+	Logger::Info("[MonoWorkerPool] Started {0} workers", thread_count);
+}
+
+MonoWorkerPool::~MonoWorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	task_condition.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void MonoWorkerPool::WaitIdle()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	idle_condition.wait(lock, [this]() { return tasks.empty() && active_tasks == 0; });
+}
+
+void MonoWorkerPool::WorkerLoop()
+{
+	//every thread that touches managed objects has to be known to the runtime and the GC
+	MonoThread* mono_thread = mono_thread_attach(mono_layer.GetDomain());
+
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			task_condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+
+			if (tasks.empty()) break;
+
+			task = std::move(tasks.front());
+			tasks.pop_front();
+			++active_tasks;
+		}
+
+		task();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			--active_tasks;
+			if (tasks.empty() && active_tasks == 0) idle_condition.notify_all();
+		}
+	}
+
+	mono_thread_detach(mono_thread);
+}
@@ -1,16 +1,64 @@
 #include "../header/engine_io.h"
 #include <filesystem>
 #include <thread>
+#include <mutex>
+#include <cstring>
 
 MonoClass* IO::nms_template = nullptr;
 MonoClass* IO::file_io = nullptr;
 MonoObject* IO::file_io_obj = nullptr;
+ManagedThunk<void, MonoObject*, MonoString*> IO::write_mbin_thunk;
+ManagedThunk<void, MonoObject*, MonoString*> IO::write_exml_thunk;
+MonoClass* IO::mbin_file = nullptr;
+MonoClass* IO::mxml_file = nullptr;
+MonoClass* IO::mbin_header = nullptr;
+MonoClass* IO::memory_stream = nullptr;
+MonoClass* IO::unmanaged_memory_stream = nullptr;
+ManagedThunk<MonoArray*, MonoObject*> IO::flatten_thunk;
+ManagedThunk<int32_t, MonoObject*, MonoArray*> IO::rebuild_thunk;
 
-void IO::Initialize()
+void IO::Initialize(bool use_unmanaged_thunks)
 {
-	nms_template = mono_layer.GetClass("libMBIN", "NMSTemplate");
-	file_io = mono_layer.GetClass("libMBIN", "FileIO");
-	file_io_obj = mono_layer.CreateInstanceOfClass(IO::file_io);
+	//the statics are only written here, worker threads read them afterwards without locking
+	static std::once_flag initialized;
+	std::call_once(initialized, [use_unmanaged_thunks]()
+		{
+			nms_template = mono_layer.GetClass("libMBIN", "NMSTemplate");
+			file_io = mono_layer.GetClass("libMBIN", "FileIO");
+			file_io_obj = mono_layer.CreateInstanceOfClass(IO::file_io);
+
+			//keep the FileIO instance alive and in place, it is only referenced from native memory
+			mono_gchandle_new(file_io_obj, true);
+
+			mbin_file = mono_layer.GetClass("libMBIN", "MBINFile");
+			mxml_file = mono_layer.GetClass("libMBIN", "MXmlFile");
+			mbin_header = mono_layer.GetClass("libMBIN", "MBINHeader");
+			memory_stream = mono_class_from_name(mono_get_corlib(), "System.IO", "MemoryStream");
+			unmanaged_memory_stream = mono_class_from_name(mono_get_corlib(), "System.IO", "UnmanagedMemoryStream");
+
+			if (use_unmanaged_thunks)
+			{
+				//falls back to RuntimeInvoke when a thunk cannot be created
+				write_mbin_thunk = mono_layer.GetUnmanagedThunk<void, MonoObject*, MonoString*>(nms_template, "WriteToMbin");
+				write_exml_thunk = mono_layer.GetUnmanagedThunk<void, MonoObject*, MonoString*>(nms_template, "WriteToExml");
+			}
+
+			//whole graph marshalling through the helper assembly, see flat_codec.hpp
+			if (use_unmanaged_thunks && mono_layer.GetHelperAssembly())
+			{
+				MonoImage* helper_image = mono_assembly_get_image(mono_layer.GetHelperAssembly());
+				MonoClass* flattener = mono_class_from_name(helper_image, "NmsPlusPlus", "GraphFlattener");
+				if (flattener)
+				{
+					flatten_thunk = mono_layer.GetUnmanagedThunk<MonoArray*, MonoObject*>(flattener, "Flatten");
+					rebuild_thunk = mono_layer.GetUnmanagedThunk<int32_t, MonoObject*, MonoArray*>(flattener, "Rebuild");
+				}
+				else
+				{
+					Logger::Warning("[IO] Helper assembly has no NmsPlusPlus.GraphFlattener");
+				}
+			}
+		});
 }
 
 char* IO::ReadBytes(const std::string& path, uint32_t& out_size)
@@ -130,16 +178,148 @@ void IO::Write(ResourceHandle to_write, const std::string& path)
 	}
 }
 
+bool IO::WriteBuffer(const std::string& path, const char* data, size_t size)
+{
+	auto fspath = std::filesystem::path(path);
+	fspath.remove_filename();
+	if(!fspath.empty() && !std::filesystem::exists(fspath))
+	{
+		std::filesystem::create_directories(fspath);
+	}
+
+	std::ofstream write_stream(path, std::ios::binary);
+	if(!write_stream || !write_stream.write(data, size))
+	{
+		Logger::Error("[IO] Failed to write file {0}", path);
+		return false;
+	}
+
+	return true;
+}
+
 void IO::WriteMxml(MonoObject* to_write, const std::string& path)
 {
+	if (write_exml_thunk)
+	{
+		mono_layer.InvokeThunk(write_exml_thunk, to_write, mono_string_new(mono_layer.GetDomain(), path.c_str()));
+		return;
+	}
+
 	mono_layer.RuntimeInvoke(nms_template, to_write, "WriteToExml", path.c_str());
 }
 
 void IO::WriteMbin(MonoObject* to_write, const std::string& path)
 {
+	if (write_mbin_thunk)
+	{
+		mono_layer.InvokeThunk(write_mbin_thunk, to_write, mono_string_new(mono_layer.GetDomain(), path.c_str()));
+		return;
+	}
+
 	mono_layer.RuntimeInvoke(nms_template, to_write, "WriteToMbin", path.c_str());
 }
 
+std::vector<uint8_t> IO::SerializeToBuffer(ResourceHandle handle, Format format)
+{
+	std::vector<uint8_t> buffer;
+
+	if (!handle.obj)
+	{
+		Logger::Error("[IO, SerializeToBuffer] Handle with path {0} is not valid!", handle.path);
+		return buffer;
+	}
+
+	if (format == Format::Mxml)
+	{
+		MonoObject* xml = mono_layer.RuntimeInvoke(mxml_file, nullptr, "WriteTemplate", handle.obj);
+		if (!xml) return buffer;
+
+		char* utf8 = mono_string_to_utf8(reinterpret_cast<MonoString*>(xml));
+		buffer.assign(utf8, utf8 + std::strlen(utf8));
+		mono_free(utf8);
+
+		return buffer;
+	}
+
+	MonoObject* stream = mono_layer.CreateInstanceOfClass(memory_stream);
+	if (!stream) return buffer;
+
+	//keep_open, the stream is read after the MBINFile is disposed
+	bool keep_open = true;
+	MonoObject* mbin = mono_layer.CreateInstanceOfClass(mbin_file, stream, keep_open);
+	if (!mbin) return buffer;
+
+	//a stream backed MBINFile starts without a header, fill it in like WriteToMbin does
+	MonoObject* header = mono_layer.CreateInstanceOfClass(mbin_header);
+	if (!header) return buffer;
+
+	MonoObject* template_type = reinterpret_cast<MonoObject*>(mono_type_get_object(mono_layer.GetDomain(), mono_class_get_type(mono_object_get_class(handle.obj))));
+	//MBINHeader.Format.V4
+	int32_t header_format = 4;
+	mono_layer.RuntimeInvoke(mbin_header, header, "SetDefaults", template_type, header_format);
+	mono_field_set_value(mbin, mono_class_get_field_from_name(mbin_file, "Header"), header);
+
+	mono_layer.RuntimeInvoke(mbin_file, mbin, "SetData", handle.obj);
+	mono_layer.RuntimeInvoke(mbin_file, mbin, "Save");
+	mono_layer.RuntimeInvoke(mbin_file, mbin, "Dispose");
+
+	//GetBuffer hands out the stream's own array, so the bytes are only copied into native memory
+	MonoArray* bytes = reinterpret_cast<MonoArray*>(mono_layer.RuntimeInvoke(memory_stream, stream, "GetBuffer"));
+	MonoObject* boxed_length = mono_layer.RuntimeInvoke(memory_stream, stream, "get_Length");
+	if (!bytes || !boxed_length)
+	{
+		Logger::Error("[IO, SerializeToBuffer] Failed to read back the serialized MBIN");
+		return buffer;
+	}
+
+	const int64_t length = *static_cast<int64_t*>(mono_object_unbox(boxed_length));
+	buffer.resize(static_cast<size_t>(length));
+	std::memcpy(buffer.data(), mono_array_addr(bytes, char, 0), buffer.size());
+
+	return buffer;
+}
+
+IO::ResourceHandle IO::LoadFromBuffer(BufferView buffer, Format format)
+{
+	ResourceHandle handle(nullptr);
+	handle.path = "INVALIDPATH";
+
+	if (!buffer.data || buffer.size == 0)
+	{
+		Logger::Error("[IO, LoadFromBuffer] Buffer is empty!");
+		return handle;
+	}
+
+	//UnmanagedMemoryStream reads the native bytes in place instead of copying them into a byte[]
+	const uint8_t* data = buffer.data;
+	int64_t length = static_cast<int64_t>(buffer.size);
+	MonoObject* stream = mono_layer.CreateInstanceOfClass(unmanaged_memory_stream, data, length);
+	if (!stream) return handle;
+
+	if (format == Format::Mxml)
+	{
+		handle.obj = mono_layer.RuntimeInvoke(mxml_file, nullptr, "ReadTemplateFromStream", stream);
+	}
+	else
+	{
+		//MBINFile.Dispose fails on streams it owns, the UnmanagedMemoryStream holds nothing to release anyway
+		bool keep_open = true;
+		MonoObject* mbin = mono_layer.CreateInstanceOfClass(mbin_file, stream, keep_open);
+		if (!mbin) return handle;
+
+		mono_layer.RuntimeInvoke(mbin_file, mbin, "Load");
+		handle.obj = mono_layer.RuntimeInvoke(mbin_file, mbin, "GetData");
+		mono_layer.RuntimeInvoke(mbin_file, mbin, "Dispose");
+	}
+
+	if (!handle.obj)
+	{
+		Logger::Error("[IO, LoadFromBuffer] Failed to load a template from {0} bytes", buffer.size);
+	}
+
+	return handle;
+}
+
 void IO::PAKDirectoryContents(const std::string& directory, const std::string& pak_file_name)
 {
 	static constexpr std::chrono::milliseconds poll_interval = std::chrono::milliseconds(100);
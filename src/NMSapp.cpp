@@ -1,12 +1,22 @@
 #include "../header/NMSapp.h"
 #include "../header/GeneratedCppTypes.h"
 #include "nms++/nms++.h"
+//native MBIN writer for the object lists below, IO::Write falls back to libMBIN without it
+#if __has_include("../header/GeneratedMbinCodec.h")
+#include "../header/GeneratedMbinCodec.h"
+#endif
 #include <filesystem>
 #include <unordered_set>
 #include <array>
+#include <future>
 
 NMSapp::NMSapp()
 {
+	nmspp::RuntimeOptions runtime_options;
+	runtime_options.use_aot = true;
+	nmspp::Runtime::Initialize(runtime_options);
+	nmspp::Runtime::LogStartupTimings();
+
 	IO::Initialize();
 
 	using namespace NMS_GameComponents;
@@ -25,13 +35,32 @@ NMSapp::NMSapp()
 	/*std::vector<GcObjectSpawnData::OverlapStyleEnum> overlapstyles;*/
 	//std::vector<GcSeed> seeds;
 
+	MonoWorkerPool worker_pool;
+
+	//only the four object lists are merged, creatures and selectable objects are never read
+	using ObjectListProjection = nmspp::Projection<
+		nmspp::Path<&GcExternalObjectList::Objects, &GcEnvironmentSpawnData::DistantObjects>,
+		nmspp::Path<&GcExternalObjectList::Objects, &GcEnvironmentSpawnData::Landmarks>,
+		nmspp::Path<&GcExternalObjectList::Objects, &GcEnvironmentSpawnData::Objects>,
+		nmspp::Path<&GcExternalObjectList::Objects, &GcEnvironmentSpawnData::DetailObjects>>;
+
+	//load in parallel, merge in directory order so the output stays deterministic
+	std::vector<std::future<GcExternalObjectList>> base_object_lists;
 	for(const auto& directory_entry : DirectoryIterator("nms_baseobjects/"))
 	{
-		Logger::Info("path : {}", directory_entry.path().string().c_str());
+		base_object_lists.push_back(worker_pool.Submit([path = directory_entry.path().string()]()
+			{
+				Logger::Info("path : {}", path.c_str());
 
-		IO::ResourceHandle base_object_list_handle = {directory_entry.path().string()};
+				IO::ResourceHandle base_object_list_handle = {path};
 
-		const GcExternalObjectList base_object_list = IO::TryGetNativeObject<GcExternalObjectList>(base_object_list_handle);
+				return IO::TryGetProjectedObject<GcExternalObjectList, ObjectListProjection>(base_object_list_handle);
+			}));
+	}
+
+	for(std::future<GcExternalObjectList>& base_object_list_future : base_object_lists)
+	{
+		const GcExternalObjectList base_object_list = base_object_list_future.get();
 		distant_objects.insert(distant_objects.end(), base_object_list.Objects.DistantObjects.begin(), base_object_list.Objects.DistantObjects.end());
 		landmark_objects.insert(landmark_objects.end(), base_object_list.Objects.Landmarks.begin(), base_object_list.Objects.Landmarks.end());
 		normal_objects.insert(normal_objects.end(), base_object_list.Objects.Objects.begin(), base_object_list.Objects.Objects.end());
@@ -256,8 +285,6 @@ NMSapp::NMSapp()
 			distant_object.Placement.Value = *iter;
 		}
 
-		IO::ResourceHandle new_external_object_handle = IO::PushData(external_distant_object);
-
 		size_t slash_offset = distant_object.Resource.Filename.Value.find_last_of("/");
 		size_t dot_offset = distant_object.Resource.Filename.Value.find_first_of(".");
 
@@ -267,7 +294,7 @@ NMSapp::NMSapp()
 			name += "_VAR_" + std::to_string(++name_iteration_map[name]); 
 		}
 
-		IO::Write(new_external_object_handle, "output_objects/DISTANT/" + name + ".MBIN");
+		IO::Write(external_distant_object, "output_objects/DISTANT/" + name + ".MBIN");
 		distant_object_filenames.push_back("METADATA/SIMULATION/SOLARSYSTEM/BIOMES/FFPG/DISTANT/" + name + ".MBIN");
 	}
 	seen_names.clear();
@@ -287,8 +314,6 @@ NMSapp::NMSapp()
 			landmark_object.Placement.Value = *iter;
 		}
 
-		IO::ResourceHandle new_external_object_handle = IO::PushData(external_landmark_object);
-
 		size_t slash_offset = landmark_object.Resource.Filename.Value.find_last_of("/");
 		size_t dot_offset = landmark_object.Resource.Filename.Value.find_first_of(".");
 
@@ -298,7 +323,7 @@ NMSapp::NMSapp()
 			name += "_VAR_" + std::to_string(++name_iteration_map[name]);
 		}
 
-		IO::Write(new_external_object_handle, "output_objects/LANDMARK/" + name + ".MBIN");
+		IO::Write(external_landmark_object, "output_objects/LANDMARK/" + name + ".MBIN");
 		landmark_object_filenames.push_back("METADATA/SIMULATION/SOLARSYSTEM/BIOMES/FFPG/LANDMARK/" + name + ".MBIN");
 	}
 	seen_names.clear();
@@ -318,8 +343,6 @@ NMSapp::NMSapp()
 			normal_object.Placement.Value = *iter;
 		}
 
-		IO::ResourceHandle new_external_object_handle = IO::PushData(external_normal_object);
-
 		size_t slash_offset = normal_object.Resource.Filename.Value.find_last_of("/");
 		size_t dot_offset = normal_object.Resource.Filename.Value.find_first_of(".");
 
@@ -329,7 +352,7 @@ NMSapp::NMSapp()
 			name += "_VAR_" + std::to_string(++name_iteration_map[name]);
 		}
 
-		IO::Write(new_external_object_handle, "output_objects/OBJECTS/" + name + ".MBIN");
+		IO::Write(external_normal_object, "output_objects/OBJECTS/" + name + ".MBIN");
 		normal_object_filenames.push_back("METADATA/SIMULATION/SOLARSYSTEM/BIOMES/FFPG/OBJECT/" + name + ".MBIN");
 	}
 	seen_names.clear();
@@ -349,8 +372,6 @@ NMSapp::NMSapp()
 			detail_object.Placement.Value = *iter;
 		}
 
-		IO::ResourceHandle new_external_object_handle = IO::PushData(external_detail_object);
-
 		size_t slash_offset = detail_object.Resource.Filename.Value.find_last_of("/");
 		size_t dot_offset = detail_object.Resource.Filename.Value.find_first_of(".");
 
@@ -360,7 +381,7 @@ NMSapp::NMSapp()
 			name += "_VAR_" + std::to_string(++name_iteration_map[name]);
 		}
 
-		IO::Write(new_external_object_handle, "output_objects/DETAIL/" + name + ".MBIN");
+		IO::Write(external_detail_object, "output_objects/DETAIL/" + name + ".MBIN");
 		detail_object_filenames.push_back("METADATA/SIMULATION/SOLARSYSTEM/BIOMES/FFPG/DETAIL/" + name + ".MBIN");
 	}
 
@@ -376,13 +397,31 @@ NMSapp::NMSapp()
 	std::vector<GcScreenFilterOption> screen_filter_options;
 	std::unordered_set<GcScreenFilters::ScreenFilterEnum> seen_enums;
 
+	using BiomeProjection = nmspp::Projection<
+		nmspp::Path<&GcBiomeData::ColourPaletteFile>,
+		nmspp::Path<&GcBiomeData::TextureFile>,
+		nmspp::Path<&GcBiomeData::TileTypesFile>,
+		nmspp::Path<&GcBiomeData::DarknessVariation>,
+		nmspp::Path<&GcBiomeData::CloudSettings>,
+		nmspp::Path<&GcBiomeData::Terrain>,
+		nmspp::Path<&GcBiomeData::FilterOptions>>;
+
+	std::vector<std::future<GcBiomeData>> base_biomes;
 	for(const auto& directory_entry : DirectoryIterator("nms_basebiomes/"))
 	{
-		Logger::Info("path: {}", directory_entry.path().string().c_str());
+		base_biomes.push_back(worker_pool.Submit([path = directory_entry.path().string()]()
+			{
+				Logger::Info("path: {}", path.c_str());
+
+				IO::ResourceHandle base_biome_handle = {path};
 
-		IO::ResourceHandle base_biome_handle = {directory_entry.path().string()};
+				return IO::TryGetProjectedObject<GcBiomeData, BiomeProjection>(base_biome_handle);
+			}));
+	}
 
-		const GcBiomeData base_biome_data = IO::TryGetNativeObject<GcBiomeData>(base_biome_handle);
+	for(std::future<GcBiomeData>& base_biome_future : base_biomes)
+	{
+		const GcBiomeData base_biome_data = base_biome_future.get();
 		colourpalettes_strings.insert(base_biome_data.ColourPaletteFile.Value);
 		texturefile_map.emplace(base_biome_data.ColourPaletteFile.Value, base_biome_data.TextureFile.Value);
 		tiletypes_map.emplace(base_biome_data.ColourPaletteFile.Value, base_biome_data.TileTypesFile.Value);
@@ -1,6 +1,14 @@
 #include "../header/NMSapp.h"
+#include "nms++/nms++.h"
+#include <cstring>
 
-int main()
+int main(int argc, char** argv)
 {
+	//build step: nms_testing --build-aot-cache
+	if (argc > 1 && std::strcmp(argv[1], "--build-aot-cache") == 0)
+	{
+		return nmspp::Runtime::BuildAotCache() ? 0 : 1;
+	}
+
 	NMSapp application = NMSapp();
 }
\ No newline at end of file